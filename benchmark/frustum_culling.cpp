@@ -0,0 +1,75 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/time.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bvh.hpp"
+
+using namespace std;
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+static float random_float(float low, float high) {
+	return low + (high - low) * rand() / RAND_MAX;
+}
+
+int main(int argc, char **args) {
+	size_t object_count = (argc > 1) ? atoi(args[1]) : 100000;
+	int repeat_count = (argc > 2) ? atoi(args[2]) : 100;
+
+	// objects scattered through a 200 unit cube, the camera in the middle looking along -z
+	srand(1);
+	vector<aabb_t> bounds(object_count);
+	for (size_t i = 0; i < object_count; i++) {
+		glm::vec3 center(random_float(-100.0f, 100.0f), random_float(-100.0f, 100.0f), random_float(-100.0f, 100.0f));
+		glm::vec3 extent(random_float(0.2f, 2.0f), random_float(0.2f, 2.0f), random_float(0.2f, 2.0f));
+		bounds[i] = aabb_t(center - extent, center + extent);
+	}
+	glm::mat4 projection_matrix = glm::perspective(45.0f, 4.0f / 3.0f, 0.5f, 100.0f);
+	glm::mat4 view_matrix = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	frustum_t frustum(projection_matrix * view_matrix);
+
+	cout << object_count << " objects, " << repeat_count << " repeats" << endl;
+
+	vector<size_t> expected;
+	double start = now();
+	for (int r = 0; r < repeat_count; r++) {
+		expected.clear();
+		for (size_t i = 0; i < object_count; i++) {
+			if (frustum.intersects(bounds[i]))
+				expected.push_back(i);
+		}
+	}
+	double brute_force_time = (now() - start) / repeat_count;
+
+	bvh_t bvh;
+	start = now();
+	bvh.build(bounds);
+	double build_time = now() - start;
+	start = now();
+	for (int r = 0; r < repeat_count; r++)
+		bvh.refit(bounds);
+	double refit_time = (now() - start) / repeat_count;
+
+	vector<size_t> visible;
+	start = now();
+	for (int r = 0; r < repeat_count; r++)
+		bvh.cull(frustum, visible);
+	double cull_time = (now() - start) / repeat_count;
+
+	sort(visible.begin(), visible.end());
+	cout << "every box:  " << brute_force_time * 1.0e3 << " ms" << endl;
+	cout << "bvh:        " << cull_time * 1.0e3 << " ms (" << brute_force_time / cull_time << "x), "
+	     << bvh.node_count() << " nodes, built in " << build_time * 1.0e3 << " ms, refit in " << refit_time * 1.0e3 << " ms" << endl;
+	cout << bvh.stats() << endl;
+	cout << (visible == expected ? "same objects as every box" : "*** not the same objects as every box") << endl;
+
+	return visible == expected ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstddef>
+
+#include "shader.hpp"
+#include "mesh.hpp"
+#include "render_state.hpp"
+#include "gl_call_counter.hpp"
+
+using namespace std;
+
+// a material of a diffuse and a normal texture, shared by a run of neighbouring meshes
+static const size_t MATERIAL_COUNT = 4;
+static const GLuint DIFFUSE_TEXTURES[MATERIAL_COUNT] = { 101, 102, 103, 104 };
+static const GLuint NORMAL_TEXTURES[MATERIAL_COUNT] = { 201, 202, 203, 204 };
+
+// texture binding as texture_unit_t::activate/deactivate did it before the render state cache
+void bind_textures_per_draw(size_t material) {
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, DIFFUSE_TEXTURES[material]);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, NORMAL_TEXTURES[material]);
+}
+
+void unbind_textures_per_draw() {
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// mesh_t::render as it was before vertex array objects were captured
+void render_without_vertex_array(const mesh_t &mesh, const shader_program_t &shader_program) {
+	GLuint position_location = shader_program.attribute_location("vertex_position");
+	GLuint normal_location = shader_program.attribute_location("vertex_normal");
+	GLuint tex_coord_location = shader_program.attribute_location("vertex_tex_coord");
+	GLuint tangent_location = shader_program.attribute_location("vertex_tangent");
+
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer_handle);
+  glVertexAttribPointer(position_location, 4, GL_FLOAT, GL_FALSE, sizeof(vertex_t), (GLvoid *)(offsetof(vertex_t, position)));
+	glVertexAttribPointer(normal_location, 3, GL_FLOAT, GL_FALSE, sizeof(vertex_t), (GLvoid *)(offsetof(vertex_t, normal)));
+	glVertexAttribPointer(tex_coord_location, 2, GL_FLOAT, GL_FALSE, sizeof(vertex_t), (GLvoid *)(offsetof(vertex_t, tex_coord)));
+	glVertexAttribPointer(tangent_location, 3, GL_FLOAT, GL_FALSE, sizeof(vertex_t), (GLvoid *)(offsetof(vertex_t, tangent)));
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glEnableVertexAttribArray(position_location);
+  glEnableVertexAttribArray(normal_location);
+	glEnableVertexAttribArray(tex_coord_location);
+	glEnableVertexAttribArray(tangent_location);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer_handle);
+  glDrawElements(GL_TRIANGLES, mesh.indices.size(), mesh.index_type, (GLvoid *)0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glDisableVertexAttribArray(tangent_location);
+	glDisableVertexAttribArray(tex_coord_location);
+  glDisableVertexAttribArray(normal_location);
+  glDisableVertexAttribArray(position_location);
+}
+
+void build_quad(mesh_t &mesh) {
+	mesh.vertices.resize(4);
+	for (int i = 0; i < 4; i++) {
+		mesh.vertices[i].position = glm::vec4(i & 1, i >> 1, 0.0f, 1.0f);
+		mesh.vertices[i].normal = glm::vec3(0.0f, 0.0f, 1.0f);
+		mesh.vertices[i].tex_coord = glm::vec2(i & 1, i >> 1);
+	}
+	unsigned int indices[] = { 0, 1, 2, 1, 3, 2 };
+	mesh.indices.assign(indices, indices + 6);
+	mesh.load_to_buffers();
+}
+
+void render_frame(std::vector<mesh_t> &meshes, const shader_program_t &shader_program, bool use_vertex_array) {
+	size_t mesh_count = meshes.size();
+	shader_program.bind();
+	shader_program.set_uniform_value("light_direction", glm::vec3(0.0f, -1.0f, 0.0f));
+	shader_program.set_uniform_value("projection_matrix", glm::mat4(1.0f));
+	for (size_t i = 0; i < meshes.size(); i++) {
+		shader_program.set_uniform_value("model_view_matrix", glm::mat4(1.0f));
+		shader_program.set_uniform_value("normal_matrix", glm::mat3(1.0f));
+		size_t material = i * MATERIAL_COUNT / mesh_count;
+		if (use_vertex_array) {
+			RENDER_STATE.bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, DIFFUSE_TEXTURES[material]);
+			RENDER_STATE.bind_texture(GL_TEXTURE1, GL_TEXTURE_2D, NORMAL_TEXTURES[material]);
+			meshes[i].render(shader_program);
+		} else {
+			bind_textures_per_draw(material);
+			render_without_vertex_array(meshes[i], shader_program);
+			unbind_textures_per_draw();
+		}
+	}
+	shader_program.release();
+}
+
+void report(const char *label, size_t frame_count, size_t mesh_count) {
+	size_t total = gl_call_counter_total();
+	cout << label << ": " << (double)total / frame_count << " GL calls/frame, "
+	     << (double)total / (frame_count * mesh_count) << " GL calls/draw" << endl;
+
+	const gl_call_counts &counts = gl_call_counter_counts();
+	for (gl_call_counts::const_iterator it = counts.begin(); it != counts.end(); it++) {
+		cout << "  " << setw(28) << left << it->first << (double)it->second / frame_count << endl;
+	}
+}
+
+int main(int argc, char **args) {
+	size_t mesh_count = (argc > 1) ? atoi(args[1]) : 100;
+	size_t frame_count = (argc > 2) ? atoi(args[2]) : 100;
+
+	shader_program_t shader_program;
+	shader_program.add_shader_from_source_code(GL_VERTEX_SHADER, "void main() { }");
+	shader_program.add_shader_from_source_code(GL_FRAGMENT_SHADER, "void main() { }");
+	shader_program.link();
+
+	std::vector<mesh_t> meshes(mesh_count);
+	for (size_t i = 0; i < mesh_count; i++)
+		build_quad(meshes[i]);
+
+	cout << mesh_count << " meshes, " << frame_count << " frames" << endl;
+
+	gl_call_counter_reset();
+	for (size_t i = 0; i < frame_count; i++)
+		render_frame(meshes, shader_program, false);
+	report("before (per-draw attribute setup and texture binds)", frame_count, mesh_count);
+
+	// the plain GL calls above went behind the cache's back. The first frame captures the
+	// vertex array objects; measure the steady state after it
+	RENDER_STATE.invalidate();
+	render_frame(meshes, shader_program, true);
+	gl_call_counter_reset();
+	RENDER_STATE.reset_counters();
+	for (size_t i = 0; i < frame_count; i++)
+		render_frame(meshes, shader_program, true);
+	report("after (cached vertex array objects and render state)", frame_count, mesh_count);
+	cout << RENDER_STATE.counters() << endl;
+
+	return 0;
+}
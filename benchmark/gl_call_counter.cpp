@@ -0,0 +1,182 @@
+// Counting stand-in for the GL entry points used by shader_program_t, mesh_t, render_state_t
+// and uniform_ring_t.
+// GL headers are deliberately not included here: these definitions only have to
+// match the C symbols the renderer links against.
+
+#include <cstring>
+#include <cstddef>
+#include "gl_call_counter.hpp"
+
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef int GLsizei;
+typedef unsigned char GLboolean;
+typedef float GLfloat;
+typedef char GLchar;
+typedef ptrdiff_t GLsizeiptr;
+typedef ptrdiff_t GLintptr;
+typedef unsigned int GLbitfield;
+typedef unsigned char GLubyte;
+typedef struct __GLsync *GLsync;
+typedef unsigned long long GLuint64;
+
+#define GL_COMPILE_STATUS                 0x8B81
+#define GL_LINK_STATUS                    0x8B82
+#define GL_INFO_LOG_LENGTH                0x8B84
+#define GL_ACTIVE_UNIFORMS                0x8B86
+#define GL_ACTIVE_UNIFORM_MAX_LENGTH      0x8B87
+#define GL_ACTIVE_ATTRIBUTES              0x8B89
+#define GL_ACTIVE_ATTRIBUTE_MAX_LENGTH    0x8B8A
+#define GL_FLOAT                          0x1406
+#define GL_FLOAT_VEC3                     0x8B51
+#define GL_FLOAT_VEC4                     0x8B52
+#define GL_FLOAT_MAT3                     0x8B5B
+#define GL_FLOAT_MAT4                     0x8B5C
+#define GL_ALREADY_SIGNALED               0x911A
+
+static gl_call_counts __counts;
+static GLuint __next_handle = 1;
+
+static const char *__attributes[] = { "vertex_position", "vertex_normal", "vertex_tex_coord", "vertex_tangent" };
+static const char *__uniforms[] = { "projection_matrix", "model_view_matrix", "normal_matrix", "light_direction" };
+
+#define COUNT_OF(a)  (sizeof(a) / sizeof((a)[0]))
+#define COUNT_CALL()  (__counts[__func__]++)
+
+static GLint index_of(const char **names, size_t count, const char *name) {
+	for (size_t i = 0; i < count; i++) {
+		if (std::strcmp(names[i], name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+static void copy_name(const char *name, GLsizei buf_size, GLsizei *length, GLchar *buf) {
+	GLsizei n = std::strlen(name);
+	if (n >= buf_size)
+		n = buf_size - 1;
+	std::memcpy(buf, name, n);
+	buf[n] = '\0';
+	if (length)
+		*length = n;
+}
+
+void gl_call_counter_reset() {
+	__counts.clear();
+}
+
+const gl_call_counts& gl_call_counter_counts() {
+	return __counts;
+}
+
+size_t gl_call_counter_total() {
+	size_t total = 0;
+	for (gl_call_counts::const_iterator it = __counts.begin(); it != __counts.end(); it++)
+		total += it->second;
+	return total;
+}
+
+extern "C" {
+
+GLuint glCreateShader(GLenum) { COUNT_CALL(); return __next_handle++; }
+void glShaderSource(GLuint, GLsizei, const GLchar **, const GLint *) { COUNT_CALL(); }
+void glCompileShader(GLuint) { COUNT_CALL(); }
+void glDeleteShader(GLuint) { COUNT_CALL(); }
+GLboolean glIsShader(GLuint shader) { COUNT_CALL(); return shader != 0; }
+void glGetShaderInfoLog(GLuint, GLsizei, GLsizei *length, GLchar *) { COUNT_CALL(); if (length) *length = 0; }
+
+void glGetShaderiv(GLuint, GLenum pname, GLint *params) {
+	COUNT_CALL();
+	*params = (pname == GL_COMPILE_STATUS) ? 1 : 0;
+}
+
+GLuint glCreateProgram() { COUNT_CALL(); return __next_handle++; }
+void glAttachShader(GLuint, GLuint) { COUNT_CALL(); }
+void glLinkProgram(GLuint) { COUNT_CALL(); }
+void glDeleteProgram(GLuint) { COUNT_CALL(); }
+GLboolean glIsProgram(GLuint program) { COUNT_CALL(); return program != 0; }
+void glUseProgram(GLuint) { COUNT_CALL(); }
+void glGetProgramInfoLog(GLuint, GLsizei, GLsizei *length, GLchar *) { COUNT_CALL(); if (length) *length = 0; }
+
+void glGetProgramiv(GLuint, GLenum pname, GLint *params) {
+	COUNT_CALL();
+	switch (pname) {
+		case GL_LINK_STATUS: *params = 1; break;
+		case GL_ACTIVE_UNIFORMS: *params = COUNT_OF(__uniforms); break;
+		case GL_ACTIVE_ATTRIBUTES: *params = COUNT_OF(__attributes); break;
+		case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+		case GL_ACTIVE_ATTRIBUTE_MAX_LENGTH: *params = 64; break;
+		default: *params = 0;
+	}
+}
+
+void glGetActiveUniform(GLuint, GLuint index, GLsizei buf_size, GLsizei *length, GLint *size, GLenum *type, GLchar *name) {
+	COUNT_CALL();
+	copy_name(__uniforms[index], buf_size, length, name);
+	*size = 1;
+	*type = GL_FLOAT_MAT4;
+}
+
+void glGetActiveAttrib(GLuint, GLuint index, GLsizei buf_size, GLsizei *length, GLint *size, GLenum *type, GLchar *name) {
+	COUNT_CALL();
+	copy_name(__attributes[index], buf_size, length, name);
+	*size = 1;
+	*type = GL_FLOAT_VEC4;
+}
+
+GLint glGetUniformLocation(GLuint, const GLchar *name) { COUNT_CALL(); return index_of(__uniforms, COUNT_OF(__uniforms), name); }
+GLint glGetAttribLocation(GLuint, const GLchar *name) { COUNT_CALL(); return index_of(__attributes, COUNT_OF(__attributes), name); }
+
+void glUniform1i(GLint, GLint) { COUNT_CALL(); }
+void glUniform1f(GLint, GLfloat) { COUNT_CALL(); }
+void glUniform2iv(GLint, GLsizei, const GLint *) { COUNT_CALL(); }
+void glUniform2fv(GLint, GLsizei, const GLfloat *) { COUNT_CALL(); }
+void glUniform3fv(GLint, GLsizei, const GLfloat *) { COUNT_CALL(); }
+void glUniform4fv(GLint, GLsizei, const GLfloat *) { COUNT_CALL(); }
+void glUniformMatrix3fv(GLint, GLsizei, GLboolean, const GLfloat *) { COUNT_CALL(); }
+void glUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat *) { COUNT_CALL(); }
+
+void glGenBuffers(GLsizei n, GLuint *buffers) { COUNT_CALL(); for (GLsizei i = 0; i < n; i++) buffers[i] = __next_handle++; }
+void glBindBuffer(GLenum, GLuint) { COUNT_CALL(); }
+void glBufferData(GLenum, GLsizeiptr, const void *, GLenum) { COUNT_CALL(); }
+
+void glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void *) { COUNT_CALL(); }
+void glVertexAttribDivisor(GLuint, GLuint) { COUNT_CALL(); }
+void glEnableVertexAttribArray(GLuint) { COUNT_CALL(); }
+void glDisableVertexAttribArray(GLuint) { COUNT_CALL(); }
+void glDrawElements(GLenum, GLsizei, GLenum, const void *) { COUNT_CALL(); }
+void glDrawElementsInstanced(GLenum, GLsizei, GLenum, const void *, GLsizei) { COUNT_CALL(); }
+
+void glGenVertexArrays(GLsizei n, GLuint *arrays) { COUNT_CALL(); for (GLsizei i = 0; i < n; i++) arrays[i] = __next_handle++; }
+void glBindVertexArray(GLuint) { COUNT_CALL(); }
+void glDeleteVertexArrays(GLsizei, const GLuint *) { COUNT_CALL(); }
+void glGenVertexArraysAPPLE(GLsizei n, GLuint *arrays) { COUNT_CALL(); for (GLsizei i = 0; i < n; i++) arrays[i] = __next_handle++; }
+void glBindVertexArrayAPPLE(GLuint) { COUNT_CALL(); }
+void glDeleteVertexArraysAPPLE(GLsizei, const GLuint *) { COUNT_CALL(); }
+
+void glActiveTexture(GLenum) { COUNT_CALL(); }
+void glBindTexture(GLenum, GLuint) { COUNT_CALL(); }
+void glEnable(GLenum) { COUNT_CALL(); }
+void glDisable(GLenum) { COUNT_CALL(); }
+void glCullFace(GLenum) { COUNT_CALL(); }
+void glDepthFunc(GLenum) { COUNT_CALL(); }
+void glDepthMask(GLboolean) { COUNT_CALL(); }
+void glBindFramebufferEXT(GLenum, GLuint) { COUNT_CALL(); }
+
+GLuint glGetUniformBlockIndex(GLuint, const GLchar *) { COUNT_CALL(); return 0; }
+void glUniformBlockBinding(GLuint, GLuint, GLuint) { COUNT_CALL(); }
+// no extensions, so uniform_ring_t stages its blocks
+const GLubyte *glGetString(GLenum) { COUNT_CALL(); return (const GLubyte *)""; }
+void glGetIntegerv(GLenum, GLint *params) { COUNT_CALL(); *params = 256; }
+void glDeleteBuffers(GLsizei, const GLuint *) { COUNT_CALL(); }
+void glBufferSubData(GLenum, GLintptr, GLsizeiptr, const void *) { COUNT_CALL(); }
+void glBindBufferRange(GLenum, GLuint, GLuint, GLintptr, GLsizeiptr) { COUNT_CALL(); }
+void glBufferStorage(GLenum, GLsizeiptr, const void *, GLbitfield) { COUNT_CALL(); }
+void *glMapBufferRange(GLenum, GLintptr, GLsizeiptr, GLbitfield) { COUNT_CALL(); return NULL; }
+GLboolean glUnmapBuffer(GLenum) { COUNT_CALL(); return 1; }
+GLsync glFenceSync(GLenum, GLbitfield) { COUNT_CALL(); return NULL; }
+GLenum glClientWaitSync(GLsync, GLbitfield, GLuint64) { COUNT_CALL(); return GL_ALREADY_SIGNALED; }
+void glDeleteSync(GLsync) { COUNT_CALL(); }
+
+}
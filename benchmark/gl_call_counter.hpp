@@ -0,0 +1,13 @@
+#ifndef GL_CALL_COUNTER_HPP
+#define GL_CALL_COUNTER_HPP
+
+#include <map>
+#include <string>
+
+typedef std::map<std::string, size_t> gl_call_counts;
+
+void gl_call_counter_reset();
+const gl_call_counts& gl_call_counter_counts();
+size_t gl_call_counter_total();
+
+#endif
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+#include <png.h>
+
+#include "parallel.hpp"
+#include "image_loader.hpp"
+
+using namespace std;
+
+static const char *DEFAULT_FILEPATHS[] = {
+	"../normal_map_demo/assets/image/grunge.png",
+	"../normal_map_demo/assets/image/grunge_normal.png",
+	"../normal_map_demo/assets/image/polkadots.png",
+	"../normal_map_demo/assets/image/polkadots_height.png",
+	"../normal_map_demo/assets/image/polkadots_normal.png",
+	"../reflection_demo/wood.png"
+};
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+// read_image_from_png_file of the demos as it was before image_loader.cpp: png_read_row into
+// a fresh buffer per image (the error paths, which leaked, are left out)
+static unsigned char* read_rows_from_png_file(const char *filepath) {
+	FILE *fp = fopen(filepath, "rb");
+	if (!fp)
+		return NULL;
+
+	unsigned char header[8];
+	if (fread(header, 1, 8, fp) != 8 || png_sig_cmp(header, 0, 8)) {
+		fclose(fp);
+		return NULL;
+	}
+
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	png_init_io(png_ptr, fp);
+	png_set_sig_bytes(png_ptr, 8);
+	png_read_info(png_ptr, info_ptr);
+
+	int width = png_get_image_width(png_ptr, info_ptr);
+	int height = png_get_image_height(png_ptr, info_ptr);
+	png_byte bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+	png_set_interlace_handling(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
+
+	png_byte byte_depth = png_get_channels(png_ptr, info_ptr);
+	if (bit_depth == 16)
+		byte_depth *= 2;
+
+	png_byte *buf = new png_byte[width * height * byte_depth];
+	int offset = 0;
+	for (int y = 0; y < height; y++) {
+		png_read_row(png_ptr, buf + offset, NULL);
+		offset += width * byte_depth;
+	}
+
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	fclose(fp);
+	return buf;
+}
+
+int main(int argc, char **args) {
+	int repeat_count = (argc > 1) ? atoi(args[1]) : 10;
+	vector<const char *> filepaths;
+	for (int i = 2; i < argc; i++)
+		filepaths.push_back(args[i]);
+	if (filepaths.empty())
+		filepaths.assign(DEFAULT_FILEPATHS, DEFAULT_FILEPATHS + sizeof(DEFAULT_FILEPATHS) / sizeof(DEFAULT_FILEPATHS[0]));
+	size_t count = filepaths.size();
+
+	vector<image_t> images(count);
+	if (!read_images_from_png_files(&filepaths[0], count, &images[0]))
+		return EXIT_FAILURE;
+	size_t total_bytes = 0;
+	for (size_t i = 0; i < count; i++) {
+		total_bytes += images[i].size();
+		release_image(images[i]);
+	}
+	cout << count << " images, " << total_bytes / (1024.0 * 1024.0) << " MB decoded, "
+	     << hardware_thread_count() << " threads" << endl;
+
+	double start = now();
+	for (int r = 0; r < repeat_count; r++) {
+		for (size_t i = 0; i < count; i++) {
+			unsigned char *data = read_rows_from_png_file(filepaths[i]);
+			if (data == NULL)
+				return EXIT_FAILURE;
+			delete [] data;
+		}
+	}
+	double row_time = (now() - start) / repeat_count;
+
+	start = now();
+	for (int r = 0; r < repeat_count; r++) {
+		for (size_t i = 0; i < count; i++) {
+			read_image_from_png_file(filepaths[i], images[i]);
+			release_image(images[i]);
+		}
+	}
+	double image_time = (now() - start) / repeat_count;
+
+	image_pool_t pool;
+	start = now();
+	for (int r = 0; r < repeat_count; r++) {
+		for (size_t i = 0; i < count; i++) {
+			read_image_from_png_file(filepaths[i], images[i], &pool);
+			release_image(images[i]);
+		}
+	}
+	double pooled_time = (now() - start) / repeat_count;
+
+	start = now();
+	for (int r = 0; r < repeat_count; r++) {
+		read_images_from_png_files(&filepaths[0], count, &images[0], &pool);
+		for (size_t i = 0; i < count; i++)
+			release_image(images[i]);
+	}
+	double parallel_time = (now() - start) / repeat_count;
+
+	cout << "png_read_row, new buffer:    " << row_time * 1.0e3 << " ms" << endl;
+	cout << "png_read_image, new buffer:  " << image_time * 1.0e3 << " ms (" << row_time / image_time << "x)" << endl;
+	cout << "png_read_image, pooled:      " << pooled_time * 1.0e3 << " ms (" << row_time / pooled_time << "x)" << endl;
+	cout << "parallel, pooled:            " << parallel_time * 1.0e3 << " ms (" << row_time / parallel_time << "x)" << endl;
+
+	return 0;
+}
@@ -0,0 +1,183 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <sys/time.h>
+
+#include "shader.hpp"
+#include "render_state.hpp"
+#include "render_queue.hpp"
+#include "uniform_buffer.hpp"
+#include "gl_call_counter.hpp"
+
+using namespace std;
+
+static const size_t PROGRAM_COUNT = 8;
+static const size_t MATERIAL_COUNT = 64;
+
+struct object_t {
+	size_t program;
+	size_t material;
+	glm::mat4 transform;
+	GLintptr uniform_offset;
+};
+
+// std140, as a shader would declare it
+struct object_block_t {
+	glm::mat4 model_view_matrix;
+	std140_mat3_t normal_matrix;
+	glm::vec4 diffuse;
+	glm::vec3 specular;
+	float shininess;
+};
+
+uniform_ring_t *uniform_ring = NULL;
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+static GLuint diffuse_texture(size_t material) { return 1000 + material; }
+static GLuint normal_texture(size_t material) { return 2000 + material; }
+
+void set_object_uniforms(const shader_program_t &program, const glm::mat4 &transform) {
+	program.set_uniform_value("model_view_matrix", transform);
+	program.set_uniform_value("normal_matrix", glm::mat3(transform));
+	program.set_uniform_value("material.diffuse", glm::vec3(1.0f));
+	program.set_uniform_value("material.specular", glm::vec3(0.5f));
+	program.set_uniform_value("material.shininess", 16.0f);
+}
+
+void draw_object(const draw_packet_t &packet) {
+	set_object_uniforms(*packet.program, packet.transform);
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, NULL);
+}
+
+void draw_object_from_block(const draw_packet_t &packet) {
+	uniform_ring->bind(1, static_cast<const object_t *>(packet.object)->uniform_offset, sizeof(object_block_t));
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, NULL);
+}
+
+// the objects in scene order, each binding what it needs
+void render_immediate(const vector<object_t> &objects, const vector<shader_program_t *> &programs) {
+	for (size_t i = 0; i < objects.size(); i++) {
+		const object_t &object = objects[i];
+		programs[object.program]->bind();
+		RENDER_STATE.bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, diffuse_texture(object.material));
+		RENDER_STATE.bind_texture(GL_TEXTURE1, GL_TEXTURE_2D, normal_texture(object.material));
+		set_object_uniforms(*programs[object.program], object.transform);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, NULL);
+	}
+}
+
+void render_queued(render_queue_t &queue, const vector<object_t> &objects, const vector<shader_program_t *> &programs,
+                   draw_function_t draw) {
+	queue.clear();
+	for (size_t i = 0; i < objects.size(); i++) {
+		const object_t &object = objects[i];
+		draw_packet_t &packet = queue.push(0, *programs[object.program], object.material, -object.transform[3].z, false, &object, draw,
+		                                   object.transform);
+		packet.add_texture(GL_TEXTURE0, GL_TEXTURE_2D, diffuse_texture(object.material));
+		packet.add_texture(GL_TEXTURE1, GL_TEXTURE_2D, normal_texture(object.material));
+	}
+	queue.submit(0);
+}
+
+void report(const char *label, size_t frame_count, size_t object_count, double seconds) {
+	size_t total = gl_call_counter_total();
+	cout << label << ": " << (double)total / frame_count << " GL calls/frame, " << (double)total / (frame_count * object_count)
+	     << " GL calls/object, " << 1000.0 * seconds / frame_count << " ms/frame" << endl;
+	const gl_call_counts &counts = gl_call_counter_counts();
+	cout << "  glUseProgram " << (double)counts.find("glUseProgram")->second / frame_count
+	     << ", glBindTexture " << (double)counts.find("glBindTexture")->second / frame_count << endl;
+}
+
+int main(int argc, char **args) {
+	size_t object_count = (argc > 1) ? atoi(args[1]) : 10000;
+	size_t frame_count = (argc > 2) ? atoi(args[2]) : 100;
+
+	vector<shader_program_t *> programs(PROGRAM_COUNT);
+	for (size_t i = 0; i < PROGRAM_COUNT; i++) {
+		programs[i] = new shader_program_t();
+		programs[i]->add_shader_from_source_code(GL_VERTEX_SHADER, "void main() { }");
+		programs[i]->add_shader_from_source_code(GL_FRAGMENT_SHADER, "void main() { }");
+		programs[i]->link();
+	}
+
+	srand(1);
+	vector<object_t> objects(object_count);
+	for (size_t i = 0; i < object_count; i++) {
+		objects[i].program = rand() % PROGRAM_COUNT;
+		objects[i].material = rand() % MATERIAL_COUNT;
+		objects[i].transform = glm::mat4(1.0f);
+		objects[i].transform[3] = glm::vec4(rand() % 100, rand() % 100, -(rand() % 1000) * 0.1f, 1.0f);
+	}
+
+	cout << object_count << " objects, " << PROGRAM_COUNT << " programs, " << MATERIAL_COUNT << " materials, " << frame_count << " frames" << endl;
+
+	RENDER_STATE.invalidate();
+	gl_call_counter_reset();
+	double start = now();
+	for (size_t i = 0; i < frame_count; i++)
+		render_immediate(objects, programs);
+	report("scene order", frame_count, object_count, now() - start);
+
+	render_queue_t queue;
+	RENDER_STATE.invalidate();
+	gl_call_counter_reset();
+	start = now();
+	for (size_t i = 0; i < frame_count; i++)
+		render_queued(queue, objects, programs, draw_object);
+	report("render queue", frame_count, object_count, now() - start);
+	cout << "  " << queue.stats() << endl;
+
+	// every object's block written into the ring in one run, then one range bind per draw
+	uniform_ring = new uniform_ring_t(object_count * 256, 3);
+	RENDER_STATE.invalidate();
+	gl_call_counter_reset();
+	start = now();
+	for (size_t i = 0; i < frame_count; i++) {
+		uniform_ring->begin_frame();
+		size_t stride = uniform_ring->aligned_size(sizeof(object_block_t));
+		GLintptr offset;
+		unsigned char *memory = static_cast<unsigned char *>(uniform_ring->allocate(object_count * stride, offset));
+		for (size_t j = 0; j < object_count; j++) {
+			object_block_t *block = reinterpret_cast<object_block_t *>(memory + j * stride);
+			block->model_view_matrix = objects[j].transform;
+			block->normal_matrix = std140_mat3_t(glm::mat3(objects[j].transform));
+			block->diffuse = glm::vec4(1.0f);
+			block->specular = glm::vec3(0.5f);
+			block->shininess = 16.0f;
+			objects[j].uniform_offset = offset + j * stride;
+		}
+		uniform_ring->flush();
+		render_queued(queue, objects, programs, draw_object_from_block);
+	}
+	report("render queue and uniform ring", frame_count, object_count, now() - start);
+	delete uniform_ring;
+
+	// submitting a pass with no packets only sorts
+	start = now();
+	for (size_t i = 0; i < frame_count; i++) {
+		queue.clear();
+		for (size_t j = 0; j < object_count; j++)
+			queue.push(0, *programs[objects[j].program], objects[j].material, -objects[j].transform[3].z, false, &objects[j], draw_object,
+			           objects[j].transform);
+	}
+	double push_seconds = now() - start;
+	start = now();
+	for (size_t i = 0; i < frame_count; i++) {
+		queue.clear();
+		for (size_t j = 0; j < object_count; j++)
+			queue.push(0, *programs[objects[j].program], objects[j].material, -objects[j].transform[3].z, false, &objects[j], draw_object,
+			           objects[j].transform);
+		queue.submit(1);
+	}
+	double sort_seconds = now() - start - push_seconds;
+	cout << "push " << 1000.0 * push_seconds / frame_count << " ms/frame, sort " << 1000.0 * sort_seconds / frame_count << " ms/frame" << endl;
+
+	for (size_t i = 0; i < PROGRAM_COUNT; i++)
+		delete programs[i];
+	return 0;
+}
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/time.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "scene_graph.hpp"
+
+using namespace std;
+
+struct node_t {
+	size_t parent;
+	glm::vec3 position;
+	glm::vec3 scale;
+	glm::quat orientation;
+};
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+static float random_float(float low, float high) {
+	return low + (high - low) * rand() / RAND_MAX;
+}
+
+// every node's matrix rebuilt each frame, walking up through its parents as a model_t
+// hierarchy without cached world matrices would
+glm::mat4 world_matrix_glm(const vector<node_t> &nodes, size_t i) {
+	const node_t &node = nodes[i];
+	glm::mat4 rotation_matrix = glm::mat4_cast(node.orientation);
+	glm::mat4 scale_matrix = glm::scale(glm::mat4(1.0), node.scale);
+	glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0), node.position);
+	glm::mat4 local_matrix = translation_matrix * scale_matrix * rotation_matrix;
+	return node.parent == scene_graph_t::NO_PARENT ? local_matrix : world_matrix_glm(nodes, node.parent) * local_matrix;
+}
+
+float max_difference(const scene_graph_t &scene, const vector<glm::mat4> &expected) {
+	float difference = 0.0f;
+	for (size_t i = 0; i < expected.size(); i++) {
+		const glm::mat4 &world_matrix = scene.world_matrix(i);
+		for (int c = 0; c < 4; c++) {
+			float magnitude = std::max(1.0f, glm::length(expected[i][c]));
+			for (int r = 0; r < 4; r++)
+				difference = std::max(difference, fabsf(world_matrix[c][r] - expected[i][c][r]) / magnitude);
+		}
+	}
+	return difference;
+}
+
+void report(const char *name, double seconds, size_t updated_count, double reference) {
+	cout << name << seconds * 1.0e6 << " us, " << updated_count << " updated";
+	if (reference > 0.0 && seconds > 0.0)
+		cout << " (" << reference / seconds << "x)";
+	cout << endl;
+}
+
+int main(int argc, char **args) {
+	size_t node_count = (argc > 1) ? atoi(args[1]) : 10000;
+	int repeat_count = (argc > 2) ? atoi(args[2]) : 100;
+	if (node_count == 0)
+		node_count = 1;
+
+	// each node under a random one of the nodes added before it, so the depths are
+	// added out of order
+	srand(1);
+	vector<size_t> depths(node_count, 0);
+	vector<node_t> nodes(node_count);
+	scene_graph_t scene;
+	for (size_t i = 0; i < node_count; i++) {
+		node_t &node = nodes[i];
+		node.parent = i == 0 ? scene_graph_t::NO_PARENT : rand() % i;
+		if (i > 0)
+			depths[i] = depths[node.parent] + 1;
+		node.position = glm::vec3(random_float(-2.0f, 2.0f), random_float(-2.0f, 2.0f), random_float(-2.0f, 2.0f));
+		node.scale = glm::vec3(random_float(0.8f, 1.2f));
+		glm::vec4 q = glm::normalize(glm::vec4(random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f)));
+		node.orientation = glm::quat(q.w, q.x, q.y, q.z);
+		scene.add(node.parent, node.position, node.scale, node.orientation);
+	}
+	size_t depth = *max_element(depths.begin(), depths.end());
+	cout << node_count << " nodes, " << depth + 1 << " levels, " << repeat_count << " repeats" << endl;
+
+	vector<glm::mat4> expected(node_count);
+	double start = now();
+	for (int r = 0; r < repeat_count; r++) {
+		for (size_t i = 0; i < node_count; i++)
+			expected[i] = world_matrix_glm(nodes, i);
+	}
+	double glm_time = (now() - start) / repeat_count;
+	report("glm every node, every frame: ", glm_time, node_count, 0.0);
+
+	// the root moved: every node is recomputed
+	size_t updated_count = 0;
+	start = now();
+	for (int r = 0; r < repeat_count; r++) {
+		scene.set_position(0, nodes[0].position);
+		updated_count = scene.update();
+	}
+	report("scene graph, root moved:     ", (now() - start) / repeat_count, updated_count, glm_time);
+	cout << "max difference: " << max_difference(scene, expected) << endl;
+
+	// a leaf moved
+	start = now();
+	for (int r = 0; r < repeat_count; r++) {
+		scene.set_position(node_count - 1, nodes[node_count - 1].position);
+		updated_count = scene.update();
+	}
+	report("scene graph, one leaf moved: ", (now() - start) / repeat_count, updated_count, glm_time);
+
+	// nothing moved
+	start = now();
+	for (int r = 0; r < repeat_count; r++)
+		updated_count = scene.update();
+	report("scene graph, static:         ", (now() - start) / repeat_count, updated_count, glm_time);
+
+	cout << scene.stats() << endl;
+
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <sys/time.h>
+#include <glm/glm.hpp>
+
+#include "parallel.hpp"
+#include "tangent.hpp"
+
+using namespace std;
+
+struct grid_mesh_t {
+	std::vector<float> vertices;
+	std::vector<float> normals;
+	std::vector<float> tex_coords;
+	std::vector<unsigned int> indices;
+};
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+// compute_tangent_vectors of bump.cpp as it was before it moved to core/tangent.cpp
+void compute_tangent_vectors_scalar(const grid_mesh_t &mesh, std::vector<float> &result) {
+	int vertex_count = mesh.vertices.size() / 3;
+	int face_count = mesh.indices.size() / 3;
+	
+	std::vector<glm::vec3> tangents;
+	tangents.resize(vertex_count);
+	
+	int *tangent_counts = new int[vertex_count];
+	for (int i = 0; i < vertex_count; i++) tangent_counts[i] = 0;
+	
+	const std::vector<float> &vertices = mesh.vertices;
+	const std::vector<float> &normals = mesh.normals;
+	const std::vector<float> &tex_coords = mesh.tex_coords;
+	const std::vector<unsigned int> &indices = mesh.indices;
+	
+	for (int i = 0; i < face_count; i++) {
+		int i0 = indices[3*i];
+		int i1 = indices[3*i + 1];
+		int i2 = indices[3*i + 2];
+			
+		int j0 = 2*i0;
+		int j1 = 2*i1;
+		int j2 = 2*i2;
+		glm::vec2 uv0(tex_coords[j0], tex_coords[j0 + 1]);
+		glm::vec2 uv1(tex_coords[j1], tex_coords[j1 + 1]);
+		glm::vec2 uv2(tex_coords[j2], tex_coords[j2 + 1]);
+		glm::vec2 st1 = uv1 - uv0;
+		glm::vec2 st2 = uv2 - uv0;
+		
+		float det = st1.x*st2.y - st2.x*st1.y;
+		if (det == 0.0f) continue;
+
+		int k0 = 3*i0;
+		int k1 = 3*i1;
+		int k2 = 3*i2;		
+		glm::vec3 p0(vertices[k0], vertices[k0 + 1], vertices[k0 + 2]);
+		glm::vec3 p1(vertices[k1], vertices[k1 + 1], vertices[k1 + 2]);
+		glm::vec3 p2(vertices[k2], vertices[k2 + 1], vertices[k2 + 2]);		
+		glm::vec3 q1 = p1 - p0;
+		glm::vec3 q2 = p2 - p0;
+		
+		float coef = 1.0f / det;
+		glm::mat3 m(
+			q1.x, q2.x, 0.0f,
+			q1.y, q2.y, 0.0f,
+			q1.z, q2.z, 0.0f
+		);
+		glm::vec3 t = coef * glm::vec3(st2.y, -st1.y, 0.0f) * m;
+
+		tangents[i0] += t;
+		tangents[i1] += t;
+		tangents[i2] += t;
+		
+		tangent_counts[i0]++;
+		tangent_counts[i1]++;
+		tangent_counts[i2]++;
+	}
+	
+	result.resize(3*vertex_count);
+	
+	for (int i = 0; i < vertex_count; i++) {
+		const glm::vec3 n(normals[3*i], normals[3*i + 1], normals[3*i + 2]);
+		const glm::vec3 t = tangent_counts[i] > 0 ? tangents[i] / (float)tangent_counts[i] : tangents[i];
+		tangents[i] = glm::normalize(t - glm::dot(n, t) * n);
+
+		result[3*i] = tangents[i].x;
+		result[3*i + 1] = tangents[i].y;
+		result[3*i + 2] = tangents[i].z;
+	}
+	
+	delete [] tangent_counts;
+}
+
+// a rippled height field, so the tangents are not all the same
+void build_grid(grid_mesh_t &mesh, int size) {
+	for (int y = 0; y <= size; y++) {
+		for (int x = 0; x <= size; x++) {
+			float u = (float)x / size;
+			float v = (float)y / size;
+			float h = 0.05f * sinf(20.0f * u) * cosf(15.0f * v);
+			mesh.vertices.push_back(u);
+			mesh.vertices.push_back(h);
+			mesh.vertices.push_back(v);
+			glm::vec3 n = glm::normalize(glm::vec3(-cosf(20.0f * u) * cosf(15.0f * v), 1.0f, sinf(20.0f * u) * sinf(15.0f * v)));
+			mesh.normals.push_back(n.x);
+			mesh.normals.push_back(n.y);
+			mesh.normals.push_back(n.z);
+			mesh.tex_coords.push_back(u);
+			mesh.tex_coords.push_back(1.0f - v);
+		}
+	}
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			unsigned int i = y * (size + 1) + x;
+			unsigned int quad[] = { i, i + size + 1, i + 1, i + 1, i + size + 1, i + size + 2 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+int main(int argc, char **args) {
+	int size = (argc > 1) ? atoi(args[1]) : 1024;
+	int repeat_count = (argc > 2) ? atoi(args[2]) : 5;
+
+	grid_mesh_t mesh;
+	build_grid(mesh, size);
+	size_t vertex_count = mesh.vertices.size() / 3;
+	cout << vertex_count << " vertices, " << mesh.indices.size() / 3 << " triangles, "
+	     << hardware_thread_count() << " threads" << endl;
+
+	std::vector<float> expected;
+	double start = now();
+	for (int i = 0; i < repeat_count; i++)
+		compute_tangent_vectors_scalar(mesh, expected);
+	double scalar_time = (now() - start) / repeat_count;
+
+	std::vector<float> tangents(4 * vertex_count);
+	start = now();
+	for (int i = 0; i < repeat_count; i++)
+		compute_tangents(&mesh.vertices[0], &mesh.normals[0], &mesh.tex_coords[0], vertex_count,
+		                 &mesh.indices[0], mesh.indices.size(), &tangents[0]);
+	double parallel_time = (now() - start) / repeat_count;
+
+	// the new basis is angle weighted, so it only roughly matches the old averaged one
+	float max_error = 0.0f;
+	size_t mirrored_count = 0;
+	for (size_t i = 0; i < vertex_count; i++) {
+		for (int c = 0; c < 3; c++)
+			max_error = std::max(max_error, fabsf(tangents[4*i + c] - expected[3*i + c]));
+		if (tangents[4*i + 3] < 0.0f)
+			mirrored_count++;
+	}
+
+	cout << "scalar:   " << scalar_time * 1.0e3 << " ms" << endl;
+	cout << "parallel: " << parallel_time * 1.0e3 << " ms (" << scalar_time / parallel_time << "x)" << endl;
+	cout << "max difference: " << max_error << ", " << mirrored_count << " mirrored vertices" << endl;
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <sys/time.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "transform_batch.hpp"
+
+using namespace std;
+
+struct model_t {
+	glm::vec3 position;
+	glm::vec3 scale;
+	glm::quat orientation;
+};
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+static float random_float(float low, float high) {
+	return low + (high - low) * rand() / RAND_MAX;
+}
+
+// the matrices as render_model composed them from model_t, one object at a time
+void compute_transforms_glm(const vector<model_t> &models, const glm::mat4 &view_matrix,
+                            vector<glm::mat4> &model_matrices, vector<glm::mat4> &model_view_matrices, vector<glm::mat3> &normal_matrices) {
+	for (size_t i = 0; i < models.size(); i++) {
+		const model_t &model = models[i];
+		glm::mat4 rotation_matrix = glm::mat4_cast(model.orientation);
+		glm::mat4 scale_matrix = glm::scale(glm::mat4(1.0), model.scale);
+		glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0), model.position);
+
+		model_matrices[i] = translation_matrix * scale_matrix * rotation_matrix;
+		model_view_matrices[i] = view_matrix * model_matrices[i];
+		normal_matrices[i] = glm::mat3(glm::transpose(glm::inverse(model_view_matrices[i])));
+	}
+}
+
+template <typename matrix_t, int size>
+float max_difference(const vector<matrix_t> &a, const vector<matrix_t> &b) {
+	float difference = 0.0f;
+	for (size_t i = 0; i < a.size(); i++) {
+		for (int c = 0; c < size; c++) {
+			for (int r = 0; r < size; r++) {
+				// relative to the column, since the normal matrices grow with 1 / scale
+				float magnitude = std::max(1.0f, glm::length(b[i][c]));
+				difference = std::max(difference, fabsf(a[i][c][r] - b[i][c][r]) / magnitude);
+			}
+		}
+	}
+	return difference;
+}
+
+int main(int argc, char **args) {
+	size_t object_count = (argc > 1) ? atoi(args[1]) : 10000;
+	int repeat_count = (argc > 2) ? atoi(args[2]) : 100;
+
+	srand(1);
+	vector<model_t> models(object_count);
+	transform_batch_t batch;
+	batch.resize(object_count);
+	for (size_t i = 0; i < object_count; i++) {
+		model_t &model = models[i];
+		model.position = glm::vec3(random_float(-50.0f, 50.0f), random_float(-50.0f, 50.0f), random_float(-50.0f, 50.0f));
+		model.scale = glm::vec3(random_float(0.2f, 5.0f), random_float(0.2f, 5.0f), random_float(0.2f, 5.0f));
+		glm::vec4 q(random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f));
+		q = glm::normalize(q);
+		model.orientation = glm::quat(q.w, q.x, q.y, q.z);
+		batch.set(i, model.position, model.scale, model.orientation);
+	}
+	glm::mat4 view_matrix = glm::lookAt(glm::vec3(10.0f, 20.0f, 30.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	cout << object_count << " objects, " << repeat_count << " repeats" << endl;
+
+	vector<glm::mat4> expected_models(object_count), expected_model_views(object_count);
+	vector<glm::mat3> expected_normals(object_count);
+	double start = now();
+	for (int i = 0; i < repeat_count; i++)
+		compute_transforms_glm(models, view_matrix, expected_models, expected_model_views, expected_normals);
+	double glm_time = (now() - start) / repeat_count;
+
+	vector<glm::mat4> model_matrices(object_count), model_view_matrices(object_count);
+	vector<glm::mat3> normal_matrices(object_count);
+	start = now();
+	for (int i = 0; i < repeat_count; i++)
+		compute_transforms(batch, view_matrix, &model_matrices[0], &model_view_matrices[0], &normal_matrices[0]);
+	double batch_time = (now() - start) / repeat_count;
+
+	cout << "glm per object: " << glm_time * 1.0e3 << " ms, " << glm_time * 1.0e9 / object_count << " ns/object" << endl;
+	cout << "batch:          " << batch_time * 1.0e3 << " ms, " << batch_time * 1.0e9 / object_count << " ns/object ("
+	     << glm_time / batch_time << "x)" << endl;
+	cout << "max difference: model " << max_difference<glm::mat4, 4>(model_matrices, expected_models)
+	     << ", model view " << max_difference<glm::mat4, 4>(model_view_matrices, expected_model_views)
+	     << ", normal " << max_difference<glm::mat3, 3>(normal_matrices, expected_normals) << endl;
+
+	return 0;
+}
@@ -8,8 +8,7 @@
 #include <string>
 #include <sstream>
 
-#include <OpenGL/gl.h>
-#include <OpenGL/glext.h>
+#include "gl.hpp"
 #include <GL/glfw.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -18,6 +17,14 @@
 #include <openctmpp.h>
 
 #include "shader.hpp"
+#include "mesh_cache.hpp"
+#include "tangent.hpp"
+#include "mesh_optimizer.hpp"
+#include "index_buffer.hpp"
+#include "texture_loader.hpp"
+#include "render_state.hpp"
+#include "context.hpp"
+#include "profiler.hpp"
 
 #define BUFFER_OFFSET(bytes) ((GLubyte *)NULL + (bytes))
 
@@ -49,6 +56,8 @@ struct mesh_object_t {
 	array_buffer_t vertex_buffer;
 	array_buffer_t normal_buffer;
 	array_buffer_t index_buffer;
+	GLenum index_type;
+	std::vector<submesh_t> submeshes;
 	array_buffer_t tex_coord_buffer;
 	array_buffer_t tangent_buffer;
 	bool has_tex_coords;
@@ -186,79 +195,13 @@ void keyboard(int key, int action)
 }
 
 void compute_tangent_vectors(mesh_t &mesh) {	
-	int vertex_count = mesh.vertices.size() / 3;
-	int face_count = mesh.indices.size() / 3;
-	
-	std::vector<glm::vec3> tangents;
-	tangents.resize(vertex_count);
-	
-	int *tangent_counts = new int[vertex_count];
-	for (int i = 0; i < vertex_count; i++) tangent_counts[i] = 0;
-	
-	std::vector<float> &vertices = mesh.vertices;
-	std::vector<float> &normals = mesh.normals;
-	std::vector<float> &tex_coords = mesh.tex_coords;
-	std::vector<unsigned int> &indices = mesh.indices;
-	
-	for (int i = 0; i < face_count; i++) {
-		int i0 = indices[3*i];
-		int i1 = indices[3*i + 1];
-		int i2 = indices[3*i + 2];
-			
-		int j0 = 2*i0;
-		int j1 = 2*i1;
-		int j2 = 2*i2;
-		glm::vec2 uv0(tex_coords[j0], tex_coords[j0 + 1]);
-		glm::vec2 uv1(tex_coords[j1], tex_coords[j1 + 1]);
-		glm::vec2 uv2(tex_coords[j2], tex_coords[j2 + 1]);
-		glm::vec2 st1 = uv1 - uv0;
-		glm::vec2 st2 = uv2 - uv0;
-		
-		float det = st1.x*st2.y - st2.x*st1.y;
-		if (det == 0.0f) continue; // pass if inverse matrix does not exist
-		// assert(det != 0.0f);
-
-		int k0 = 3*i0;
-		int k1 = 3*i1;
-		int k2 = 3*i2;		
-		glm::vec3 p0(vertices[k0], vertices[k0 + 1], vertices[k0 + 2]);
-		glm::vec3 p1(vertices[k1], vertices[k1 + 1], vertices[k1 + 2]);
-		glm::vec3 p2(vertices[k2], vertices[k2 + 1], vertices[k2 + 2]);		
-		glm::vec3 q1 = p1 - p0;
-		glm::vec3 q2 = p2 - p0;
-		
-		float coef = 1.0f / det;
-		glm::mat3 m(
-			q1.x, q2.x, 0.0f,
-			q1.y, q2.y, 0.0f,
-			q1.z, q2.z, 0.0f
-		);
-		glm::vec3 t = coef * glm::vec3(st2.y, -st1.y, 0.0f) * m;
+	size_t vertex_count = mesh.vertices.size() / 3;
+	mesh.tangents.resize(4*vertex_count);
+	if (vertex_count == 0 || mesh.tex_coords.empty() || mesh.normals.empty())
+		return;
 
-		tangents[i0] += t;
-		tangents[i1] += t;
-		tangents[i2] += t;
-		
-		tangent_counts[i0]++;
-		tangent_counts[i1]++;
-		tangent_counts[i2]++;
-	}
-	
-	mesh.tangents.resize(3*vertex_count);
-	
-	for (int i = 0; i < vertex_count; i++) {
-		const glm::vec3 n(normals[3*i], normals[3*i + 1], normals[3*i + 2]);
-		const glm::vec3 t = tangent_counts[i] > 0 ? tangents[i] / (float)tangent_counts[i] : tangents[i];
-		tangents[i] = glm::normalize(t - glm::dot(n, t) * n);
-
-		mesh.tangents[3*i] = tangents[i].x;
-		mesh.tangents[3*i + 1] = tangents[i].y;
-		mesh.tangents[3*i + 2] = tangents[i].z;
-
-	}
-	
-	delete [] tangent_counts;
-	
+	compute_tangents(&mesh.vertices[0], &mesh.normals[0], &mesh.tex_coords[0], vertex_count,
+	                 mesh.indices.empty() ? NULL : &mesh.indices[0], mesh.indices.size(), &mesh.tangents[0]);
 }
 
 bool load_mesh_plane(mesh_t &mesh) {
@@ -349,7 +292,7 @@ bool load_mesh_cube(mesh_t &mesh) {
 	return true;
 }
 
-bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
+bool load_mesh_from_ctm_file(const char *ctm_filepath, mesh_t & mesh)
 {
   CTMimporter ctm;
 
@@ -359,19 +302,16 @@ bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
     unsigned int vertex_count = ctm.GetInteger(CTM_VERTEX_COUNT);
     unsigned int vertex_element_count = 3 * vertex_count;
     const CTMfloat *vertices = ctm.GetFloatArray(CTM_VERTICES);
-    mesh.vertices.resize(vertex_element_count);
-    std::memcpy(&mesh.vertices[0], vertices, vertex_element_count * sizeof(float));
+    mesh.vertices.assign(vertices, vertices + vertex_element_count);
 
     unsigned int face_count = ctm.GetInteger(CTM_TRIANGLE_COUNT);
     unsigned int indice_count = face_count * 3;
     const CTMuint *indices = ctm.GetIntegerArray(CTM_INDICES);
-    mesh.indices.resize(indice_count);
-    std::memcpy(&mesh.indices[0], indices, indice_count * sizeof(unsigned int));
+    mesh.indices.assign(indices, indices + indice_count);
 
     if (ctm.GetInteger(CTM_HAS_NORMALS) == CTM_TRUE) {
       const CTMfloat *normals = ctm.GetFloatArray(CTM_NORMALS);
-      mesh.normals.resize(vertex_element_count);
-      std::memcpy(&mesh.normals[0], normals, vertex_element_count * sizeof(float));
+      mesh.normals.assign(normals, normals + vertex_element_count);
     } else {
       std::cerr << "*** CTM_HAS_NORMALS == false" << std::endl;
     }
@@ -380,12 +320,19 @@ bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
     if (uv_map_count > 0) {
       const CTMfloat *tex_coords = ctm.GetFloatArray(CTM_UV_MAP_1);
       unsigned int tex_coord_element_count = 2 * vertex_count;
-      mesh.tex_coords.resize(tex_coord_element_count);
-      std::memcpy(&mesh.tex_coords[0], tex_coords, tex_coord_element_count * sizeof(float));
+      mesh.tex_coords.assign(tex_coords, tex_coords + tex_coord_element_count);
     } else {
       std::cerr << "*** UV map not found" << std::endl;
     }
 
+    mesh_optimization_t optimization;
+    optimize_mesh(mesh.indices, mesh.vertices.empty() ? NULL : &mesh.vertices[0], 3, vertex_count, optimization);
+    remap_vertex_stream(mesh.vertices, 3, optimization.remap, optimization.vertex_count);
+    remap_vertex_stream(mesh.normals, 3, optimization.remap, optimization.vertex_count);
+    remap_vertex_stream(mesh.tex_coords, 2, optimization.remap, optimization.vertex_count);
+    optimization.report(std::cout, ctm_filepath);
+
+    compute_tangent_vectors(mesh);
     return true;
   }
   catch(ctm_error & e) {
@@ -394,6 +341,24 @@ bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
   }
 }
 
+bool read_mesh_source(const char *ctm_filepath, void *mesh)
+{
+  return load_mesh_from_ctm_file(ctm_filepath, *static_cast<mesh_t *>(mesh));
+}
+
+bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
+{
+  mesh_cache_t::stream_t streams[] = {
+    { mesh_cache_t::POSITIONS, &mesh.vertices },
+    { mesh_cache_t::NORMALS, &mesh.normals },
+    { mesh_cache_t::TEX_COORDS, &mesh.tex_coords },
+    { mesh_cache_t::TANGENTS, &mesh.tangents }
+  };
+  size_t stream_count = sizeof(streams) / sizeof(streams[0]);
+  return mesh_cache_t::read_streams(ctm_filepath, mesh.indices, std::vector<mesh_cache_t::stream_t>(streams, streams + stream_count),
+                                    read_mesh_source, &mesh);
+}
+
 bool build_shader_program(shader_program_t &shader_program, const char *vertex_shader_filepath, const char *fragment_shader_filepath) {
   if (!shader_program.add_shader_from_source_file(GL_VERTEX_SHADER, vertex_shader_filepath)) {
 		std::cerr << "*** " << vertex_shader_filepath << std::endl;
@@ -436,9 +401,11 @@ bool build_mesh_object(const mesh_t &mesh, mesh_object_t &object) {
   glBufferData(GL_ARRAY_BUFFER, object.normal_buffer.count * sizeof(float), &mesh.normals[0], GL_STATIC_DRAW);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+  std::vector<unsigned char> indices;
+  object.index_type = build_index_buffer(&mesh.indices[0], mesh.indices.size(), mesh.vertices.size() / 3, true, indices, object.submeshes);
   glGenBuffers(1, &object.index_buffer.handle);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.index_buffer.handle);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, object.index_buffer.count * sizeof(unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), &indices[0], GL_STATIC_DRAW);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	if (object.has_tex_coords) {
@@ -483,49 +450,38 @@ void render_object(const mesh_object_t & object)
 	object.shader_program->set_uniform_value("material.specular", object.material.specular);
 	object.shader_program->set_uniform_value("material.shininess", object.material.shininess);
 
-  GLsizei stride = 3 * sizeof(float);
-  glBindBuffer(GL_ARRAY_BUFFER, object.vertex_buffer.handle);
-  glVertexAttribPointer(position_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(0));
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  glBindBuffer(GL_ARRAY_BUFFER, object.normal_buffer.handle);
-  glVertexAttribPointer(normal_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(0));
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	if (object.has_tex_coords) {
-  	glBindBuffer(GL_ARRAY_BUFFER, object.tex_coord_buffer.handle);
-  	glVertexAttribPointer(tex_coord_location, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), BUFFER_OFFSET(0));
-  	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	}
-	
-	if (object.has_tangents) {
-  	glBindBuffer(GL_ARRAY_BUFFER, object.tangent_buffer.handle);
-  	glVertexAttribPointer(tangent_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(0));
-  	glBindBuffer(GL_ARRAY_BUFFER, 0);		
-	}
-
+	// textures, buffers and arrays stay bound for the next draw; RENDER_STATE skips rebinding what is already bound
 	for (size_t i = 0; i < object.textures.size(); i++) {
 		const texture_t &tex = object.textures[i];
-		glActiveTexture(texture_unit_names[tex.unit_id]);
-		glBindTexture(GL_TEXTURE_2D, tex.handle);
+		RENDER_STATE.bind_texture(texture_unit_names[tex.unit_id], GL_TEXTURE_2D, tex.handle);
 	}
 
-  glEnableVertexAttribArray(position_location);
-  glEnableVertexAttribArray(normal_location);
-	if (object.has_tex_coords) glEnableVertexAttribArray(tex_coord_location);
-	if (object.has_tangents) glEnableVertexAttribArray(tangent_location);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.index_buffer.handle);
-  glDrawElements(GL_TRIANGLES, object.index_buffer.count, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	if (object.has_tangents) glDisableVertexAttribArray(tangent_location);
-	if (object.has_tex_coords) glDisableVertexAttribArray(tex_coord_location);
-  glDisableVertexAttribArray(normal_location);
-  glDisableVertexAttribArray(position_location);
+	GLuint attrib_arrays = render_state_t::attrib_array_bit(position_location) | render_state_t::attrib_array_bit(normal_location);
+	if (object.has_tex_coords) attrib_arrays |= render_state_t::attrib_array_bit(tex_coord_location);
+	if (object.has_tangents) attrib_arrays |= render_state_t::attrib_array_bit(tangent_location);
+	RENDER_STATE.bind_vertex_array(0);
+	RENDER_STATE.set_vertex_attrib_arrays(attrib_arrays);
+  RENDER_STATE.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, object.index_buffer.handle);
+	// one draw per submesh, each with the attribute pointers moved to its first vertex
+  GLsizei stride = 3 * sizeof(float);
+	for (size_t i = 0; i < object.submeshes.size(); i++) {
+		const submesh_t &submesh = object.submeshes[i];
+		RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, object.vertex_buffer.handle);
+		glVertexAttribPointer(position_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(submesh.base_vertex * stride));
 
-	for (size_t i = 0; i < object.textures.size(); i++) {
-		const texture_t &tex = object.textures[i];
-		glActiveTexture(texture_unit_names[tex.unit_id]);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, object.normal_buffer.handle);
+		glVertexAttribPointer(normal_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(submesh.base_vertex * stride));
+
+		if (object.has_tex_coords) {
+			RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, object.tex_coord_buffer.handle);
+			glVertexAttribPointer(tex_coord_location, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), BUFFER_OFFSET(submesh.base_vertex * 2 * sizeof(float)));
+		}
+	
+		if (object.has_tangents) {
+			RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, object.tangent_buffer.handle);
+			glVertexAttribPointer(tangent_location, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), BUFFER_OFFSET(submesh.base_vertex * 4 * sizeof(float)));
+		}
+		glDrawElements(GL_TRIANGLES, submesh.index_count, object.index_type, BUFFER_OFFSET(submesh.first_index * index_type_size(object.index_type)));
 	}
 
 }
@@ -534,7 +490,7 @@ bool build_texutre_from_file(const char *filepath, texture_t &tex) {
   GLuint texture_handle;
 	glGenTextures(1, &texture_handle);
   glBindTexture(GL_TEXTURE_2D, texture_handle);
-  if (!glfwLoadTexture2D(filepath, GLFW_BUILD_MIPMAPS_BIT))
+  if (!load_texture_2d_from_file(filepath, true))
 		return false;
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -587,31 +543,27 @@ void trackback_state_initialize(trackball_state_t &trackball_state) {
 
 int main(int argc, char **args)
 {
+  context_t context(640, 480, 16);
+  context.parse_arguments(argc, args);
+  profiler_t profiler;
+  profiler.set_enabled(!context.profile_filepath().empty());
   const char *ctm_filepath = (argc > 1) ? args[1] : "teapot.ctm";
 
 	trackback_state_initialize(camera_rotation);
 	trackback_state_initialize(light_rotation);
 	current_trackball_state = &camera_rotation;
 
-  if (!glfwInit()) {
-    std::cerr << "Failed to initialize GLFW" << std::endl;
+  if (!context.open("Spinning Teapot")) {
     exit(EXIT_FAILURE);
   }
-
-  int depth_bits = 16;
-  if (!glfwOpenWindow(640, 480, 0, 0, 0, 0, depth_bits, 0, GLFW_WINDOW)) {
-    std::cerr << "Failed to open GLFW window" << std::endl;
-    glfwTerminate();
-    exit(EXIT_FAILURE);
+  screen_width = context.width();
+  screen_height = context.height();
+  if (!context.is_headless()) {
+    glfwSetWindowSizeCallback(resize);
+    glfwSetKeyCallback(keyboard);
+    glfwSetMouseButtonCallback(mouse);
+    glfwSetMousePosCallback(motion);
   }
-  glfwGetWindowSize(&screen_width, &screen_height);
-  glfwSetWindowSizeCallback(resize);
-  glfwSetKeyCallback(keyboard);
-  glfwSetMouseButtonCallback(mouse);
-  glfwSetMousePosCallback(motion);
-  glfwSetWindowTitle("Spinning Teapot");
-  glfwEnable(GLFW_STICKY_KEYS);
-  glfwSwapInterval(1);
 
 	// Shaders
 	shader_program_t phong_shader;
@@ -628,7 +580,7 @@ int main(int argc, char **args)
 	load_mesh_cube(mesh_floor);
   mesh_object_t floor;
   if (! build_mesh_object(mesh_floor, floor) ) {
-    glfwTerminate();
+    context.close();
     exit(EXIT_FAILURE);	
 	}
 
@@ -636,19 +588,18 @@ int main(int argc, char **args)
 	load_mesh_plane(mesh_plane);
   mesh_object_t plane;
   if (! build_mesh_object(mesh_plane, plane) ) {
-    glfwTerminate();
+    context.close();
     exit(EXIT_FAILURE);	
 	}
 
 	mesh_t mesh_teapot;
 	if (! load_mesh_from_file(ctm_filepath, mesh_teapot) ) {
-	  glfwTerminate();
+	  context.close();
     exit(EXIT_FAILURE);		
 	}
-	compute_tangent_vectors(mesh_teapot);
   mesh_object_t teapot;
   if (! build_mesh_object(mesh_teapot, teapot) ) {
-	  glfwTerminate();
+	  context.close();
     exit(EXIT_FAILURE);
 	}
 
@@ -658,7 +609,7 @@ int main(int argc, char **args)
 	tex.unit_id = 1;
 	if (! build_texutre_from_file(texture_filepath, tex)) {
 		std::cout << "Failed to load texture: " << texture_filepath << std::endl;
-	  glfwTerminate();
+	  context.close();
 	  exit(EXIT_FAILURE);		
 	}
 
@@ -697,11 +648,14 @@ int main(int argc, char **args)
 	
 	plane.textures.push_back(depth_tex_buffer);
 
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
+	RENDER_STATE.invalidate(); // the setup above binds with plain GL
+	RENDER_STATE.set_capability(GL_TEXTURE_2D, true);
+	RENDER_STATE.set_capability(GL_DEPTH_TEST, true);
+	RENDER_STATE.set_capability(GL_CULL_FACE, true);
+
+  while (context.is_running()) {
+		profiler.begin_frame();
 
-  do {
 		//--- Transform
 		glm::vec3 light_position = glm::mat3_cast(light_rotation.orientation) * glm::vec3(0.0f, 5.0f, 0.0f);
 		glm::vec3 light_center(0.0f, 0.0f, 0.0f);
@@ -713,8 +667,9 @@ int main(int argc, char **args)
 		plane.matrix = glm::scale(glm::mat4(1.0f), glm::vec3(screen_width, screen_height, 1.0f));
 		
 		//--- Render
-		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fb_handle);
+		RENDER_STATE.bind_frame_buffer(fb_handle);
 		{
+			PROFILE_GPU_SCOPE(profiler, "shadow pass");
 	    __projection_matrix = glm::perspective(30.0f, (float) screen_width / (float) screen_height, 0.5f, 30.0f);
 			__view_matrix = light_view_matrix;
 			light_pov_matrix = bias * __projection_matrix * light_view_matrix;
@@ -725,20 +680,19 @@ int main(int argc, char **args)
 			teapot.shader_program = &render_buffer_shader;
 			teapot.shader_program->bind();
 			render_object(teapot);
-			teapot.shader_program->release();
 			floor.shader_program = &render_buffer_shader;
 			floor.shader_program->bind();
     	render_object(floor);
-			floor.shader_program->release();		
 		}
-		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);		
+		RENDER_STATE.bind_frame_buffer(context.frame_buffer_handle());		
 	
 #ifdef DEPTH_BUFFER_DEBUG
 		{
+			PROFILE_GPU_SCOPE(profiler, "depth buffer debug pass");
 			__projection_matrix = glm::ortho(0.0f, (float)screen_width, 0.0f, (float)screen_height, 0.5f, 1.0f);
 			__view_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.0f));
 			
-			glDisable(GL_DEPTH_TEST);
+			RENDER_STATE.set_capability(GL_DEPTH_TEST, false);
 			glClear(GL_COLOR_BUFFER_BIT);		
     	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
     	glViewport(0, 0, screen_width, screen_height);	
@@ -746,14 +700,14 @@ int main(int argc, char **args)
 			plane.shader_program->bind();	
 			plane.shader_program->set_uniform_value("texture2", depth_tex_buffer.unit_id); 
 	  	render_object(plane);
-			plane.shader_program->release();
-			glEnable(GL_DEPTH_TEST);
+			RENDER_STATE.set_capability(GL_DEPTH_TEST, true);
 		}
 #endif
 
 #ifndef DEPTH_BUFFER_DEBUG
 		{			
-			glCullFace(GL_BACK);
+			PROFILE_GPU_SCOPE(profiler, "main pass");
+			RENDER_STATE.cull_face(GL_BACK);
 			glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 			glClearDepth(1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -771,7 +725,6 @@ int main(int argc, char **args)
 			teapot.shader_program->set_uniform_value("bump_size", 0.15f);
 			teapot.shader_program->set_uniform_value("specular_factor", 0.5f);
 			render_object(teapot);
-			teapot.shader_program->release();
 #else
 			teapot.shader_program = &phong_shader;
 			teapot.shader_program->bind();		
@@ -780,7 +733,6 @@ int main(int argc, char **args)
 			teapot.shader_program->set_uniform_value("texture1", tex.unit_id); 
 			teapot.shader_program->set_uniform_value("texture2", depth_tex_buffer.unit_id); 
 			render_object(teapot);
-			teapot.shader_program->release();
 #endif
 
 			floor.shader_program = &phong_shader;
@@ -789,16 +741,25 @@ int main(int argc, char **args)
 			floor.shader_program->set_uniform_value("light_pov_matrix", light_pov_matrix);
 			floor.shader_program->set_uniform_value("texture2", depth_tex_buffer.unit_id); 
 	    render_object(floor);
-			floor.shader_program->release();	
 		}
 #endif
 
-    glfwSwapBuffers();
+    {
+      PROFILE_SCOPE(profiler, "swap buffers");
+      context.swap_buffers();
+    }
+
+    profiler.end_frame();
+  }
 
+  if (profiler.is_enabled()) {
+    profiler.write_trace(context.profile_filepath().c_str());
+    profiler.report(std::cout);
+    std::cout << RENDER_STATE.counters() << std::endl;
   }
-  while (glfwGetKey(GLFW_KEY_ESC) != GLFW_PRESS && glfwGetWindowParam(GLFW_OPENED));
+  profiler.delete_queries();
 
-  glfwTerminate();
+  context.close();
 
   return 0;
 }
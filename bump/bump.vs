@@ -12,7 +12,7 @@ uniform vec3 light_world_position;
 attribute vec3 vertex_position;
 attribute vec3 vertex_normal;
 attribute vec2 vertex_tex_coord;
-attribute vec3 vertex_tangent;
+attribute vec4 vertex_tangent;
 
 varying vec2 tex_coord;
 varying vec3 light_direction;
@@ -21,8 +21,8 @@ varying vec3 eye_direction;
 void main(void) {
 	vec4 v = model_view_matrix * vec4(vertex_position, 1.0);
 	vec3 n = normalize(normal_matrix * vertex_normal);
-	vec3 t = normalize(normal_matrix * vertex_tangent);
-	vec3 b = cross(t, n);
+	vec3 t = normalize(normal_matrix * vertex_tangent.xyz);
+	vec3 b = vertex_tangent.w * cross(n, t);
 
 	float x, y, z;
 	x = dot(light_world_position, t);
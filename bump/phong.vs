@@ -11,7 +11,7 @@ uniform vec3 light_world_position;
 attribute vec3 vertex_position;
 attribute vec3 vertex_normal;
 attribute vec2 vertex_tex_coord;
-attribute vec3 vertex_tangent;
+attribute vec4 vertex_tangent;
 
 varying vec3 position;
 varying vec3 normal;
@@ -0,0 +1,48 @@
+#include <cmath>
+#include "bounds.hpp"
+
+aabb_t compute_bounds(const vertex_t *vertices, size_t vertex_count) {
+	aabb_t bounds;
+	for (size_t i = 0; i < vertex_count; i++)
+		bounds.extend(glm::vec3(vertices[i].position));
+	return bounds;
+}
+
+aabb_t transform_bounds(const aabb_t &bounds, const glm::mat4 &transform) {
+	if (bounds.is_empty())
+		return bounds;
+	glm::vec3 center = glm::vec3(transform * glm::vec4(bounds.center(), 1.0f));
+	glm::vec3 extent = bounds.extent();
+	glm::vec3 transformed_extent(0.0f);
+	for (int c = 0; c < 3; c++) {
+		for (int r = 0; r < 3; r++)
+			transformed_extent[r] += fabsf(transform[c][r]) * extent[c];
+	}
+	return aabb_t(center - transformed_extent, center + transformed_extent);
+}
+
+frustum_t::frustum_t(const glm::mat4 &view_projection_matrix) {
+	const glm::mat4 &m = view_projection_matrix;
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+		rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+	// left, right, bottom, top, near, far
+	for (int i = 0; i < 3; i++) {
+		planes[2 * i] = rows[3] + rows[i];
+		planes[2 * i + 1] = rows[3] - rows[i];
+	}
+}
+
+bool frustum_t::intersects(const aabb_t &bounds) const {
+	if (bounds.is_empty())
+		return false;
+	glm::vec3 center = bounds.center(), extent = bounds.extent();
+	for (int i = 0; i < PLANE_COUNT; i++) {
+		const glm::vec4 &plane = planes[i];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float radius = fabsf(plane.x) * extent.x + fabsf(plane.y) * extent.y + fabsf(plane.z) * extent.z;
+		if (distance + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
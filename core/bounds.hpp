@@ -0,0 +1,50 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <cfloat>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "vertex_format.hpp"
+
+struct aabb_t {
+	glm::vec3 min;
+	glm::vec3 max;
+
+	// empty until extended
+	aabb_t() : min(FLT_MAX), max(-FLT_MAX) { }
+	aabb_t(const glm::vec3 &min, const glm::vec3 &max) : min(min), max(max) { }
+
+	bool is_empty() const { return min.x > max.x; }
+	glm::vec3 center() const { return 0.5f * (min + max); }
+	glm::vec3 extent() const { return 0.5f * (max - min); } // half the size
+
+	void extend(const glm::vec3 &point) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+	void extend(const aabb_t &bounds) {
+		min = glm::min(min, bounds.min);
+		max = glm::max(max, bounds.max);
+	}
+};
+
+aabb_t compute_bounds(const vertex_t *vertices, size_t vertex_count);
+// the box around bounds placed by transform
+aabb_t transform_bounds(const aabb_t &bounds, const glm::mat4 &transform);
+
+// The six planes of a view frustum, taken from the rows of a projection * view matrix,
+// with their normals pointing inside.
+struct frustum_t {
+	enum { PLANE_COUNT = 6 };
+
+	glm::vec4 planes[PLANE_COUNT];
+
+	frustum_t() { }
+	explicit frustum_t(const glm::mat4 &view_projection_matrix);
+
+	// false only when the box lies entirely outside one of the planes
+	bool intersects(const aabb_t &bounds) const;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include "bvh.hpp"
+
+using namespace std;
+
+ostream& operator<<(ostream &output, const cull_stats_t &stats) {
+	output << "culling: " << stats.visible_count << " of " << stats.object_count << " objects visible, "
+	       << stats.culled_count << " culled, " << stats.box_tests << " box tests";
+	return output;
+}
+
+namespace {
+
+enum classification_t {
+	OUTSIDE,
+	INTERSECTING,
+	INSIDE
+};
+
+// the frustum's planes laid out for classify(), padded to eight with planes every box is
+// inside of
+class plane_set_t {
+
+public:
+
+	plane_set_t(const frustum_t &frustum) {
+		glm::vec4 planes[8];
+		for (int i = 0; i < 8; i++)
+			planes[i] = i < frustum_t::PLANE_COUNT ? frustum.planes[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+#ifdef __SSE__
+		for (int k = 0; k < 2; k++) {
+			const glm::vec4 *p = planes + 4 * k;
+			__x[k] = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+			__y[k] = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+			__z[k] = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+			__w[k] = _mm_setr_ps(p[0].w, p[1].w, p[2].w, p[3].w);
+			__abs_x[k] = _mm_setr_ps(fabsf(p[0].x), fabsf(p[1].x), fabsf(p[2].x), fabsf(p[3].x));
+			__abs_y[k] = _mm_setr_ps(fabsf(p[0].y), fabsf(p[1].y), fabsf(p[2].y), fabsf(p[3].y));
+			__abs_z[k] = _mm_setr_ps(fabsf(p[0].z), fabsf(p[1].z), fabsf(p[2].z), fabsf(p[3].z));
+		}
+#else
+		for (int i = 0; i < 8; i++)
+			__planes[i] = planes[i];
+#endif
+	}
+
+	classification_t classify(const aabb_t &bounds) const {
+		glm::vec3 center = bounds.center(), extent = bounds.extent();
+#ifdef __SSE__
+		__m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+		__m128 ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+		__m128 zero = _mm_setzero_ps();
+		__m128 outside = zero, partial = zero;
+		for (int k = 0; k < 2; k++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(__x[k], cx), _mm_mul_ps(__y[k], cy)), _mm_add_ps(_mm_mul_ps(__z[k], cz), __w[k]));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(__abs_x[k], ex), _mm_mul_ps(__abs_y[k], ey)), _mm_mul_ps(__abs_z[k], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+			partial = _mm_or_ps(partial, _mm_cmplt_ps(_mm_sub_ps(distance, radius), zero));
+		}
+		if (_mm_movemask_ps(outside))
+			return OUTSIDE;
+		return _mm_movemask_ps(partial) ? INTERSECTING : INSIDE;
+#else
+		classification_t classification = INSIDE;
+		for (int i = 0; i < 8; i++) {
+			const glm::vec4 &plane = __planes[i];
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float radius = fabsf(plane.x) * extent.x + fabsf(plane.y) * extent.y + fabsf(plane.z) * extent.z;
+			if (distance + radius < 0.0f)
+				return OUTSIDE;
+			if (distance - radius < 0.0f)
+				classification = INTERSECTING;
+		}
+		return classification;
+#endif
+	}
+
+private:
+
+#ifdef __SSE__
+	__m128 __x[2], __y[2], __z[2], __w[2];
+	__m128 __abs_x[2], __abs_y[2], __abs_z[2];
+#else
+	glm::vec4 __planes[8];
+#endif
+
+};
+
+struct center_less_t {
+	const vector<glm::vec3> *centers;
+	int axis;
+	bool operator()(size_t a, size_t b) const { return (*centers)[a][axis] < (*centers)[b][axis]; }
+};
+
+}
+
+void bvh_t::build(const vector<aabb_t> &bounds) {
+	__nodes.clear();
+	__objects.clear();
+	__bounds = bounds;
+	vector<glm::vec3> centers(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++) {
+		if (bounds[i].is_empty())
+			continue;
+		__objects.push_back(i);
+		centers[i] = bounds[i].center();
+	}
+	__stats = cull_stats_t();
+	__stats.object_count = bounds.size();
+	if (!__objects.empty())
+		build_node(bounds, centers, 0, __objects.size());
+}
+
+// split at the median of the centers along their longest axis
+size_t bvh_t::build_node(const vector<aabb_t> &bounds, const vector<glm::vec3> &centers, size_t begin, size_t end) {
+	size_t index = __nodes.size();
+	__nodes.push_back(node_t());
+	aabb_t node_bounds, center_bounds;
+	for (size_t i = begin; i < end; i++) {
+		node_bounds.extend(bounds[__objects[i]]);
+		center_bounds.extend(centers[__objects[i]]);
+	}
+
+	size_t second_child = 0;
+	if (end - begin > MAX_LEAF_SIZE) {
+		glm::vec3 size = center_bounds.max - center_bounds.min;
+		center_less_t less;
+		less.centers = &centers;
+		less.axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+		size_t middle = begin + (end - begin) / 2;
+		nth_element(__objects.begin() + begin, __objects.begin() + middle, __objects.begin() + end, less);
+		build_node(bounds, centers, begin, middle);
+		second_child = build_node(bounds, centers, middle, end);
+	}
+
+	node_t &node = __nodes[index];
+	node.bounds = node_bounds;
+	node.first_object = begin;
+	node.object_count = end - begin;
+	node.second_child = second_child;
+	return index;
+}
+
+// children come after their parents, so a pass from the back sees them first
+void bvh_t::refit(const vector<aabb_t> &bounds) {
+	__bounds = bounds;
+	for (size_t i = __nodes.size(); i-- > 0; ) {
+		node_t &node = __nodes[i];
+		node.bounds = aabb_t();
+		if (node.second_child == 0) {
+			for (size_t j = node.first_object; j < node.first_object + node.object_count; j++)
+				node.bounds.extend(__bounds[__objects[j]]);
+		} else {
+			node.bounds.extend(__nodes[i + 1].bounds);
+			node.bounds.extend(__nodes[node.second_child].bounds);
+		}
+	}
+}
+
+void bvh_t::cull(const frustum_t &frustum, vector<size_t> &visible) {
+	visible.clear();
+	plane_set_t planes(frustum);
+	size_t box_tests = 0;
+	__stack.clear();
+	if (!__nodes.empty())
+		__stack.push_back(0);
+	while (!__stack.empty()) {
+		uint32_t index = __stack.back();
+		__stack.pop_back();
+		const node_t &node = __nodes[index];
+		box_tests++;
+		classification_t classification = planes.classify(node.bounds);
+		if (classification == OUTSIDE)
+			continue;
+
+		if (classification == INSIDE) {
+			visible.insert(visible.end(), __objects.begin() + node.first_object, __objects.begin() + node.first_object + node.object_count);
+		} else if (node.second_child == 0) {
+			for (size_t j = node.first_object; j < node.first_object + node.object_count; j++) {
+				box_tests++;
+				if (planes.classify(__bounds[__objects[j]]) != OUTSIDE)
+					visible.push_back(__objects[j]);
+			}
+		} else {
+			__stack.push_back(node.second_child);
+			__stack.push_back(index + 1);
+		}
+	}
+
+	__stats.visible_count = visible.size();
+	__stats.culled_count = __stats.object_count - visible.size();
+	__stats.box_tests = box_tests;
+}
@@ -0,0 +1,65 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <vector>
+#include <iostream>
+#include <cstddef>
+#include <stdint.h>
+
+#include "bounds.hpp"
+
+struct cull_stats_t {
+	size_t object_count;
+	size_t visible_count;   // in the last cull()
+	size_t culled_count;
+	size_t box_tests;       // of nodes and objects against the frustum
+
+	cull_stats_t() : object_count(0), visible_count(0), culled_count(0), box_tests(0) { }
+};
+
+std::ostream& operator<<(std::ostream &output, const cull_stats_t &stats);
+
+// A bounding volume hierarchy over the boxes of a scene's objects, to find those in a view
+// frustum without testing every box. The nodes are in one array, each with its first child
+// right after it, and each node's objects are one run of the object array, so a node
+// entirely inside the frustum is taken whole without visiting what is below it. Boxes are
+// tested against four of the planes at once with SSE where available.
+class bvh_t {
+
+public:
+
+	enum { MAX_LEAF_SIZE = 4 };
+
+	// objects are named by their index in bounds
+	void build(const std::vector<aabb_t> &bounds);
+	// for objects that moved without leaving their neighbours behind: the boxes of the
+	// nodes are recomputed and the tree is kept
+	void refit(const std::vector<aabb_t> &bounds);
+
+	// the objects whose boxes may be in the frustum, in no particular order
+	void cull(const frustum_t &frustum, std::vector<size_t> &visible);
+
+	size_t size() const { return __objects.size(); }
+	size_t node_count() const { return __nodes.size(); }
+	const cull_stats_t& stats() const { return __stats; }
+
+private:
+
+	struct node_t {
+		aabb_t bounds;
+		uint32_t first_object;  // in __objects
+		uint32_t object_count;
+		uint32_t second_child;  // 0 for leaves, the first child being the next node
+	};
+
+	size_t build_node(const std::vector<aabb_t> &bounds, const std::vector<glm::vec3> &centers, size_t begin, size_t end);
+
+	std::vector<node_t> __nodes;
+	std::vector<size_t> __objects;  // grouped by node, skipping empty boxes
+	std::vector<aabb_t> __bounds;   // by object
+	std::vector<uint32_t> __stack;
+	cull_stats_t __stats;
+
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+#include "compressed_texture.hpp"
+#include "mapped_file.hpp"
+
+using namespace std;
+
+#define FOURCC(a, b, c, d)  ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+enum {
+	DDSD_CAPS = 0x1,
+	DDSD_HEIGHT = 0x2,
+	DDSD_WIDTH = 0x4,
+	DDSD_PIXELFORMAT = 0x1000,
+	DDSD_MIPMAPCOUNT = 0x20000,
+	DDSD_LINEARSIZE = 0x80000,
+	DDPF_FOURCC = 0x4,
+	DDSCAPS_COMPLEX = 0x8,
+	DDSCAPS_TEXTURE = 0x1000,
+	DDSCAPS_MIPMAP = 0x400000
+};
+
+struct dds_pixel_format_t {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t four_cc;
+	uint32_t rgb_bit_count;
+	uint32_t masks[4];
+};
+
+struct dds_header_t {
+	uint32_t magic;
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t linear_size;
+	uint32_t depth;
+	uint32_t mip_map_count;
+	uint32_t reserved[11];
+	dds_pixel_format_t pixel_format;
+	uint32_t caps[4];
+	uint32_t reserved2;
+};
+
+static const uint32_t DDS_MAGIC = FOURCC('D', 'D', 'S', ' ');
+
+static const uint32_t FOURCCS[] = {
+	FOURCC('D', 'X', 'T', '1'), // TEXTURE_COMPRESSION_BC1
+	FOURCC('D', 'X', 'T', '5'), // TEXTURE_COMPRESSION_BC3
+	FOURCC('B', 'C', '5', 'U')  // TEXTURE_COMPRESSION_BC5
+};
+
+compressed_texture_file_t::compressed_texture_file_t() : __data(NULL), __size(0), __compression(TEXTURE_COMPRESSION_BC1) {
+}
+
+compressed_texture_file_t::~compressed_texture_file_t() {
+	close();
+}
+
+bool compressed_texture_file_t::open(const char *filepath) {
+	close();
+
+	__data = map_file(filepath, __size);
+	if (__data == NULL)
+		return false;
+
+	const dds_header_t *header = static_cast<const dds_header_t *>(__data);
+	bool valid = __size >= sizeof(dds_header_t)
+		&& header->magic == DDS_MAGIC
+		&& header->size == sizeof(dds_header_t) - sizeof(uint32_t)
+		&& (header->pixel_format.flags & DDPF_FOURCC) != 0
+		&& header->width > 0 && header->height > 0;
+
+	bool known = false;
+	for (size_t i = 0; valid && i < sizeof(FOURCCS) / sizeof(FOURCCS[0]); i++) {
+		if (header->pixel_format.four_cc == FOURCCS[i]) {
+			__compression = (texture_compression_t)i;
+			known = true;
+		}
+	}
+
+	size_t offset = sizeof(dds_header_t);
+	size_t level_count = (valid && (header->flags & DDSD_MIPMAPCOUNT) && header->mip_map_count > 0) ? header->mip_map_count : 1;
+	size_t width = valid ? header->width : 0, height = valid ? header->height : 0;
+	for (size_t i = 0; valid && known && i < level_count; i++) {
+		level_t level;
+		level.width = width;
+		level.height = height;
+		level.size = compressed_image_size(__compression, width, height);
+		level.data = static_cast<const unsigned char *>(__data) + offset;
+		valid = level.size <= __size - offset;
+		offset += level.size;
+		__levels.push_back(level);
+
+		if (width == 1 && height == 1)
+			break;
+		width = max(width / 2, (size_t)1);
+		height = max(height / 2, (size_t)1);
+	}
+
+	if (!valid || !known) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void compressed_texture_file_t::close() {
+	if (__data != NULL)
+		unmap_file(__data, __size);
+	__data = NULL;
+	__size = 0;
+	__levels.clear();
+}
+
+bool compressed_texture_file_t::write(const char *filepath, texture_compression_t compression, const vector<level_t> &levels) {
+	if (levels.empty())
+		return false;
+
+	dds_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.magic = DDS_MAGIC;
+	header.size = sizeof(dds_header_t) - sizeof(uint32_t);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+	header.height = levels[0].height;
+	header.width = levels[0].width;
+	header.linear_size = levels[0].size;
+	header.pixel_format.size = sizeof(dds_pixel_format_t);
+	header.pixel_format.flags = DDPF_FOURCC;
+	header.pixel_format.four_cc = FOURCCS[compression];
+	header.caps[0] = DDSCAPS_TEXTURE;
+	if (levels.size() > 1) {
+		header.flags |= DDSD_MIPMAPCOUNT;
+		header.mip_map_count = levels.size();
+		header.caps[0] |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	}
+
+	// written aside and renamed, so a reader never maps a half written file
+	string temporary_filepath = string(filepath) + ".tmp";
+	FILE *file = fopen(temporary_filepath.c_str(), "wb");
+	if (file == NULL)
+		return false;
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	for (size_t i = 0; written && i < levels.size(); i++)
+		written = fwrite(levels[i].data, 1, levels[i].size, file) == levels[i].size;
+	written = (fclose(file) == 0) && written;
+
+	if (!written || rename(temporary_filepath.c_str(), filepath) != 0) {
+		remove(temporary_filepath.c_str());
+		return false;
+	}
+	return true;
+}
+
+string compressed_texture_file_t::filepath_for(const char *source_filepath) {
+	string filepath(source_filepath);
+	// a '.' before the last '/' belongs to a directory, as in "./textures/name"
+	size_t dot = filepath.rfind('.');
+	size_t slash = filepath.rfind('/');
+	if (dot != string::npos && (slash == string::npos || dot > slash))
+		filepath.erase(dot);
+	return filepath + ".dds";
+}
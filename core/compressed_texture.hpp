@@ -0,0 +1,51 @@
+#ifndef COMPRESSED_TEXTURE_HPP
+#define COMPRESSED_TEXTURE_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "texture_compressor.hpp"
+
+// A block compressed texture with its mip chain, in a DDS file (FourCC DXT1, DXT5 or BC5U).
+// The file is memory mapped, so the levels go to glCompressedTexImage2D without a copy.
+class compressed_texture_file_t {
+
+public:
+
+	struct level_t {
+		size_t width;
+		size_t height;
+		size_t size;
+		const unsigned char *data;
+	};
+
+	compressed_texture_file_t();
+	~compressed_texture_file_t();
+
+	// fails when the file is missing, not a DDS file or in a compression other than BC1, BC3 and BC5
+	bool open(const char *filepath);
+	void close();
+	bool is_open() const { return __data != NULL; }
+
+	texture_compression_t compression() const { return __compression; }
+	size_t level_count() const { return __levels.size(); }
+	const level_t& level(size_t index) const { return __levels[index]; }
+
+	static bool write(const char *filepath, texture_compression_t compression, const std::vector<level_t> &levels);
+	// the .dds file cooked from source_filepath, its extension replaced or ".dds" appended
+	// when its name has none
+	static std::string filepath_for(const char *source_filepath);
+
+private:
+
+	compressed_texture_file_t(const compressed_texture_file_t &);
+	compressed_texture_file_t& operator=(const compressed_texture_file_t &);
+
+	void *__data;
+	size_t __size;
+	texture_compression_t __compression;
+	std::vector<level_t> __levels;
+
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <sys/time.h>
+#include "gl.hpp"
+#include <GL/glfw.h>
+#ifdef USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#include "context.hpp"
+#include "fbo.hpp"
+
+using namespace std;
+
+static double current_time() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+context_t::context_t(int width, int height, int depth_bits) {
+	__width = width;
+	__height = height;
+	__depth_bits = depth_bits;
+	__headless = false;
+	__vertex_format = VERTEX_FORMAT_FLOAT;
+	__opened = false;
+	__frame_count = 60;
+	__frame_index = 0;
+	__start_time = 0;
+	__frame_buffer = NULL;
+	__display = NULL;
+	__context = NULL;
+}
+
+context_t::~context_t() {
+	close();
+}
+
+void context_t::parse_arguments(int &argc, char **args) {
+	int n = 1;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(args[i], "--headless") == 0) {
+			__headless = true;
+		} else if (strcmp(args[i], "--frames") == 0 && i + 1 < argc) {
+			__frame_count = atoi(args[++i]);
+		} else if (strcmp(args[i], "--snapshot") == 0 && i + 1 < argc) {
+			__snapshot_filepath = args[++i];
+		} else if (strcmp(args[i], "--profile") == 0 && i + 1 < argc) {
+			__profile_filepath = args[++i];
+		} else if (strcmp(args[i], "--vertex-format") == 0 && i + 1 < argc) {
+			if (!vertex_layout_t::parse(args[++i], __vertex_format))
+				cerr << "*** unknown vertex format: " << args[i] << endl;
+		} else {
+			args[n++] = args[i];
+		}
+	}
+	argc = n;
+	args[n] = NULL;
+}
+
+bool context_t::open(const char *title) {
+	__opened = __headless ? open_headless() : open_window(title);
+	__start_time = current_time();
+	return __opened;
+}
+
+bool context_t::open_window(const char *title) {
+  if (!glfwInit()) {
+		cerr << "Failed to initialize GLFW" << endl;
+    return false;
+  }
+
+  if (!glfwOpenWindow(__width, __height, 0, 0, 0, 0, __depth_bits, 0, GLFW_WINDOW)) {
+		cerr << "Failed to open GLFW window" << endl;
+    glfwTerminate();
+    return false;
+  }
+  glfwSetWindowTitle(title);
+  glfwEnable(GLFW_STICKY_KEYS);
+  glfwSwapInterval(1);
+	glfwGetWindowSize(&__width, &__height);
+
+	return true;
+}
+
+bool context_t::open_headless() {
+#ifdef USE_EGL
+	EGLDisplay display = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	// no window system at all, so a plain display connection is not an option on a headless box
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display)
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+		cerr << "Failed to initialize EGL" << endl;
+		return false;
+	}
+	__display = display;
+
+	EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint config_count = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0) {
+		cerr << "Failed to choose an EGL config for desktop OpenGL" << endl;
+		close();
+		return false;
+	}
+
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+	if (context == EGL_NO_CONTEXT) {
+		cerr << "Failed to create EGL context" << endl;
+		close();
+		return false;
+	}
+	__context = context;
+
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		cerr << "Failed to make EGL context current" << endl;
+		close();
+		return false;
+	}
+
+	__frame_buffer = new frame_buffer_t(__width, __height);
+	__frame_buffer->bind();
+	__frame_buffer->attach_render_buffer(GL_COLOR_ATTACHMENT0_EXT, GL_RGBA8);
+	__frame_buffer->attach_render_buffer(GL_DEPTH_ATTACHMENT_EXT, __depth_bits > 16 ? GL_DEPTH_COMPONENT24 : GL_DEPTH_COMPONENT16);
+	GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0_EXT };
+	__frame_buffer->select_color_buffers(draw_buffers, 1, GL_COLOR_ATTACHMENT0_EXT);
+	if (!__frame_buffer->is_valid()) {
+		close();
+		return false;
+	}
+	frame_buffer_t::set_default(__frame_buffer);
+
+	cout << "Rendering " << __frame_count << " frames headless (" << __width << "x" << __height << ") on " << glGetString(GL_RENDERER) << endl;
+	return true;
+#else
+	cerr << "This build has no headless support; rebuild with HEADLESS=1" << endl;
+	return false;
+#endif
+}
+
+GLuint context_t::frame_buffer_handle() const {
+	return __frame_buffer ? __frame_buffer->handle() : 0;
+}
+
+bool context_t::is_running() const {
+	if (!__opened)
+		return false;
+	if (__headless)
+		return __frame_index < __frame_count;
+	return glfwGetKey(GLFW_KEY_ESC) != GLFW_PRESS && glfwGetWindowParam(GLFW_OPENED);
+}
+
+void context_t::swap_buffers() {
+	if (!__headless) {
+		glfwSwapBuffers();
+		return;
+	}
+
+	// the demos release their own frame buffers back to the default one, so rebind it for the next frame
+	frame_buffer_t::bind_default();
+	__frame_index++;
+	if (__frame_index == __frame_count)
+		finish_headless();
+}
+
+void context_t::finish_headless() {
+	glFinish();
+	double elapsed = current_time() - __start_time;
+	cout << __frame_count << " frames in " << elapsed << " s (" << (elapsed > 0 ? __frame_count / elapsed : 0) << " fps)" << endl;
+
+	if (__snapshot_filepath.empty())
+		return;
+
+	vector<unsigned char> pixels(__width * __height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	glReadPixels(0, 0, __width, __height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	ofstream output(__snapshot_filepath.c_str(), ios::out | ios::binary);
+	if (!output) {
+		cerr << "Failed to open snapshot file: " << __snapshot_filepath << endl;
+		return;
+	}
+	output << "P6\n" << __width << " " << __height << "\n255\n";
+	for (int y = __height - 1; y >= 0; y--)
+		output.write((const char *)&pixels[y * __width * 3], __width * 3);
+	cout << "Snapshot written to " << __snapshot_filepath << endl;
+}
+
+void context_t::close() {
+	if (__frame_buffer) {
+		frame_buffer_t::set_default(NULL);
+		delete __frame_buffer;
+		__frame_buffer = NULL;
+	}
+#ifdef USE_EGL
+	if (__display) {
+		eglMakeCurrent(__display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (__context)
+			eglDestroyContext(__display, __context);
+		eglTerminate(__display);
+	}
+#endif
+	__display = NULL;
+	__context = NULL;
+	if (__opened && !__headless)
+		glfwTerminate();
+	__opened = false;
+}
@@ -0,0 +1,60 @@
+#ifndef CONTEXT_HPP
+#define CONTEXT_HPP
+
+#include <string>
+#include "gl.hpp"
+#include "vertex_format.hpp"
+
+class frame_buffer_t;
+
+// Owns the GL context of a demo: a GLFW window, or with --headless an offscreen
+// EGL context (llvmpipe works) rendering a fixed number of frames into a frame_buffer_t.
+class context_t {
+
+public:
+
+	context_t(int width, int height, int depth_bits);
+	~context_t();
+
+	// consumes --headless, --frames N, --snapshot FILE.ppm, --profile FILE.json and
+	// --vertex-format float|compact|quantized, leaving the other arguments in place
+	void parse_arguments(int &argc, char **args);
+
+	bool open(const char *title);
+	void close();
+
+	bool is_headless() const { return __headless; }
+	bool is_running() const;
+	void swap_buffers();
+
+	int width() const { return __width; }
+	int height() const { return __height; }
+	const std::string& profile_filepath() const { return __profile_filepath; }
+	vertex_format_t vertex_format() const { return __vertex_format; }
+	// what the demos bind instead of 0 to draw to the screen
+	GLuint frame_buffer_handle() const;
+
+private:
+
+	bool open_window(const char *title);
+	bool open_headless();
+	void finish_headless();
+
+	int __width;
+	int __height;
+	int __depth_bits;
+	bool __headless;
+	bool __opened;
+	size_t __frame_count;
+	size_t __frame_index;
+	double __start_time;
+	std::string __snapshot_filepath;
+	std::string __profile_filepath;
+	vertex_format_t __vertex_format;
+	frame_buffer_t *__frame_buffer;
+	void *__display;
+	void *__context;
+
+};
+
+#endif
@@ -1,9 +1,12 @@
 #include <iostream>
 #include <cassert>
+#include "render_state.hpp"
 #include "fbo.hpp"
 
 using namespace std;
 
+GLuint frame_buffer_t::__default_handle = 0;
+
 frame_buffer_t::frame_buffer_t(size_t width, size_t height) {
 	__width = width;
 	__height = height;
@@ -12,15 +15,27 @@ frame_buffer_t::frame_buffer_t(size_t width, size_t height) {
 }
 
 frame_buffer_t::~frame_buffer_t() {
+	if (__default_handle == __handle)
+		__default_handle = 0;
+	for (map<GLenum, GLuint>::iterator it = __render_buffer_handles.begin(); it != __render_buffer_handles.end(); it++)
+		glDeleteRenderbuffers(1, &it->second);
 	glDeleteFramebuffersEXT(1, &__handle);
 }
 
 void frame_buffer_t::bind() {
-	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, __handle);
+	RENDER_STATE.bind_frame_buffer(__handle);
 }
 
 void frame_buffer_t::release() {
-	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+	bind_default();
+}
+
+void frame_buffer_t::set_default(const frame_buffer_t *frame_buffer) {
+	__default_handle = frame_buffer ? frame_buffer->handle() : 0;
+}
+
+void frame_buffer_t::bind_default() {
+	RENDER_STATE.bind_frame_buffer(__default_handle);
 }
 
 #define WHEN_FBO_STATUS(fbo_status)  case fbo_status: cerr << "glCheckFramebufferStatus failed: " << #fbo_status << endl; break;
@@ -60,15 +75,14 @@ void frame_buffer_t::attach_texture(GLenum attachment, const texture_t &texture)
 	glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, attachment, texture.target, texture.handle, 0);
 }
 
-void frame_buffer_t::select_color_buffers(GLenum *draw_buffers, GLenum read_buffer) {
+void frame_buffer_t::select_color_buffers(const GLenum *draw_buffers, size_t draw_buffer_count, GLenum read_buffer) {
 	glReadBuffer(read_buffer);
 	
-	if (draw_buffers == NULL) {
+	if (draw_buffers == NULL || draw_buffer_count == 0) {
 		glDrawBuffer(GL_NONE);
 		return;
 	}
 	
-	size_t n = sizeof(draw_buffers) / sizeof(GLenum);
-	glDrawBuffers(n, draw_buffers);
+	glDrawBuffers(draw_buffer_count, draw_buffers);
 }
 
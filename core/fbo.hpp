@@ -2,8 +2,7 @@
 #define FRAMEBUFFER_OBJECT_HPP
 
 #include <map>
-#include <OpenGL/gl.h>
-#include <OpenGL/glext.h>
+#include "gl.hpp"
 #include "texture.hpp"
 
 class frame_buffer_t {
@@ -19,7 +18,12 @@ public:
 	bool is_valid() const;	
 	void attach_render_buffer(GLenum attachement, GLenum internal_format);
 	void attach_texture(GLenum attachment, const texture_t &texture);	
-	void select_color_buffers(GLenum *draw_buffers, GLenum read_buffer = GL_NONE);
+	void select_color_buffers(const GLenum *draw_buffers, size_t draw_buffer_count, GLenum read_buffer = GL_NONE);
+
+	// the frame buffer that stands in for the window; 0 unless rendering headless
+	static GLuint default_handle() { return __default_handle; }
+	static void set_default(const frame_buffer_t *frame_buffer);
+	static void bind_default();
 
 private:
 
@@ -28,6 +32,8 @@ private:
 	GLuint __handle;	
 	std::map<GLenum, GLuint> __render_buffer_handles;
 
+	static GLuint __default_handle;
+
 };
 
 #endif
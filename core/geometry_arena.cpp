@@ -0,0 +1,185 @@
+#include <iostream>
+#include "geometry_arena.hpp"
+#include "mesh.hpp"
+#include "instance_buffer.hpp"
+#include "render_state.hpp"
+
+using namespace std;
+
+range_allocator_t::range_allocator_t(size_t capacity) : __capacity(capacity), __free_size(capacity) {
+	if (capacity > 0)
+		__free[0] = capacity;
+}
+
+bool range_allocator_t::allocate(size_t size, size_t &offset) {
+	if (size == 0) {
+		offset = 0;
+		return true;
+	}
+	for (map<size_t, size_t>::iterator it = __free.begin(); it != __free.end(); it++) {
+		if (it->second < size)
+			continue;
+		offset = it->first;
+		size_t rest = it->second - size;
+		__free.erase(it);
+		if (rest > 0)
+			__free[offset + size] = rest;
+		__free_size -= size;
+		return true;
+	}
+	return false;
+}
+
+void range_allocator_t::release(size_t offset, size_t size) {
+	if (size == 0)
+		return;
+	__free_size += size;
+	map<size_t, size_t>::iterator next = __free.lower_bound(offset);
+	if (next != __free.begin()) {
+		map<size_t, size_t>::iterator previous = next;
+		previous--;
+		if (previous->first + previous->second == offset) {
+			offset = previous->first;
+			size += previous->second;
+			__free.erase(previous);
+		}
+	}
+	if (next != __free.end() && offset + size == next->first) {
+		size += next->second;
+		__free.erase(next);
+	}
+	__free[offset] = size;
+}
+
+geometry_arena_t::geometry_arena_t(size_t vertex_capacity, size_t index_capacity, vertex_format_t format) :
+	__vertex_format(format == VERTEX_FORMAT_QUANTIZED ? VERTEX_FORMAT_COMPACT : format), __vertex_buffer_handle(0), __index_buffer_handle(0),
+	__vertices(vertex_capacity), __indices(index_capacity) {
+	// the element array binding belongs to whatever vertex array is bound
+	RENDER_STATE.bind_vertex_array(0);
+	glGenBuffers(1, &__vertex_buffer_handle);
+	RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, __vertex_buffer_handle);
+	glBufferData(GL_ARRAY_BUFFER, vertex_capacity * vertex_layout_t::of(__vertex_format).stride, NULL, GL_STATIC_DRAW);
+	glGenBuffers(1, &__index_buffer_handle);
+	RENDER_STATE.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, __index_buffer_handle);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_capacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+}
+
+geometry_arena_t::~geometry_arena_t() {
+	for (map<pair<GLuint, GLuint>, GLuint>::iterator it = __vertex_array_handles.begin(); it != __vertex_array_handles.end(); it++)
+		glDeleteVertexArrays(1, &it->second);
+	glDeleteBuffers(1, &__vertex_buffer_handle);
+	glDeleteBuffers(1, &__index_buffer_handle);
+	RENDER_STATE.invalidate();
+}
+
+bool geometry_arena_t::add(const mesh_t &mesh, geometry_range_t &range) {
+	return add(mesh.vertex_data(), mesh.vertex_count(), mesh.index_data(), mesh.index_count(), range);
+}
+
+bool geometry_arena_t::add(const vertex_t *vertices, size_t vertex_count, const unsigned int *indices, size_t index_count, geometry_range_t &range) {
+	if (!__vertices.allocate(vertex_count, range.first_vertex)) {
+		cerr << "*** Geometry arena has no room for " << vertex_count << " more vertices" << endl;
+		return false;
+	}
+	if (!__indices.allocate(index_count, range.first_index)) {
+		cerr << "*** Geometry arena has no room for " << index_count << " more indices" << endl;
+		__vertices.release(range.first_vertex, vertex_count);
+		return false;
+	}
+	range.vertex_count = vertex_count;
+	range.index_count = index_count;
+
+	RENDER_STATE.bind_vertex_array(0);
+	RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, __vertex_buffer_handle);
+	GLsizei stride = vertex_layout_t::of(__vertex_format).stride;
+	if (__vertex_format == VERTEX_FORMAT_FLOAT) {
+		glBufferSubData(GL_ARRAY_BUFFER, range.first_vertex * stride, vertex_count * stride, vertices);
+	} else {
+		vector<unsigned char> data;
+		vertex_quantization_t quantization;
+		encode_vertices(vertices, vertex_count, __vertex_format, data, quantization);
+		glBufferSubData(GL_ARRAY_BUFFER, range.first_vertex * stride, data.size(), data.empty() ? NULL : &data[0]);
+	}
+
+	__index_scratch.resize(index_count);
+	for (size_t i = 0; i < index_count; i++)
+		__index_scratch[i] = indices[i] + range.first_vertex;
+	RENDER_STATE.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, __index_buffer_handle);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, range.first_index * sizeof(unsigned int), index_count * sizeof(unsigned int),
+	                __index_scratch.empty() ? NULL : &__index_scratch[0]);
+	return true;
+}
+
+void geometry_arena_t::remove(const geometry_range_t &range) {
+	__vertices.release(range.first_vertex, range.vertex_count);
+	__indices.release(range.first_index, range.index_count);
+}
+
+GLuint geometry_arena_t::vertex_array(const shader_program_t &shader_program, const instance_buffer_t &instances) {
+	GLuint &handle = __vertex_array_handles[make_pair(shader_program.handle(), instances.id())];
+	if (handle != 0)
+		return handle;
+
+	glGenVertexArrays(1, &handle);
+	RENDER_STATE.bind_vertex_array(handle);
+	RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, __vertex_buffer_handle);
+	set_vertex_attributes(shader_program, __vertex_format);
+	instances.set_attributes(shader_program);
+	RENDER_STATE.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, __index_buffer_handle);
+	return handle;
+}
+
+bool multi_draw_indirect_supported() {
+#ifdef GL_ARB_multi_draw_indirect
+	// base_instance is only read with GL_ARB_base_instance
+	return has_gl_extension("GL_ARB_multi_draw_indirect") && has_gl_extension("GL_ARB_base_instance");
+#else
+	return false;
+#endif
+}
+
+multi_draw_t::multi_draw_t() : __handle(0), __indirect(multi_draw_indirect_supported()) {
+	if (__indirect)
+		glGenBuffers(1, &__handle);
+}
+
+multi_draw_t::~multi_draw_t() {
+	if (__handle != 0)
+		glDeleteBuffers(1, &__handle);
+}
+
+void multi_draw_t::add(const geometry_range_t &range, GLuint first_instance, GLuint instance_count) {
+	draw_elements_indirect_command_t command;
+	command.count = range.index_count;
+	command.instance_count = instance_count;
+	command.first_index = range.first_index;
+	command.base_vertex = 0; // the indices are offset already
+	command.base_instance = first_instance;
+	__commands.push_back(command);
+}
+
+void multi_draw_t::draw(geometry_arena_t &arena, const shader_program_t &shader_program, const instance_buffer_t &instances) {
+	if (__commands.empty())
+		return;
+	set_vertex_format_uniforms(shader_program, arena.vertex_format(), vertex_quantization_t());
+	RENDER_STATE.bind_vertex_array(arena.vertex_array(shader_program, instances));
+
+#ifdef GL_ARB_multi_draw_indirect
+	if (__indirect) {
+		// a whole new store each frame, so the last frame's commands can still be read
+		RENDER_STATE.bind_buffer(GL_DRAW_INDIRECT_BUFFER, __handle);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, __commands.size() * sizeof(draw_elements_indirect_command_t), &__commands[0], GL_STREAM_DRAW);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, __commands.size(), 0);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < __commands.size(); i++) {
+		const draw_elements_indirect_command_t &command = __commands[i];
+		instances.set_attributes(shader_program, command.base_instance);
+		glDrawElementsInstanced(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (GLvoid *)(command.first_index * sizeof(unsigned int)),
+		                        command.instance_count);
+	}
+	// as the vertex array was built
+	instances.set_attributes(shader_program);
+}
@@ -0,0 +1,131 @@
+#ifndef GEOMETRY_ARENA_HPP
+#define GEOMETRY_ARENA_HPP
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <cstddef>
+#include "gl.hpp"
+#include "vertex_format.hpp"
+
+class shader_program_t;
+class instance_buffer_t;
+struct mesh_t;
+
+// First fit over the free runs of a capacity of elements; freed runs merge with their neighbours.
+class range_allocator_t {
+
+public:
+
+	range_allocator_t(size_t capacity);
+
+	// false when no free run is long enough
+	bool allocate(size_t size, size_t &offset);
+	void release(size_t offset, size_t size);
+
+	size_t capacity() const { return __capacity; }
+	size_t free_size() const { return __free_size; }
+
+private:
+
+	size_t __capacity;
+	size_t __free_size;
+	std::map<size_t, size_t> __free; // offset to size
+
+};
+
+// where a mesh lives in a geometry_arena_t, in vertices and indices
+struct geometry_range_t {
+	size_t first_vertex;
+	size_t vertex_count;
+	size_t first_index;
+	size_t index_count;
+
+	geometry_range_t() : first_vertex(0), vertex_count(0), first_index(0), index_count(0) { }
+};
+
+// One vertex buffer and one index buffer shared by many meshes, so everything in the arena
+// draws from one vertex array. The indices are 32 bit and already offset by the mesh's first
+// vertex: GL 2.1 has no base vertex draws, and GL_UNSIGNED_INT indices let glMultiDraw* calls
+// span the whole arena. VERTEX_FORMAT_QUANTIZED positions are scaled per mesh, so that format
+// is stored as VERTEX_FORMAT_COMPACT. Create and destroy with the GL context current.
+class geometry_arena_t {
+
+public:
+
+	geometry_arena_t(size_t vertex_capacity = 1 << 18, size_t index_capacity = 1 << 20, vertex_format_t format = VERTEX_FORMAT_FLOAT);
+	~geometry_arena_t();
+
+	// copies the mesh in; false when the arena has no room for it
+	bool add(const mesh_t &mesh, geometry_range_t &range);
+	bool add(const vertex_t *vertices, size_t vertex_count, const unsigned int *indices, size_t index_count, geometry_range_t &range);
+	void remove(const geometry_range_t &range);
+
+	// the arena's vertices, with the instance attributes of instances (see instance_buffer.hpp)
+	GLuint vertex_array(const shader_program_t &shader_program, const instance_buffer_t &instances);
+
+	vertex_format_t vertex_format() const { return __vertex_format; }
+	GLuint vertex_buffer_handle() const { return __vertex_buffer_handle; }
+	GLuint index_buffer_handle() const { return __index_buffer_handle; }
+	const range_allocator_t& vertices() const { return __vertices; }
+	const range_allocator_t& indices() const { return __indices; }
+
+private:
+
+	geometry_arena_t(const geometry_arena_t &);
+	geometry_arena_t& operator=(const geometry_arena_t &);
+
+	vertex_format_t __vertex_format;
+	GLuint __vertex_buffer_handle;
+	GLuint __index_buffer_handle;
+	range_allocator_t __vertices;
+	range_allocator_t __indices;
+	std::map<std::pair<GLuint, GLuint>, GLuint> __vertex_array_handles; // keyed by program handle and instance buffer id
+	std::vector<unsigned int> __index_scratch;
+
+};
+
+// laid out as glMultiDrawElementsIndirect reads it
+struct draw_elements_indirect_command_t {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+// call with a context current
+bool multi_draw_indirect_supported();
+
+// The draws of a pass over a geometry_arena_t, refilled every frame. Each command draws a
+// range with instance_count instances from first_instance on in an instance_buffer_t. Where
+// GL_ARB_multi_draw_indirect is supported draw() is one glMultiDrawElementsIndirect from a
+// buffer of the commands; elsewhere, as on the legacy OS X context, it moves the instance
+// attributes and issues one glDrawElementsInstanced per command, still without switching
+// vertex arrays or buffers. Both need instancing_supported().
+class multi_draw_t {
+
+public:
+
+	multi_draw_t();
+	~multi_draw_t();
+
+	void clear() { __commands.clear(); }
+	void add(const geometry_range_t &range, GLuint first_instance, GLuint instance_count = 1);
+	void draw(geometry_arena_t &arena, const shader_program_t &shader_program, const instance_buffer_t &instances);
+
+	size_t size() const { return __commands.size(); }
+	bool is_indirect() const { return __indirect; }
+
+private:
+
+	multi_draw_t(const multi_draw_t &);
+	multi_draw_t& operator=(const multi_draw_t &);
+
+	std::vector<draw_elements_indirect_command_t> __commands;
+	GLuint __handle;
+	bool __indirect;
+
+};
+
+#endif
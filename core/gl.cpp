@@ -0,0 +1,53 @@
+#include <cstring>
+#include "gl.hpp"
+
+bool has_gl_extension(const char *name) {
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+	if (extensions == NULL)
+		return false;
+
+	size_t length = strlen(name);
+	for (const char *p = strstr(extensions, name); p != NULL; p = strstr(p + length, name)) {
+		if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+			return true;
+	}
+	return false;
+}
+
+gl_fence_t insert_gl_fence() {
+#ifdef __APPLE__
+	GLuint fence;
+	glGenFencesAPPLE(1, &fence);
+	glSetFenceAPPLE(fence);
+	return fence;
+#else
+	return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
+bool gl_fence_passed(gl_fence_t fence) {
+#ifdef __APPLE__
+	return glTestFenceAPPLE(fence);
+#else
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+#endif
+}
+
+void wait_gl_fence(gl_fence_t fence) {
+#ifdef __APPLE__
+	glFinishFenceAPPLE(fence);
+#else
+	GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	while (status == GL_TIMEOUT_EXPIRED)
+		status = glClientWaitSync(fence, 0, 1000000000);
+#endif
+}
+
+void delete_gl_fence(gl_fence_t fence) {
+#ifdef __APPLE__
+	glDeleteFencesAPPLE(1, &fence);
+#else
+	glDeleteSync(fence);
+#endif
+}
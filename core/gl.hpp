@@ -0,0 +1,39 @@
+#ifndef GL_HPP
+#define GL_HPP
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glext.h>
+
+// the legacy OS X context only exposes vertex array objects through the APPLE extension
+#define glGenVertexArrays glGenVertexArraysAPPLE
+#define glBindVertexArray glBindVertexArrayAPPLE
+#define glDeleteVertexArrays glDeleteVertexArraysAPPLE
+// and instancing through GL_ARB_instanced_arrays and GL_ARB_draw_instanced
+#define glVertexAttribDivisor glVertexAttribDivisorARB
+#define glDrawElementsInstanced glDrawElementsInstancedARB
+#else
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#ifdef __APPLE__
+typedef GLuint gl_fence_t; // GL_APPLE_fence; the legacy context has no GL_ARB_sync
+#else
+typedef GLsync gl_fence_t;
+#endif
+
+// call with a context current
+bool has_gl_extension(const char *name);
+
+// a fence after the commands issued so far
+gl_fence_t insert_gl_fence();
+bool gl_fence_passed(gl_fence_t fence);
+// blocks until the commands before fence have completed
+void wait_gl_fence(gl_fence_t fence);
+void delete_gl_fence(gl_fence_t fence);
+
+#endif
@@ -0,0 +1,208 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <png.h>
+#include "parallel.hpp"
+#include "image_loader.hpp"
+
+using namespace std;
+
+struct image_batch_t {
+	const char **filepaths;
+	image_t *images;
+	image_pool_t *pool;
+	vector<char> succeeded;
+};
+
+image_pool_t::image_pool_t() {
+	pthread_mutex_init(&__mutex, NULL);
+}
+
+image_pool_t::~image_pool_t() {
+	for (size_t i = 0; i < __buffers.size(); i++)
+		delete [] __buffers[i].data;
+	pthread_mutex_destroy(&__mutex);
+}
+
+unsigned char* image_pool_t::acquire(size_t size) {
+	pthread_mutex_lock(&__mutex);
+	size_t best = __buffers.size();
+	for (size_t i = 0; i < __buffers.size(); i++) {
+		if (!__in_use[i] && __buffers[i].size >= size && (best == __buffers.size() || __buffers[i].size < __buffers[best].size))
+			best = i;
+	}
+	if (best == __buffers.size()) {
+		buffer_t buffer = { new unsigned char[size], size };
+		__buffers.push_back(buffer);
+		__in_use.push_back(false);
+	}
+	__in_use[best] = true;
+	unsigned char *data = __buffers[best].data;
+	pthread_mutex_unlock(&__mutex);
+	return data;
+}
+
+void image_pool_t::release(unsigned char *data) {
+	pthread_mutex_lock(&__mutex);
+	for (size_t i = 0; i < __buffers.size(); i++) {
+		if (__buffers[i].data == data) {
+			__in_use[i] = false;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&__mutex);
+}
+
+static GLenum format_of(size_t channels) {
+	switch (channels) {
+	case 1: return GL_LUMINANCE;
+	case 2: return GL_LUMINANCE_ALPHA;
+	case 3: return GL_RGB;
+	default: return GL_RGBA;
+	}
+}
+
+static bool is_little_endian() {
+	const unsigned short one = 1;
+	return *(const unsigned char *)&one == 1;
+}
+
+static bool decode_png(png_structp png, png_infop info, image_t &image, image_pool_t *pool) {
+	// set up before setjmp, so nothing that needs cleaning up after a libpng error is lost by the longjmp
+	vector<png_bytep> rows;
+	unsigned char * volatile data = NULL;
+	if (setjmp(png_jmpbuf(png))) {
+		if (data != NULL) {
+			if (pool)
+				pool->release(data);
+			else
+				delete [] data;
+		}
+		return false;
+	}
+
+	png_read_info(png, info);
+	png_byte color_type = png_get_color_type(png, info);
+	png_byte bit_depth = png_get_bit_depth(png, info);
+	if (color_type == PNG_COLOR_TYPE_PALETTE)
+		png_set_palette_to_rgb(png);
+	if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
+		png_set_expand_gray_1_2_4_to_8(png);
+	if (png_get_valid(png, info, PNG_INFO_tRNS))
+		png_set_tRNS_to_alpha(png);
+	if (bit_depth == 16 && is_little_endian())
+		png_set_swap(png);
+	png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+
+	size_t width = png_get_image_width(png, info);
+	size_t height = png_get_image_height(png, info);
+	size_t channels = png_get_channels(png, info);
+	size_t depth = png_get_bit_depth(png, info);
+	size_t row_size = png_get_rowbytes(png, info);
+
+	data = pool ? pool->acquire(row_size * height) : new unsigned char[row_size * height];
+	rows.resize(height);
+	for (size_t y = 0; y < height; y++)
+		rows[y] = data + y * row_size;
+	png_read_image(png, &rows[0]);
+	png_read_end(png, NULL);
+
+	image.format = format_of(channels);
+	image.type = (depth == 16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+	image.width = width;
+	image.height = height;
+	image.channels = channels;
+	image.bit_depth = depth;
+	image.byte_depth = row_size / width;
+	image.data = data;
+	image.pool = pool;
+	return true;
+}
+
+bool read_image_from_png_file(const char *filepath, image_t &image, image_pool_t *pool) {
+	FILE *fp = fopen(filepath, "rb");
+	if (!fp) {
+		cerr << "*** Could not open " << filepath << endl;
+		return false;
+	}
+
+	unsigned char header[8];
+	if (fread(header, 1, 8, fp) != 8 || png_sig_cmp(header, 0, 8)) {
+		cerr << "*** Not a PNG file: " << filepath << endl;
+		fclose(fp);
+		return false;
+	}
+
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png ? png_create_info_struct(png) : NULL;
+	if (!info) {
+		cerr << "*** Could not create a PNG reader" << endl;
+		png_destroy_read_struct(&png, NULL, NULL);
+		fclose(fp);
+		return false;
+	}
+
+	png_init_io(png, fp);
+	png_set_sig_bytes(png, 8);
+	bool decoded = decode_png(png, info, image, pool);
+	if (!decoded)
+		cerr << "*** Decoding PNG file failed: " << filepath << endl;
+
+	png_destroy_read_struct(&png, &info, NULL);
+	fclose(fp);
+	return decoded;
+}
+
+static void read_image_range(size_t begin, size_t end, void *context) {
+	image_batch_t *batch = static_cast<image_batch_t *>(context);
+	for (size_t i = begin; i < end; i++)
+		batch->succeeded[i] = read_image_from_png_file(batch->filepaths[i], batch->images[i], batch->pool);
+}
+
+bool read_images_from_png_files(const char **filepaths, size_t count, image_t *images, image_pool_t *pool) {
+	image_batch_t batch;
+	batch.filepaths = filepaths;
+	batch.images = images;
+	batch.pool = pool;
+	batch.succeeded.resize(count, 0);
+	parallel_for(count, read_image_range, &batch, 1);
+
+	for (size_t i = 0; i < count; i++) {
+		if (!batch.succeeded[i])
+			return false;
+	}
+	return true;
+}
+
+void release_image(image_t &image) {
+	if (image.data == NULL)
+		return;
+	if (image.pool)
+		image.pool->release(image.data);
+	else
+		delete [] image.data;
+	image.data = NULL;
+	image.pool = NULL;
+}
+
+void convert_to_rgba8(const image_t &image, vector<unsigned char> &rgba) {
+	size_t pixel_count = image.width * image.height;
+	rgba.resize(4 * pixel_count);
+	for (size_t i = 0; i < pixel_count; i++) {
+		unsigned char channels[4];
+		for (size_t c = 0; c < image.channels; c++) {
+			if (image.bit_depth == 16)
+				channels[c] = reinterpret_cast<const unsigned short *>(image.data)[i * image.channels + c] >> 8;
+			else
+				channels[c] = image.data[i * image.channels + c];
+		}
+		unsigned char *pixel = &rgba[4 * i];
+		switch (image.channels) {
+		case 1: pixel[0] = pixel[1] = pixel[2] = channels[0]; pixel[3] = 255; break;
+		case 2: pixel[0] = pixel[1] = pixel[2] = channels[0]; pixel[3] = channels[1]; break;
+		case 3: memcpy(pixel, channels, 3); pixel[3] = 255; break;
+		default: memcpy(pixel, channels, 4); break;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef IMAGE_LOADER_HPP
+#define IMAGE_LOADER_HPP
+
+#include <vector>
+#include <cstddef>
+#include <pthread.h>
+#include "gl.hpp"
+
+class image_pool_t;
+
+struct image_t {
+	GLenum format;      // GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB or GL_RGBA
+	GLenum type;        // GL_UNSIGNED_BYTE, or GL_UNSIGNED_SHORT for 16-bit images
+	size_t width;
+	size_t height;
+	size_t channels;
+	size_t bit_depth;   // per channel, 8 or 16
+	size_t byte_depth;  // per pixel
+	unsigned char *data;
+	image_pool_t *pool; // that data came from, NULL when it was allocated on its own
+
+	image_t() : format(0), type(0), width(0), height(0), channels(0), bit_depth(0), byte_depth(0), data(NULL), pool(NULL) { }
+
+	size_t size() const { return width * height * byte_depth; }
+};
+
+// Recycles pixel buffers between decodes, so loading a set of same-sized images does not
+// fault in fresh pages for every one. Safe to share between threads.
+class image_pool_t {
+
+public:
+
+	image_pool_t();
+	~image_pool_t();
+
+	unsigned char* acquire(size_t size);
+	void release(unsigned char *data);
+
+private:
+
+	struct buffer_t {
+		unsigned char *data;
+		size_t size;
+	};
+
+	image_pool_t(const image_pool_t &);
+	image_pool_t& operator=(const image_pool_t &);
+
+	pthread_mutex_t __mutex;
+	std::vector<buffer_t> __buffers; // every buffer handed out, free or not
+	std::vector<bool> __in_use;
+
+};
+
+// palette and low bit depth images are expanded to 8 bits per channel; 16-bit images stay
+// 16 bits in host byte order. pool may be NULL
+bool read_image_from_png_file(const char *filepath, image_t &image, image_pool_t *pool = NULL);
+// decodes count files at once, one per thread; returns false when any of them failed
+bool read_images_from_png_files(const char **filepaths, size_t count, image_t *images, image_pool_t *pool = NULL);
+void release_image(image_t &image);
+// gray is replicated into RGB, a missing alpha is opaque and 16-bit channels keep their high byte
+void convert_to_rgba8(const image_t &image, std::vector<unsigned char> &rgba);
+
+#endif
@@ -0,0 +1,81 @@
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include "index_buffer.hpp"
+
+using namespace std;
+
+static const size_t SHORT_INDEX_LIMIT = 65536;
+
+size_t index_type_size(GLenum index_type) {
+	return index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+static void append_submesh(const unsigned int *indices, size_t first_index, size_t index_count, unsigned int base_vertex,
+                           uint16_t *short_indices, vector<submesh_t> &submeshes) {
+	for (size_t i = first_index; i < first_index + index_count; i++)
+		short_indices[i] = (uint16_t)(indices[i] - base_vertex);
+
+	submesh_t submesh;
+	submesh.first_index = first_index;
+	submesh.index_count = index_count;
+	submesh.base_vertex = base_vertex;
+	submeshes.push_back(submesh);
+}
+
+static GLenum build_unsigned_int_buffer(const unsigned int *indices, size_t index_count, vector<unsigned char> &data,
+                                        vector<submesh_t> &submeshes) {
+	data.resize(index_count * sizeof(unsigned int));
+	if (index_count > 0)
+		memcpy(&data[0], indices, data.size());
+	submesh_t submesh = { 0, index_count, 0 };
+	submeshes.push_back(submesh);
+	return GL_UNSIGNED_INT;
+}
+
+// a triangle spanning 65536 or more vertices fits no submesh of 16-bit indices
+static bool has_wide_triangle(const unsigned int *indices, size_t index_count) {
+	for (size_t i = 0; i + 3 <= index_count; i += 3) {
+		unsigned int triangle_lower = min(indices[i], min(indices[i + 1], indices[i + 2]));
+		unsigned int triangle_upper = max(indices[i], max(indices[i + 1], indices[i + 2]));
+		if (triangle_upper - triangle_lower >= SHORT_INDEX_LIMIT)
+			return true;
+	}
+	return false;
+}
+
+GLenum build_index_buffer(const unsigned int *indices, size_t index_count, size_t vertex_count, bool split,
+                          vector<unsigned char> &data, vector<submesh_t> &submeshes) {
+	submeshes.clear();
+	if (vertex_count > SHORT_INDEX_LIMIT && (!split || has_wide_triangle(indices, index_count)))
+		return build_unsigned_int_buffer(indices, index_count, data, submeshes);
+
+	data.resize(index_count * sizeof(uint16_t));
+	uint16_t *short_indices = data.empty() ? NULL : reinterpret_cast<uint16_t *>(&data[0]);
+	if (vertex_count <= SHORT_INDEX_LIMIT) {
+		append_submesh(indices, 0, index_count, 0, short_indices, submeshes);
+		return GL_UNSIGNED_SHORT;
+	}
+
+	// greedy runs of whole triangles whose vertex range still fits
+	size_t first = 0;
+	unsigned int lower = ~0u, upper = 0;
+	for (size_t i = 0; i + 3 <= index_count; i += 3) {
+		unsigned int triangle_lower = min(indices[i], min(indices[i + 1], indices[i + 2]));
+		unsigned int triangle_upper = max(indices[i], max(indices[i + 1], indices[i + 2]));
+		unsigned int next_lower = min(lower, triangle_lower);
+		unsigned int next_upper = max(upper, triangle_upper);
+		if (i > first && next_upper - next_lower >= SHORT_INDEX_LIMIT) {
+			append_submesh(indices, first, i - first, lower, short_indices, submeshes);
+			first = i;
+			next_lower = triangle_lower;
+			next_upper = triangle_upper;
+		}
+		lower = next_lower;
+		upper = next_upper;
+	}
+	if (index_count > first)
+		append_submesh(indices, first, index_count - first, lower == ~0u ? 0 : lower, short_indices, submeshes);
+
+	return GL_UNSIGNED_SHORT;
+}
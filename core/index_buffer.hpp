@@ -0,0 +1,27 @@
+#ifndef INDEX_BUFFER_HPP
+#define INDEX_BUFFER_HPP
+
+#include <vector>
+#include <cstddef>
+#include "gl.hpp"
+
+// A run of triangles drawn with one glDrawElements. Without base vertex draws in GL 2.1,
+// the indices of a split mesh are stored relative to base_vertex and the attribute
+// pointers are moved forward by base_vertex vertices instead.
+struct submesh_t {
+	size_t first_index;
+	size_t index_count;
+	unsigned int base_vertex;
+};
+
+// Fills data with the contents of an element array buffer and returns its index type:
+// GL_UNSIGNED_SHORT when every index fits in 16 bits; otherwise, with split set, still
+// GL_UNSIGNED_SHORT with the triangles cut into submeshes that each span fewer than
+// 65536 vertices (works best on vertices in order of first use); otherwise, or when a
+// single triangle spans 65536 vertices or more, GL_UNSIGNED_INT.
+GLenum build_index_buffer(const unsigned int *indices, size_t index_count, size_t vertex_count, bool split,
+                          std::vector<unsigned char> &data, std::vector<submesh_t> &submeshes);
+
+size_t index_type_size(GLenum index_type);
+
+#endif
@@ -0,0 +1,57 @@
+#include <cstddef>
+#include "instance_buffer.hpp"
+#include "shader.hpp"
+#include "render_state.hpp"
+
+using namespace std;
+
+bool instancing_supported() {
+	return has_gl_extension("GL_ARB_instanced_arrays") && has_gl_extension("GL_ARB_draw_instanced");
+}
+
+unsigned int instance_buffer_t::__next_id = 1;
+
+instance_buffer_t::instance_buffer_t() : __handle(0), __id(__next_id++), __count(0) {
+	glGenBuffers(1, &__handle);
+}
+
+instance_buffer_t::~instance_buffer_t() {
+	RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &__handle);
+}
+
+void instance_buffer_t::update(const glm::mat4 *model_matrices, size_t count, const unsigned int *material_ids) {
+	__staging.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		__staging[i].model_matrix = model_matrices[i];
+		__staging[i].material = material_ids ? material_ids[i] : 0;
+	}
+	update(__staging.empty() ? NULL : &__staging[0], count);
+}
+
+void instance_buffer_t::update(const instance_t *instances, size_t count) {
+	// a whole new store each time, so a draw still reading the old instances does not stall the update
+	RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, __handle);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(instance_t), instances, GL_STREAM_DRAW);
+	__count = count;
+}
+
+void instance_buffer_t::set_attributes(const shader_program_t &shader_program, size_t first) const {
+	RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, __handle);
+	size_t base_offset = first * sizeof(instance_t);
+	GLint location = shader_program.attribute_location("instance_model_matrix");
+	if (location >= 0) {
+		for (GLint i = 0; i < 4; i++) {
+			glVertexAttribPointer(location + i, 4, GL_FLOAT, GL_FALSE, sizeof(instance_t),
+			                      (GLvoid *)(base_offset + offsetof(instance_t, model_matrix) + i * sizeof(glm::vec4)));
+			glVertexAttribDivisor(location + i, 1);
+			RENDER_STATE.set_vertex_attrib_array(location + i, true);
+		}
+	}
+	location = shader_program.attribute_location("instance_material");
+	if (location >= 0) {
+		glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, sizeof(instance_t), (GLvoid *)(base_offset + offsetof(instance_t, material)));
+		glVertexAttribDivisor(location, 1);
+		RENDER_STATE.set_vertex_attrib_array(location, true);
+	}
+}
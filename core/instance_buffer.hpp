@@ -0,0 +1,62 @@
+#ifndef INSTANCE_BUFFER_HPP
+#define INSTANCE_BUFFER_HPP
+
+#include <vector>
+#include <cstddef>
+#include "gl.hpp"
+#include <glm/glm.hpp>
+
+class shader_program_t;
+
+// what a vertex shader reads per instance, as
+//   attribute mat4 instance_model_matrix;
+//   attribute float instance_material;
+// GLSL 1.20 has no integer attributes, so the material id arrives as a float. There is no
+// per instance normal matrix; shaders take mat3(view_matrix * instance_model_matrix), which
+// holds for rotations and uniform scales.
+struct instance_t {
+	glm::mat4 model_matrix;
+	float material;
+};
+
+// call with a context current
+bool instancing_supported();
+
+// A GL_ARRAY_BUFFER of instance_t for mesh_t::render_instanced. Meshes and geometry arenas
+// keep a vertex array per instance buffer they have drawn, keyed by id(), which unlike the
+// GL handle is never given out again: a buffer made after this one is destroyed never draws
+// through this one's vertex arrays. Those are deleted with the mesh's or arena's others.
+// Create and destroy with the GL context current.
+class instance_buffer_t {
+
+public:
+
+	instance_buffer_t();
+	~instance_buffer_t();
+
+	// replaces the instances; material_ids may be NULL for material 0 throughout
+	void update(const glm::mat4 *model_matrices, size_t count, const unsigned int *material_ids = NULL);
+	void update(const instance_t *instances, size_t count);
+	// points the program's instance attributes of the bound vertex array at the instances
+	// from first on, each stepping once per instance
+	void set_attributes(const shader_program_t &shader_program, size_t first = 0) const;
+
+	size_t count() const { return __count; }
+	GLuint handle() const { return __handle; }
+	unsigned int id() const { return __id; }
+
+private:
+
+	instance_buffer_t(const instance_buffer_t &);
+	instance_buffer_t& operator=(const instance_buffer_t &);
+
+	static unsigned int __next_id;
+
+	GLuint __handle;
+	unsigned int __id;
+	size_t __count;
+	std::vector<instance_t> __staging;
+
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include <ctime>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+#include "parallel.hpp"
+#include "job_queue.hpp"
+
+using namespace std;
+
+static double now_seconds() {
+#ifdef __APPLE__
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return (double)mach_absolute_time() * timebase.numer / timebase.denom * 1.0e-9;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+#endif
+}
+
+job_queue_t::job_queue_t(size_t thread_count) : __pending(0), __stopping(false) {
+	pthread_mutex_init(&__mutex, NULL);
+	pthread_cond_init(&__job_ready, NULL);
+	pthread_cond_init(&__upload_ready, NULL);
+
+	if (thread_count == 0)
+		thread_count = hardware_thread_count();
+	for (size_t i = 0; i < thread_count; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, run_worker, this) != 0)
+			break;
+		__threads.push_back(thread);
+	}
+}
+
+job_queue_t::~job_queue_t() {
+	pthread_mutex_lock(&__mutex);
+	__stopping = true;
+	pthread_cond_broadcast(&__job_ready);
+	pthread_mutex_unlock(&__mutex);
+
+	for (size_t i = 0; i < __threads.size(); i++)
+		pthread_join(__threads[i], NULL);
+
+	pthread_cond_destroy(&__upload_ready);
+	pthread_cond_destroy(&__job_ready);
+	pthread_mutex_destroy(&__mutex);
+}
+
+void* job_queue_t::run_worker(void *argument) {
+	job_queue_t *queue = static_cast<job_queue_t *>(argument);
+	pthread_mutex_lock(&queue->__mutex);
+	for (;;) {
+		while (queue->__jobs.empty() && !queue->__stopping)
+			pthread_cond_wait(&queue->__job_ready, &queue->__mutex);
+		if (queue->__jobs.empty())
+			break;
+
+		job_t job = queue->__jobs.front();
+		queue->__jobs.pop_front();
+		pthread_mutex_unlock(&queue->__mutex);
+
+		if (job.decode)
+			job.decode(job.context);
+
+		pthread_mutex_lock(&queue->__mutex);
+		queue->__uploads.push_back(job);
+		pthread_cond_signal(&queue->__upload_ready);
+	}
+	pthread_mutex_unlock(&queue->__mutex);
+	return NULL;
+}
+
+void job_queue_t::push(job_function decode, job_function upload, void *context) {
+	job_t job = { decode, upload, context };
+
+	pthread_mutex_lock(&__mutex);
+	__pending++;
+	if (__threads.empty()) {
+		// no workers could be started; decode here
+		pthread_mutex_unlock(&__mutex);
+		if (decode)
+			decode(context);
+		pthread_mutex_lock(&__mutex);
+		__uploads.push_back(job);
+	} else {
+		__jobs.push_back(job);
+		pthread_cond_signal(&__job_ready);
+	}
+	pthread_mutex_unlock(&__mutex);
+}
+
+size_t job_queue_t::process_uploads(double budget_seconds) {
+	double deadline = now_seconds() + budget_seconds;
+	size_t count = 0;
+	for (;;) {
+		pthread_mutex_lock(&__mutex);
+		if (__uploads.empty() || (count > 0 && now_seconds() >= deadline)) {
+			pthread_mutex_unlock(&__mutex);
+			break;
+		}
+		job_t job = __uploads.front();
+		__uploads.pop_front();
+		pthread_mutex_unlock(&__mutex);
+
+		if (job.upload)
+			job.upload(job.context);
+		count++;
+
+		pthread_mutex_lock(&__mutex);
+		__pending--;
+		pthread_mutex_unlock(&__mutex);
+	}
+	return count;
+}
+
+void job_queue_t::finish() {
+	for (;;) {
+		pthread_mutex_lock(&__mutex);
+		while (__uploads.empty() && __pending > 0)
+			pthread_cond_wait(&__upload_ready, &__mutex);
+		bool done = __pending == 0;
+		pthread_mutex_unlock(&__mutex);
+		if (done)
+			break;
+		process_uploads(0.0);
+	}
+}
+
+size_t job_queue_t::pending() const {
+	pthread_mutex_lock(&__mutex);
+	size_t count = __pending;
+	pthread_mutex_unlock(&__mutex);
+	return count;
+}
@@ -0,0 +1,56 @@
+#ifndef JOB_QUEUE_HPP
+#define JOB_QUEUE_HPP
+
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <pthread.h>
+
+typedef void (*job_function)(void *context);
+
+struct job_t {
+	job_function decode;   // on a worker thread: file reads and CPU work only, no GL
+	job_function upload;   // on the thread that calls process_uploads, with the GL context current
+	void *context;
+};
+
+// Worker threads decode assets; what they produce waits in the upload queue until the
+// render loop spends its per-frame budget on it, so the first frame does not wait for
+// every file to load.
+class job_queue_t {
+
+public:
+
+	// thread_count 0 means one worker per hardware thread
+	job_queue_t(size_t thread_count = 0);
+	~job_queue_t();
+
+	void push(job_function decode, job_function upload, void *context);
+
+	// runs finished uploads until budget_seconds is spent; at least one runs when any is ready.
+	// returns the number of uploads run
+	size_t process_uploads(double budget_seconds);
+	// blocks until every pushed job is decoded and uploaded
+	void finish();
+
+	size_t pending() const;
+
+private:
+
+	job_queue_t(const job_queue_t &);
+	job_queue_t& operator=(const job_queue_t &);
+
+	static void* run_worker(void *argument);
+
+	mutable pthread_mutex_t __mutex;
+	pthread_cond_t __job_ready;
+	pthread_cond_t __upload_ready;
+	std::vector<pthread_t> __threads;
+	std::deque<job_t> __jobs;
+	std::deque<job_t> __uploads;
+	size_t __pending;
+	bool __stopping;
+
+};
+
+#endif
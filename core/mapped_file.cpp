@@ -0,0 +1,27 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mapped_file.hpp"
+
+void* map_file(const char *filepath, size_t &size) {
+	int fd = ::open(filepath, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	void *data = NULL;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		size = st.st_size;
+		data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+			data = NULL;
+	}
+	::close(fd);
+	return data;
+}
+
+void unmap_file(void *data, size_t size) {
+	if (data != NULL)
+		munmap(data, size);
+}
@@ -0,0 +1,10 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+
+// the whole file mapped read only, setting size; NULL when it is missing or empty
+void* map_file(const char *filepath, size_t &size);
+void unmap_file(void *data, size_t size);
+
+#endif
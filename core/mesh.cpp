@@ -0,0 +1,328 @@
+#include <iostream>
+#include <cstddef>
+#include <string>
+#include <openctmpp.h>
+#include "mesh.hpp"
+#include "tangent.hpp"
+#include "mesh_optimizer.hpp"
+#include "render_state.hpp"
+#include "instance_buffer.hpp"
+
+using namespace std;
+
+mesh_t::mesh_t() : vertex_buffer_handle(0), index_buffer_handle(0), index_type(GL_UNSIGNED_INT), cache(NULL), vertex_format(VERTEX_FORMAT_FLOAT) {
+}
+
+// a copy never shares the mapping; it gets its own vectors instead, and builds its own vertex arrays
+mesh_t::mesh_t(const mesh_t &mesh) : cache(NULL) {
+	*this = mesh;
+}
+
+mesh_t::~mesh_t() {
+	release_buffers();
+	delete cache;
+}
+
+mesh_t& mesh_t::operator=(const mesh_t &mesh) {
+	if (this == &mesh)
+		return *this;
+
+	release_buffers();
+	vertices.assign(mesh.vertex_data(), mesh.vertex_data() + mesh.vertex_count());
+	indices.assign(mesh.index_data(), mesh.index_data() + mesh.index_count());
+	vertex_buffer_handle = mesh.vertex_buffer_handle;
+	index_buffer_handle = mesh.index_buffer_handle;
+	vertex_format = mesh.vertex_format;
+	quantization = mesh.quantization;
+	bounds = mesh.bounds;
+	index_type = mesh.index_type;
+	submeshes = mesh.submeshes;
+	delete cache;
+	cache = NULL;
+	return *this;
+}
+
+size_t mesh_t::vertex_count() const {
+	size_t count = vertices.size();
+	if (cache)
+		cache->chunk_data(mesh_cache_t::VERTICES, sizeof(vertex_t), count);
+	return count;
+}
+
+size_t mesh_t::index_count() const {
+	size_t count = indices.size();
+	if (cache)
+		cache->chunk_data(mesh_cache_t::INDICES, sizeof(unsigned int), count);
+	return count;
+}
+
+const vertex_t* mesh_t::vertex_data() const {
+	size_t count;
+	if (cache)
+		return static_cast<const vertex_t *>(cache->chunk_data(mesh_cache_t::VERTICES, sizeof(vertex_t), count));
+	return vertices.empty() ? NULL : &vertices[0];
+}
+
+const unsigned int* mesh_t::index_data() const {
+	size_t count;
+	if (cache)
+		return static_cast<const unsigned int *>(cache->chunk_data(mesh_cache_t::INDICES, sizeof(unsigned int), count));
+	return indices.empty() ? NULL : &indices[0];
+}
+
+template <typename key_t>
+static void delete_vertex_arrays(map<key_t, vector<GLuint> > &handles) {
+	for (typename map<key_t, vector<GLuint> >::iterator it = handles.begin(); it != handles.end(); it++) {
+		for (size_t i = 0; i < it->second.size(); i++) {
+			if (it->second[i] != 0)
+				glDeleteVertexArrays(1, &it->second[i]);
+		}
+	}
+	handles.clear();
+}
+
+void mesh_t::release_buffers() {
+	if (vertex_array_handles.empty() && instanced_vertex_array_handles.empty())
+		return;
+	delete_vertex_arrays(vertex_array_handles);
+	delete_vertex_arrays(instanced_vertex_array_handles);
+	RENDER_STATE.invalidate();
+}
+
+void mesh_t::load_to_buffers(vertex_format_t format, bool split_indices) {
+	// the vertex arrays point at the buffers replaced below
+	release_buffers();
+	vertex_format = format;
+	// the element array binding belongs to whatever vertex array is bound
+	RENDER_STATE.bind_vertex_array(0);
+  glGenBuffers(1, &vertex_buffer_handle);
+  RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, vertex_buffer_handle);
+	if (format == VERTEX_FORMAT_FLOAT) {
+		quantization = vertex_quantization_t();
+		glBufferData(GL_ARRAY_BUFFER, vertex_count() * sizeof(vertex_t), vertex_data(), GL_STATIC_DRAW);
+	} else {
+		vector<unsigned char> data;
+		encode_vertices(vertex_data(), vertex_count(), format, data, quantization);
+		glBufferData(GL_ARRAY_BUFFER, data.size(), data.empty() ? NULL : &data[0], GL_STATIC_DRAW);
+	}
+
+  glGenBuffers(1, &index_buffer_handle);
+  RENDER_STATE.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_handle);
+	vector<unsigned char> index_buffer;
+	index_type = build_index_buffer(index_data(), index_count(), vertex_count(), split_indices, index_buffer, submeshes);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer.size(), index_buffer.empty() ? NULL : &index_buffer[0], GL_STATIC_DRAW);
+}
+
+static void enable_vertex_attribute(GLint location, const vertex_attribute_t &attribute, GLsizei stride, size_t base_offset) {
+	if (location < 0) // not used by the shader program
+		return;
+	glVertexAttribPointer(location, attribute.size, attribute.type, attribute.normalized, stride, (GLvoid *)(base_offset + attribute.offset));
+	RENDER_STATE.set_vertex_attrib_array(location, true);
+}
+
+void set_vertex_attributes(const shader_program_t &shader_program, vertex_format_t format, size_t base_vertex) {
+	const vertex_layout_t &layout = vertex_layout_t::of(format);
+	for (size_t i = 0; i < layout.attribute_count; i++) {
+		const vertex_attribute_t &attribute = layout.attributes[i];
+		enable_vertex_attribute(shader_program.attribute_location(attribute.name), attribute, layout.stride, base_vertex * layout.stride);
+	}
+}
+
+static GLuint build_vertex_array(const mesh_t &mesh, const shader_program_t &shader_program, size_t submesh) {
+	size_t base_vertex = submesh < mesh.submeshes.size() ? mesh.submeshes[submesh].base_vertex : 0;
+	GLuint vertex_array_handle;
+	glGenVertexArrays(1, &vertex_array_handle);
+	RENDER_STATE.bind_vertex_array(vertex_array_handle);
+
+  RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, mesh.vertex_buffer_handle);
+	set_vertex_attributes(shader_program, mesh.vertex_format, base_vertex);
+  RENDER_STATE.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer_handle);
+	return vertex_array_handle;
+}
+
+GLuint mesh_t::vertex_array(const shader_program_t &shader_program, size_t submesh) {
+	std::vector<GLuint> &handles = vertex_array_handles[shader_program.handle()];
+	if (handles.size() <= submesh)
+		handles.resize(submeshes.size() > submesh ? submeshes.size() : submesh + 1, 0);
+	if (handles[submesh] == 0)
+		handles[submesh] = build_vertex_array(*this, shader_program, submesh);
+	return handles[submesh];
+}
+
+// the mesh's vertex attributes plus the instance_t ones stepping once per instance
+GLuint mesh_t::instanced_vertex_array(const shader_program_t &shader_program, const instance_buffer_t &instances, size_t submesh) {
+	std::vector<GLuint> &handles = instanced_vertex_array_handles[make_pair(shader_program.handle(), instances.id())];
+	if (handles.size() <= submesh)
+		handles.resize(submeshes.size() > submesh ? submeshes.size() : submesh + 1, 0);
+	if (handles[submesh] != 0)
+		return handles[submesh];
+
+	handles[submesh] = build_vertex_array(*this, shader_program, submesh);
+	instances.set_attributes(shader_program);
+	return handles[submesh];
+}
+
+// only shaders that decode the compact formats declare these
+void set_vertex_format_uniforms(const shader_program_t &shader_program, vertex_format_t format, const vertex_quantization_t &quantization) {
+	if ((GLint)shader_program.uniform_location("compact_vertex") < 0)
+		return;
+	shader_program.set_uniform_value("compact_vertex", format == VERTEX_FORMAT_FLOAT ? 0 : 1);
+	shader_program.set_uniform_value("position_offset", quantization.offset);
+	shader_program.set_uniform_value("position_scale", quantization.scale);
+}
+
+void mesh_t::render(const shader_program_t &shader_program) {
+	set_vertex_format_uniforms(shader_program, vertex_format, quantization);
+	size_t index_size = index_type_size(index_type);
+	for (size_t i = 0; i < submeshes.size(); i++) {
+		RENDER_STATE.bind_vertex_array(vertex_array(shader_program, i));
+		glDrawElements(GL_TRIANGLES, submeshes[i].index_count, index_type, (GLvoid *)(submeshes[i].first_index * index_size));
+	}
+}
+
+void mesh_t::render_instanced(const shader_program_t &shader_program, const instance_buffer_t &instances) {
+	if (instances.count() == 0)
+		return;
+	set_vertex_format_uniforms(shader_program, vertex_format, quantization);
+	size_t index_size = index_type_size(index_type);
+	for (size_t i = 0; i < submeshes.size(); i++) {
+		RENDER_STATE.bind_vertex_array(instanced_vertex_array(shader_program, instances, i));
+		glDrawElementsInstanced(GL_TRIANGLES, submeshes[i].index_count, index_type, (GLvoid *)(submeshes[i].first_index * index_size),
+		                        instances.count());
+	}
+}
+
+bool mesh_t::read_from_file(const char *ctm_filepath, mesh_t &mesh, bool use_cache) {
+	if (!use_cache)
+		return read_from_ctm_file(ctm_filepath, mesh);
+
+	uint64_t source_hash;
+	if (!mesh_cache_t::hash_file(ctm_filepath, source_hash)) {
+		cerr << "*** Loading CTM file failed: " << ctm_filepath << endl;
+		return false;
+	}
+
+	string cache_filepath = mesh_cache_t::filepath_for(ctm_filepath);
+	mesh_cache_t *cache = new mesh_cache_t();
+	size_t count;
+	const aabb_t *bounds;
+	if (cache->open(cache_filepath.c_str(), source_hash)
+			&& cache->chunk_data(mesh_cache_t::VERTICES, sizeof(vertex_t), count)
+			&& cache->chunk_data(mesh_cache_t::INDICES, sizeof(unsigned int), count)
+			&& (bounds = static_cast<const aabb_t *>(cache->chunk_data(mesh_cache_t::BOUNDS, sizeof(aabb_t), count))) && count == 1) {
+		mesh.bounds = *bounds;
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		delete mesh.cache;
+		mesh.cache = cache;
+		return true;
+	}
+	delete cache;
+
+	if (!read_from_ctm_file(ctm_filepath, mesh))
+		return false;
+
+	vector<mesh_cache_t::chunk_t> chunks(3);
+	chunks[0].id = mesh_cache_t::VERTICES;
+	chunks[0].element_size = sizeof(vertex_t);
+	chunks[0].element_count = mesh.vertices.size();
+	chunks[0].data = mesh.vertices.empty() ? NULL : &mesh.vertices[0];
+	chunks[1].id = mesh_cache_t::INDICES;
+	chunks[1].element_size = sizeof(unsigned int);
+	chunks[1].element_count = mesh.indices.size();
+	chunks[1].data = mesh.indices.empty() ? NULL : &mesh.indices[0];
+	chunks[2].id = mesh_cache_t::BOUNDS;
+	chunks[2].element_size = sizeof(aabb_t);
+	chunks[2].element_count = 1;
+	chunks[2].data = &mesh.bounds;
+	if (!mesh_cache_t::write(cache_filepath.c_str(), source_hash, chunks))
+		cerr << "*** Writing mesh cache failed: " << cache_filepath << endl;
+
+	return true;
+}
+
+bool mesh_t::read_from_ctm_file(const char *ctm_filepath, mesh_t &mesh) {
+  CTMimporter ctm;
+  try {
+    ctm.Load(ctm_filepath);
+	} catch(ctm_error & e) {
+		cerr << "*** Loading CTM file failed: " << e.what() << endl;
+		return false;
+	}
+	
+	const CTMfloat *vertices;
+	const CTMuint *indices;
+	const CTMfloat *normals = NULL;
+	const CTMfloat *tex_coords = NULL;
+	
+  unsigned int vertex_count = ctm.GetInteger(CTM_VERTEX_COUNT);
+ 	vertices = ctm.GetFloatArray(CTM_VERTICES);
+
+  unsigned int face_count = ctm.GetInteger(CTM_TRIANGLE_COUNT);
+  unsigned int index_count = face_count * 3;
+  indices = ctm.GetIntegerArray(CTM_INDICES);
+	
+	if (ctm.GetInteger(CTM_HAS_NORMALS) == CTM_TRUE) {
+		normals = ctm.GetFloatArray(CTM_NORMALS);
+	} else {
+		cerr << "*** normals not found" << endl;
+	}
+
+  unsigned int uv_map_count = ctm.GetInteger(CTM_UV_MAP_COUNT);
+  if (uv_map_count > 0) {
+    tex_coords = ctm.GetFloatArray(CTM_UV_MAP_1);
+  } else {
+    std::cerr << "*** uv map not found" << std::endl;
+  }
+
+	// tangents are always generated here, so every mesh gets the same basis with handedness
+	vector<float> tangents;
+	if (normals != NULL && tex_coords != NULL && vertex_count > 0) {
+		tangents.resize(4 * vertex_count);
+		compute_tangents(vertices, normals, tex_coords, vertex_count, indices, index_count, &tangents[0]);
+	}
+
+	delete mesh.cache;
+	mesh.cache = NULL;
+	mesh.vertices.resize(vertex_count);
+	for (unsigned int i = 0; i < vertex_count; i++) {
+		vertex_t &v = mesh.vertices[i];
+		
+		unsigned int j = 3*i;
+		v.position.x = vertices[j];
+		v.position.y = vertices[j + 1];
+		v.position.z = vertices[j + 2];
+		v.position.w = 1.0f;
+				
+		if (normals != NULL) {
+			v.normal.x = normals[j];
+			v.normal.y = normals[j + 1];
+			v.normal.z = normals[j + 2];
+		}
+
+		if (uv_map_count > 0) {
+			unsigned int k = 2*i;
+			v.tex_coord.x = tex_coords[k];
+			v.tex_coord.y = tex_coords[k + 1];			
+		}	
+		
+		if (!tangents.empty()) {
+			unsigned int l = 4*i;
+			v.tangent.x = tangents[l];
+			v.tangent.y = tangents[l + 1];
+			v.tangent.z = tangents[l + 2];
+			v.tangent.w = tangents[l + 3];
+		}
+	}
+
+  mesh.indices.assign(indices, indices + index_count);
+
+	mesh_optimization_t optimization;
+	optimize_mesh(mesh.indices, mesh.vertices.empty() ? NULL : &mesh.vertices[0].position.x, sizeof(vertex_t) / sizeof(float),
+	              vertex_count, optimization);
+	remap_vertex_stream(mesh.vertices, 1, optimization.remap, optimization.vertex_count);
+	optimization.report(cout, ctm_filepath);
+	mesh.bounds = compute_bounds(mesh.vertex_data(), mesh.vertex_count());
+	
+	return true;
+}
\ No newline at end of file
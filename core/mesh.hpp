@@ -0,0 +1,67 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <vector>
+#include <map>
+#include "gl.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shader.hpp"
+#include "mesh_cache.hpp"
+#include "vertex_format.hpp"
+#include "index_buffer.hpp"
+#include "bounds.hpp"
+
+class instance_buffer_t;
+
+struct mesh_t {
+	
+	std::vector<vertex_t> vertices;
+	std::vector<unsigned int> indices;
+	GLuint vertex_buffer_handle;
+	GLuint index_buffer_handle;
+	std::map<GLuint, std::vector<GLuint> > vertex_array_handles; // one per submesh, keyed by shader program handle
+	std::map<std::pair<GLuint, GLuint>, std::vector<GLuint> > instanced_vertex_array_handles; // also keyed by instance buffer id
+	GLenum index_type;
+	std::vector<submesh_t> submeshes;
+	mesh_cache_t *cache; // when set, vertices and indices are empty and the data lives in the mapped cache file
+	vertex_format_t vertex_format; // of the vertex buffer
+	vertex_quantization_t quantization;
+	aabb_t bounds; // of the positions, found when the mesh is read
+	
+	mesh_t();
+	mesh_t(const mesh_t &mesh);
+	~mesh_t();
+	mesh_t& operator=(const mesh_t &mesh);
+	
+	size_t vertex_count() const;
+	size_t index_count() const;
+	const vertex_t* vertex_data() const;
+	const unsigned int* index_data() const;
+	
+	// split_indices keeps 16-bit indices for meshes of more than 65536 vertices by drawing them in parts
+	void load_to_buffers(vertex_format_t format = VERTEX_FORMAT_FLOAT, bool split_indices = false);
+	// deletes the vertex arrays, instanced ones too, built for the buffers; the buffers themselves
+	// may be shared with copies
+	void release_buffers();
+	// leaves the vertex array of the last submesh bound; code drawing without one binds 0 through RENDER_STATE
+	void render(const shader_program_t &shader_program);
+	GLuint vertex_array(const shader_program_t &shader_program, size_t submesh = 0);
+	// one glDrawElementsInstanced per submesh for all of instances, see instance_buffer.hpp;
+	// needs instancing_supported()
+	void render_instanced(const shader_program_t &shader_program, const instance_buffer_t &instances);
+	GLuint instanced_vertex_array(const shader_program_t &shader_program, const instance_buffer_t &instances, size_t submesh = 0);
+	
+	// goes through the mesh cache next to the ctm file, and refreshes it when the ctm file changed;
+	// without the cache every load decodes the ctm file and generates the tangents again
+	static bool read_from_file(const char *ctm_filepath, mesh_t &mesh, bool use_cache = true);
+	static bool read_from_ctm_file(const char *ctm_filepath, mesh_t &mesh);
+	
+};
+
+// for the vertex array and GL_ARRAY_BUFFER bound, of vertices from base_vertex on
+void set_vertex_attributes(const shader_program_t &shader_program, vertex_format_t format, size_t base_vertex = 0);
+void set_vertex_format_uniforms(const shader_program_t &shader_program, vertex_format_t format, const vertex_quantization_t &quantization);
+
+#endif
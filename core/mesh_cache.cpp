@@ -0,0 +1,185 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include "mesh_cache.hpp"
+#include "mapped_file.hpp"
+
+using namespace std;
+
+static const char MAGIC[8] = { 'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H' };
+
+struct mesh_cache_chunk_header_t {
+	uint32_t id;
+	uint32_t element_size;
+	uint64_t element_count;
+	uint64_t offset;
+};
+
+struct mesh_cache_header_t {
+	char magic[8];
+	uint32_t version;
+	uint32_t chunk_count;
+	uint64_t source_hash;
+	mesh_cache_chunk_header_t chunks[mesh_cache_t::MAX_CHUNK_COUNT];
+};
+
+static size_t align(size_t offset) {
+	return (offset + mesh_cache_t::ALIGNMENT - 1) & ~(size_t)(mesh_cache_t::ALIGNMENT - 1);
+}
+
+mesh_cache_t::mesh_cache_t() : __data(NULL), __size(0) {
+}
+
+mesh_cache_t::~mesh_cache_t() {
+	close();
+}
+
+bool mesh_cache_t::open(const char *cache_filepath, uint64_t source_hash) {
+	close();
+
+	__data = map_file(cache_filepath, __size);
+	if (__data == NULL)
+		return false;
+
+	const mesh_cache_header_t *header = static_cast<const mesh_cache_header_t *>(__data);
+	bool valid = __size >= sizeof(mesh_cache_header_t)
+		&& memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+		&& header->version == VERSION
+		&& header->source_hash == source_hash
+		&& header->chunk_count <= MAX_CHUNK_COUNT;
+	for (uint32_t i = 0; valid && i < header->chunk_count; i++) {
+		const mesh_cache_chunk_header_t &chunk = header->chunks[i];
+		valid = chunk.offset <= __size && chunk.element_count * chunk.element_size <= __size - chunk.offset;
+	}
+	if (!valid) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void mesh_cache_t::close() {
+	if (__data != NULL)
+		unmap_file(__data, __size);
+	__data = NULL;
+	__size = 0;
+}
+
+const void* mesh_cache_t::chunk_data(unsigned int id, size_t element_size, size_t &element_count) const {
+	if (__data == NULL)
+		return NULL;
+
+	const mesh_cache_header_t *header = static_cast<const mesh_cache_header_t *>(__data);
+	for (uint32_t i = 0; i < header->chunk_count; i++) {
+		const mesh_cache_chunk_header_t &chunk = header->chunks[i];
+		if (chunk.id == id && chunk.element_size == element_size) {
+			element_count = chunk.element_count;
+			return static_cast<const char *>(__data) + chunk.offset;
+		}
+	}
+	return NULL;
+}
+
+bool mesh_cache_t::write(const char *cache_filepath, uint64_t source_hash, const vector<chunk_t> &chunks) {
+	if (chunks.size() > MAX_CHUNK_COUNT)
+		return false;
+
+	mesh_cache_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.chunk_count = chunks.size();
+	header.source_hash = source_hash;
+
+	size_t offset = align(sizeof(header));
+	for (size_t i = 0; i < chunks.size(); i++) {
+		header.chunks[i].id = chunks[i].id;
+		header.chunks[i].element_size = chunks[i].element_size;
+		header.chunks[i].element_count = chunks[i].element_count;
+		header.chunks[i].offset = offset;
+		offset = align(offset + chunks[i].element_size * chunks[i].element_count);
+	}
+
+	// written aside and renamed, so a reader never maps a half written file
+	string temporary_filepath = string(cache_filepath) + ".tmp";
+	FILE *file = fopen(temporary_filepath.c_str(), "wb");
+	if (file == NULL)
+		return false;
+
+	static const char padding[ALIGNMENT] = { 0 };
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	size_t position = sizeof(header);
+	for (size_t i = 0; written && i < chunks.size(); i++) {
+		size_t size = chunks[i].element_size * chunks[i].element_count;
+		written = fwrite(padding, 1, header.chunks[i].offset - position, file) == header.chunks[i].offset - position
+			&& fwrite(chunks[i].data, 1, size, file) == size;
+		position = header.chunks[i].offset + size;
+	}
+	written = (fclose(file) == 0) && written;
+
+	if (!written || rename(temporary_filepath.c_str(), cache_filepath) != 0) {
+		remove(temporary_filepath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool mesh_cache_t::hash_file(const char *filepath, uint64_t &hash) {
+	size_t size;
+	void *data = map_file(filepath, size);
+	if (data == NULL)
+		return false;
+
+	// FNV-1a, 64 bit
+	hash = 14695981039346656037ULL;
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	unmap_file(data, size);
+	return true;
+}
+
+string mesh_cache_t::filepath_for(const char *source_filepath, const char *layout) {
+	if (layout == NULL)
+		return string(source_filepath) + ".meshcache";
+	return string(source_filepath) + "." + layout + ".meshcache";
+}
+
+bool mesh_cache_t::read_streams(const char *source_filepath, vector<unsigned int> &indices, const vector<stream_t> &streams,
+                                read_source_t read_source, void *context) {
+	uint64_t source_hash;
+	if (!hash_file(source_filepath, source_hash)) {
+		cerr << "*** Loading CTM file failed: " << source_filepath << endl;
+		return false;
+	}
+
+	// the streams are copied out of the mapping, since they live in vectors
+	string cache_filepath = filepath_for(source_filepath, "streams");
+	mesh_cache_t cache;
+	bool hit = cache.open(cache_filepath.c_str(), source_hash) && cache.copy_chunk(INDICES, indices);
+	for (size_t i = 0; hit && i < streams.size(); i++)
+		hit = cache.copy_chunk(streams[i].id, *streams[i].values);
+	if (hit)
+		return true;
+	cache.close();
+
+	// a partial hit must not leave streams behind that the source does not have
+	indices.clear();
+	for (size_t i = 0; i < streams.size(); i++)
+		streams[i].values->clear();
+	if (!read_source(source_filepath, context))
+		return false;
+
+	vector<chunk_t> chunks;
+	add_chunk(chunks, INDICES, indices);
+	for (size_t i = 0; i < streams.size(); i++)
+		add_chunk(chunks, streams[i].id, *streams[i].values);
+	if (!write(cache_filepath.c_str(), source_hash, chunks))
+		cerr << "*** Writing mesh cache failed: " << cache_filepath << endl;
+
+	return true;
+}
@@ -0,0 +1,103 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+// Binary cache of decoded mesh data, stored next to its source file and keyed by
+// a hash of the source contents. The file is a header followed by page aligned
+// chunks, and is memory mapped so the chunks can be handed to glBufferData as is.
+class mesh_cache_t {
+
+public:
+
+	enum {
+		VERSION = 3,
+		ALIGNMENT = 4096,
+		MAX_CHUNK_COUNT = 8
+	};
+
+	enum chunk_id_t {
+		VERTICES = 1,   // interleaved vertex_t
+		INDICES,
+		POSITIONS,      // separate streams of the demos with their own mesh_t, see read_streams
+		NORMALS,
+		TEX_COORDS,
+		TANGENTS,
+		BOUNDS          // one aabb_t
+	};
+
+	struct chunk_t {
+		unsigned int id;
+		size_t element_size;
+		size_t element_count;
+		const void *data;
+	};
+
+	// one vector of floats per attribute, the way the demos with their own mesh_t keep them
+	struct stream_t {
+		unsigned int id;
+		std::vector<float> *values;
+	};
+
+	// reads the mesh from source_filepath, filling the indices and streams given to read_streams
+	typedef bool (*read_source_t)(const char *source_filepath, void *context);
+
+	mesh_cache_t();
+	~mesh_cache_t();
+
+	// fails when the file is missing, of another version or built from other source contents
+	bool open(const char *cache_filepath, uint64_t source_hash);
+	void close();
+	bool is_open() const { return __data != NULL; }
+
+	// NULL when the chunk is missing or was written with another element size
+	const void* chunk_data(unsigned int id, size_t element_size, size_t &element_count) const;
+
+	template <typename T>
+	bool copy_chunk(unsigned int id, std::vector<T> &values) const {
+		size_t count;
+		const T *data = static_cast<const T *>(chunk_data(id, sizeof(T), count));
+		if (data == NULL)
+			return false;
+		values.assign(data, data + count);
+		return true;
+	}
+
+	// an empty vector is added too, so that a cache without the chunk is told apart from a
+	// source without the attribute
+	template <typename T>
+	static void add_chunk(std::vector<chunk_t> &chunks, unsigned int id, const std::vector<T> &values) {
+		chunk_t chunk;
+		chunk.id = id;
+		chunk.element_size = sizeof(T);
+		chunk.element_count = values.size();
+		chunk.data = values.empty() ? NULL : &values[0];
+		chunks.push_back(chunk);
+	}
+
+	static bool write(const char *cache_filepath, uint64_t source_hash, const std::vector<chunk_t> &chunks);
+	static bool hash_file(const char *filepath, uint64_t &hash);
+	// layout names the chunks a kind of reader expects, so readers of different layouts keep
+	// separate files instead of overwriting each other's
+	static std::string filepath_for(const char *source_filepath, const char *layout = NULL);
+
+	// Copies the indices and every stream out of the cache next to source_filepath. When the
+	// cache is stale or misses one of the streams, calls read_source instead and writes all of
+	// them back, so readers asking for more streams than the last writer grow the cache.
+	static bool read_streams(const char *source_filepath, std::vector<unsigned int> &indices, const std::vector<stream_t> &streams,
+	                         read_source_t read_source, void *context);
+
+private:
+
+	mesh_cache_t(const mesh_cache_t &);
+	mesh_cache_t& operator=(const mesh_cache_t &);
+
+	void *__data;
+	size_t __size;
+
+};
+
+#endif
@@ -0,0 +1,287 @@
+#include <cmath>
+#include <algorithm>
+#include "mesh_optimizer.hpp"
+
+using namespace std;
+
+// FIFO cache simulation: a vertex is still cached when fewer than cache_size misses happened since its own
+struct fifo_cache_t {
+	vector<size_t> timestamps;
+	size_t time;
+	size_t size;
+
+	fifo_cache_t(size_t vertex_count, size_t cache_size) : timestamps(vertex_count, 0), time(cache_size + 1), size(cache_size) { }
+
+	void flush() {
+		time += size + 1;
+	}
+
+	bool miss(unsigned int vertex) {
+		if (time - timestamps[vertex] <= size)
+			return false;
+		timestamps[vertex] = time++;
+		return true;
+	}
+
+	size_t triangle_misses(const unsigned int *triangle) {
+		return miss(triangle[0]) + miss(triangle[1]) + miss(triangle[2]);
+	}
+};
+
+vertex_cache_stats_t analyze_vertex_cache(const unsigned int *indices, size_t index_count, size_t vertex_count, size_t cache_size) {
+	fifo_cache_t cache(vertex_count, cache_size);
+	vector<bool> used(vertex_count, false);
+	size_t misses = 0;
+	size_t used_count = 0;
+	for (size_t i = 0; i < index_count; i++) {
+		misses += cache.miss(indices[i]);
+		if (!used[indices[i]]) {
+			used[indices[i]] = true;
+			used_count++;
+		}
+	}
+
+	vertex_cache_stats_t stats;
+	stats.acmr = index_count > 0 ? (float)misses / (index_count / 3) : 0.0f;
+	stats.atvr = used_count > 0 ? (float)misses / used_count : 0.0f;
+	return stats;
+}
+
+// the triangles around every vertex, packed
+struct adjacency_t {
+	vector<unsigned int> offsets;
+	vector<unsigned int> triangles;
+
+	adjacency_t(const unsigned int *indices, size_t index_count, size_t vertex_count) : offsets(vertex_count + 1, 0), triangles(index_count) {
+		for (size_t i = 0; i < index_count; i++)
+			offsets[indices[i] + 1]++;
+		for (size_t v = 0; v < vertex_count; v++)
+			offsets[v + 1] += offsets[v];
+		vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < index_count; i++)
+			triangles[fill[indices[i]]++] = i / 3;
+	}
+};
+
+void optimize_vertex_cache(unsigned int *indices, size_t index_count, size_t vertex_count,
+                           vector<size_t> &clusters, size_t cache_size) {
+	clusters.clear();
+	size_t face_count = index_count / 3;
+	if (face_count == 0)
+		return;
+
+	adjacency_t adjacency(indices, index_count, vertex_count);
+	vector<unsigned int> live(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+		live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+	vector<size_t> timestamps(vertex_count, 0);
+	size_t time = cache_size + 1;
+	vector<bool> emitted(face_count, false);
+	vector<unsigned int> dead_end;
+	vector<unsigned int> candidates;
+	vector<unsigned int> result;
+	result.reserve(index_count);
+
+	size_t cursor = 0;
+	while (cursor < vertex_count && live[cursor] == 0)
+		cursor++;
+	long fanning = cursor < vertex_count ? (long)cursor : -1;
+	clusters.push_back(0);
+
+	while (fanning >= 0) {
+		candidates.clear();
+		for (unsigned int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++) {
+			unsigned int face = adjacency.triangles[a];
+			if (emitted[face])
+				continue;
+			emitted[face] = true;
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = indices[3 * face + k];
+				result.push_back(v);
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - timestamps[v] > cache_size)
+					timestamps[v] = time++;
+			}
+		}
+
+		// the candidate that stays in the cache after its remaining triangles are emitted and is oldest
+		long next = -1;
+		long best_priority = -1;
+		for (size_t i = 0; i < candidates.size(); i++) {
+			unsigned int v = candidates[i];
+			if (live[v] == 0)
+				continue;
+			long priority = 0;
+			if (time - timestamps[v] + 2 * live[v] <= cache_size)
+				priority = time - timestamps[v];
+			if (priority > best_priority) {
+				best_priority = priority;
+				next = v;
+			}
+		}
+
+		if (next < 0) {
+			// a dead end: anything recently used, else the next vertex in input order; either way a new cluster
+			while (!dead_end.empty() && next < 0) {
+				unsigned int v = dead_end.back();
+				dead_end.pop_back();
+				if (live[v] > 0)
+					next = v;
+			}
+			while (next < 0 && cursor < vertex_count) {
+				if (live[cursor] > 0)
+					next = cursor;
+				else
+					cursor++;
+			}
+			if (next >= 0)
+				clusters.push_back(result.size() / 3);
+		}
+		fanning = next;
+	}
+
+	copy(result.begin(), result.end(), indices);
+}
+
+static size_t soft_boundaries(const unsigned int *indices, size_t index_count, size_t vertex_count,
+                              const vector<size_t> &clusters, float threshold, size_t cache_size, vector<size_t> &result) {
+	size_t face_count = index_count / 3;
+	fifo_cache_t cache(vertex_count, cache_size);
+	result.clear();
+	for (size_t c = 0; c < clusters.size(); c++) {
+		size_t begin = clusters[c];
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : face_count;
+		if (begin == end)
+			continue;
+
+		cache.flush();
+		size_t cluster_misses = 0;
+		for (size_t f = begin; f < end; f++)
+			cluster_misses += cache.triangle_misses(indices + 3 * f);
+		float cluster_threshold = threshold * cluster_misses / (end - begin);
+
+		// start a new cluster as soon as the running miss rate is back under the cluster's own
+		result.push_back(begin);
+		cache.flush();
+		size_t misses = 0, faces = 0;
+		for (size_t f = begin; f < end; f++) {
+			misses += cache.triangle_misses(indices + 3 * f);
+			faces++;
+			if ((float)misses / faces <= cluster_threshold && f + 1 < end) {
+				result.push_back(f + 1);
+				cache.flush();
+				misses = faces = 0;
+			}
+		}
+	}
+	return result.size();
+}
+
+struct cluster_order_t {
+	size_t begin;
+	size_t end;
+	float key;
+
+	bool operator<(const cluster_order_t &other) const { return key > other.key; }
+};
+
+void optimize_overdraw(unsigned int *indices, size_t index_count, const float *positions, size_t position_stride,
+                       size_t vertex_count, const vector<size_t> &clusters, float threshold, size_t cache_size) {
+	size_t face_count = index_count / 3;
+	if (face_count == 0 || clusters.empty())
+		return;
+
+	vector<size_t> boundaries;
+	soft_boundaries(indices, index_count, vertex_count, clusters, threshold, cache_size, boundaries);
+
+	// area weighted centroid of the whole mesh
+	double mesh_center[3] = { 0.0, 0.0, 0.0 };
+	double mesh_area = 0.0;
+	vector<float> face_data(7 * face_count); // area weighted normal, area, area weighted centroid
+	for (size_t f = 0; f < face_count; f++) {
+		const float *p0 = positions + position_stride * indices[3 * f];
+		const float *p1 = positions + position_stride * indices[3 * f + 1];
+		const float *p2 = positions + position_stride * indices[3 * f + 2];
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float *d = &face_data[7 * f];
+		d[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		d[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		d[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		d[3] = 0.5f * sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		for (int c = 0; c < 3; c++) {
+			d[4 + c] = d[3] * (p0[c] + p1[c] + p2[c]) / 3.0f;
+			mesh_center[c] += d[4 + c];
+		}
+		mesh_area += d[3];
+	}
+	for (int c = 0; c < 3; c++)
+		mesh_center[c] = mesh_area > 0.0 ? mesh_center[c] / mesh_area : 0.0;
+
+	// clusters facing away from the center, and so likely in front of the rest, go first
+	vector<cluster_order_t> order(boundaries.size());
+	for (size_t c = 0; c < boundaries.size(); c++) {
+		order[c].begin = boundaries[c];
+		order[c].end = c + 1 < boundaries.size() ? boundaries[c + 1] : face_count;
+		double normal[3] = { 0.0, 0.0, 0.0 }, center[3] = { 0.0, 0.0, 0.0 }, area = 0.0;
+		for (size_t f = order[c].begin; f < order[c].end; f++) {
+			const float *d = &face_data[7 * f];
+			for (int k = 0; k < 3; k++) {
+				normal[k] += d[k];
+				center[k] += d[4 + k];
+			}
+			area += d[3];
+		}
+		double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		double key = 0.0;
+		if (area > 0.0 && length > 0.0) {
+			for (int k = 0; k < 3; k++)
+				key += (center[k] / area - mesh_center[k]) * normal[k] / length;
+		}
+		order[c].key = (float)key;
+	}
+	stable_sort(order.begin(), order.end());
+
+	vector<unsigned int> result;
+	result.reserve(index_count);
+	for (size_t c = 0; c < order.size(); c++)
+		result.insert(result.end(), indices + 3 * order[c].begin, indices + 3 * order[c].end);
+	copy(result.begin(), result.end(), indices);
+}
+
+size_t optimize_vertex_fetch(unsigned int *indices, size_t index_count, size_t vertex_count, vector<unsigned int> &remap) {
+	remap.assign(vertex_count, ~0u);
+	unsigned int next = 0;
+	for (size_t i = 0; i < index_count; i++) {
+		unsigned int &target = remap[indices[i]];
+		if (target == ~0u)
+			target = next++;
+		indices[i] = target;
+	}
+	return next;
+}
+
+void optimize_mesh(vector<unsigned int> &indices, const float *positions, size_t position_stride,
+                   size_t vertex_count, mesh_optimization_t &result) {
+	result.remap.clear();
+	result.vertex_count = vertex_count;
+	if (indices.empty()) {
+		result.before = result.after = analyze_vertex_cache(NULL, 0, vertex_count);
+		return;
+	}
+
+	result.before = analyze_vertex_cache(&indices[0], indices.size(), vertex_count);
+	vector<size_t> clusters;
+	optimize_vertex_cache(&indices[0], indices.size(), vertex_count, clusters);
+	optimize_overdraw(&indices[0], indices.size(), positions, position_stride, vertex_count, clusters);
+	result.vertex_count = optimize_vertex_fetch(&indices[0], indices.size(), vertex_count, result.remap);
+	result.after = analyze_vertex_cache(&indices[0], indices.size(), result.vertex_count);
+}
+
+void mesh_optimization_t::report(ostream &out, const char *name) const {
+	out << name << ": ACMR " << before.acmr << " -> " << after.acmr
+	    << ", ATVR " << before.atvr << " -> " << after.atvr << endl;
+}
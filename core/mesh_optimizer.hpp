@@ -0,0 +1,63 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <vector>
+#include <iostream>
+#include <cstddef>
+
+// Import-time reordering of an indexed triangle list, after Sander, Nehab and Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007):
+// Tipsify for the post-transform vertex cache, then the clusters it leaves behind are
+// split further and sorted outside-in against overdraw, then the vertices are renumbered
+// in the order the triangles first use them so vertex fetch walks memory forward.
+
+struct vertex_cache_stats_t {
+	float acmr; // transformed vertices per triangle, 0.5 at best
+	float atvr; // transformed vertices per used vertex, 1.0 at best
+};
+
+// a FIFO cache of cache_size entries, the way most hardware of the GL 2 era works
+vertex_cache_stats_t analyze_vertex_cache(const unsigned int *indices, size_t index_count, size_t vertex_count, size_t cache_size = 16);
+
+// reorders the triangles in place; clusters receives the first triangle of every cluster
+void optimize_vertex_cache(unsigned int *indices, size_t index_count, size_t vertex_count,
+                           std::vector<size_t> &clusters, size_t cache_size = 16);
+
+// keeps the triangle order within each cluster, and allows the cache miss rate to rise
+// by threshold at most when splitting them
+void optimize_overdraw(unsigned int *indices, size_t index_count, const float *positions, size_t position_stride,
+                       size_t vertex_count, const std::vector<size_t> &clusters, float threshold = 1.05f, size_t cache_size = 16);
+
+// renumbers the vertices by first use; remap[old] is the new index, or ~0u when no triangle uses it.
+// Returns the vertex count after dropping the unused ones.
+size_t optimize_vertex_fetch(unsigned int *indices, size_t index_count, size_t vertex_count, std::vector<unsigned int> &remap);
+
+// an empty remap, which optimize_mesh leaves for a mesh without triangles, keeps the stream as it is
+template <typename T>
+void remap_vertex_stream(std::vector<T> &stream, size_t components, const std::vector<unsigned int> &remap, size_t vertex_count) {
+	if (stream.empty() || remap.empty())
+		return;
+	std::vector<T> result(vertex_count * components);
+	for (size_t i = 0; i < remap.size(); i++) {
+		if (remap[i] == ~0u)
+			continue;
+		for (size_t c = 0; c < components; c++)
+			result[remap[i] * components + c] = stream[i * components + c];
+	}
+	stream.swap(result);
+}
+
+struct mesh_optimization_t {
+	vertex_cache_stats_t before;
+	vertex_cache_stats_t after;
+	std::vector<unsigned int> remap; // to apply to every vertex stream with remap_vertex_stream; empty without triangles
+	size_t vertex_count;
+
+	void report(std::ostream &out, const char *name) const;
+};
+
+// all three passes; position_stride is in floats, and positions may be NULL when there are no indices
+void optimize_mesh(std::vector<unsigned int> &indices, const float *positions, size_t position_stride,
+                   size_t vertex_count, mesh_optimization_t &result);
+
+#endif
@@ -0,0 +1,306 @@
+#include <cmath>
+#include <algorithm>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#include "parallel.hpp"
+#include "mipmap.hpp"
+
+using namespace std;
+
+// taps of the Kaiser filter at -3.5 .. 3.5 source pixels from the centre of an output pixel
+static const size_t KAISER_TAPS = 8;
+static const float KAISER_WIDTH = 4.0f;
+static const float KAISER_ALPHA = 4.0f;
+static const size_t LINEAR_TO_SRGB_SIZE = 4096;
+
+static double bessel_i0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (x * x) / (4.0 * k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+struct filter_tables_t {
+	float srgb_to_linear[256];
+	unsigned char linear_to_srgb[LINEAR_TO_SRGB_SIZE];
+	float kaiser[KAISER_TAPS];
+
+	filter_tables_t() {
+		for (size_t i = 0; i < 256; i++) {
+			double c = i / 255.0;
+			srgb_to_linear[i] = (c <= 0.04045) ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+		}
+		for (size_t i = 0; i < LINEAR_TO_SRGB_SIZE; i++) {
+			double l = (double)i / (LINEAR_TO_SRGB_SIZE - 1);
+			double c = (l <= 0.0031308) ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+			linear_to_srgb[i] = (unsigned char)(c * 255.0 + 0.5);
+		}
+		double sum = 0.0, weights[KAISER_TAPS];
+		for (size_t k = 0; k < KAISER_TAPS; k++) {
+			// half-band sinc for the 2:1 reduction, windowed over KAISER_WIDTH source pixels either side
+			double d = k - 3.5, x = M_PI * d / 2.0, r = d / KAISER_WIDTH;
+			weights[k] = (sin(x) / x) * bessel_i0(KAISER_ALPHA * sqrt(max(0.0, 1.0 - r * r))) / bessel_i0(KAISER_ALPHA);
+			sum += weights[k];
+		}
+		for (size_t k = 0; k < KAISER_TAPS; k++)
+			kaiser[k] = weights[k] / sum;
+	}
+};
+
+// built before main, so worker threads only ever read it
+static const filter_tables_t tables;
+
+// four floats per pixel, linear light for colour and -1..1 vectors for normals
+struct float_level_t {
+	size_t width;
+	size_t height;
+	vector<float> pixels;
+};
+
+struct convert_job_t {
+	const unsigned char *bytes;
+	unsigned char *target_bytes;
+	float_level_t *level;
+	mip_content_t content;
+};
+
+struct filter_job_t {
+	const float_level_t *source;
+	float_level_t *target;
+};
+
+static unsigned char to_byte(float value) {
+	return (unsigned char)(min(max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+static void decode_rows(size_t begin, size_t end, void *context) {
+	const convert_job_t *job = static_cast<const convert_job_t *>(context);
+	size_t width = job->level->width;
+	for (size_t i = begin * width; i < end * width; i++) {
+		const unsigned char *in = job->bytes + 4 * i;
+		float *out = &job->level->pixels[4 * i];
+		for (size_t c = 0; c < 3; c++) {
+			if (job->content == MIP_CONTENT_COLOR)
+				out[c] = tables.srgb_to_linear[in[c]];
+			else if (job->content == MIP_CONTENT_NORMAL)
+				out[c] = in[c] * (2.0f / 255.0f) - 1.0f;
+			else
+				out[c] = in[c] * (1.0f / 255.0f);
+		}
+		out[3] = in[3] * (1.0f / 255.0f);
+	}
+}
+
+static void encode_rows(size_t begin, size_t end, void *context) {
+	const convert_job_t *job = static_cast<const convert_job_t *>(context);
+	size_t width = job->level->width;
+	for (size_t i = begin * width; i < end * width; i++) {
+		const float *in = &job->level->pixels[4 * i];
+		unsigned char *out = job->target_bytes + 4 * i;
+		if (job->content == MIP_CONTENT_COLOR) {
+			for (size_t c = 0; c < 3; c++)
+				out[c] = tables.linear_to_srgb[(size_t)(min(max(in[c], 0.0f), 1.0f) * (LINEAR_TO_SRGB_SIZE - 1) + 0.5f)];
+		} else if (job->content == MIP_CONTENT_NORMAL) {
+			// averaging shortens the vectors; a cancelled out one points straight up
+			float length = sqrt(in[0] * in[0] + in[1] * in[1] + in[2] * in[2]);
+			float n[3] = { 0.0f, 0.0f, 1.0f };
+			if (length > 1.0e-6f) {
+				for (size_t c = 0; c < 3; c++)
+					n[c] = in[c] / length;
+			}
+			for (size_t c = 0; c < 3; c++)
+				out[c] = to_byte(n[c] * 0.5f + 0.5f);
+		} else {
+			for (size_t c = 0; c < 3; c++)
+				out[c] = to_byte(in[c]);
+		}
+		out[3] = to_byte(in[3]);
+	}
+}
+
+// the source rows or columns averaged into target i: two, or three for the last one of an odd
+// size above 1, so no source row or column is dropped
+struct box_taps_t {
+	size_t index[3];
+	float weight[3];
+};
+
+static box_taps_t box_taps(size_t i, size_t source_size, size_t target_size) {
+	box_taps_t taps;
+	taps.index[0] = min(2 * i, source_size - 1);
+	taps.index[1] = taps.index[2] = min(2 * i + 1, source_size - 1);
+	taps.weight[0] = taps.weight[1] = 0.5f;
+	taps.weight[2] = 0.0f;
+	if (i + 1 == target_size && source_size > 1 && source_size % 2 == 1) {
+		taps.index[2] = 2 * i + 2;
+		taps.weight[0] = taps.weight[1] = taps.weight[2] = 1.0f / 3.0f;
+	}
+	return taps;
+}
+
+// 2x2 average, 2x3, 3x2 or 3x3 along an odd last row or column
+static void box_rows(size_t begin, size_t end, void *context) {
+	const filter_job_t *job = static_cast<const filter_job_t *>(context);
+	const float_level_t &source = *(job->source);
+	float_level_t &target = *(job->target);
+	for (size_t y = begin; y < end; y++) {
+		box_taps_t rows = box_taps(y, source.height, target.height);
+		const float *row0 = &source.pixels[4 * rows.index[0] * source.width];
+		const float *row1 = &source.pixels[4 * rows.index[1] * source.width];
+		float *out = &target.pixels[4 * y * target.width];
+		for (size_t x = 0; x < target.width; x++) {
+			box_taps_t columns = box_taps(x, source.width, target.width);
+			if (rows.weight[2] != 0.0f || columns.weight[2] != 0.0f) {
+				for (size_t c = 0; c < 4; c++) {
+					float sum = 0.0f;
+					for (size_t j = 0; j < 3; j++) {
+						const float *row = &source.pixels[4 * rows.index[j] * source.width];
+						for (size_t i = 0; i < 3; i++)
+							sum += rows.weight[j] * columns.weight[i] * row[4 * columns.index[i] + c];
+					}
+					out[4 * x + c] = sum;
+				}
+				continue;
+			}
+			size_t x0 = 4 * columns.index[0], x1 = 4 * columns.index[1];
+#ifdef __SSE__
+			__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+			                        _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+			_mm_storeu_ps(out + 4 * x, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+			for (size_t c = 0; c < 4; c++)
+				out[4 * x + c] = 0.25f * (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]);
+#endif
+		}
+	}
+}
+
+// halves the width; target has the source height
+static void kaiser_horizontal_rows(size_t begin, size_t end, void *context) {
+	const filter_job_t *job = static_cast<const filter_job_t *>(context);
+	const float_level_t &source = *(job->source);
+	float_level_t &target = *(job->target);
+	long last = source.width - 1;
+	for (size_t y = begin; y < end; y++) {
+		const float *row = &source.pixels[4 * y * source.width];
+		float *out = &target.pixels[4 * y * target.width];
+		for (size_t x = 0; x < target.width; x++) {
+#ifdef __SSE__
+			__m128 sum = _mm_setzero_ps();
+			for (size_t k = 0; k < KAISER_TAPS; k++) {
+				long s = min(max((long)(2 * x + k) - 3, 0L), last);
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + 4 * s), _mm_set1_ps(tables.kaiser[k])));
+			}
+			_mm_storeu_ps(out + 4 * x, sum);
+#else
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (size_t k = 0; k < KAISER_TAPS; k++) {
+				long s = min(max((long)(2 * x + k) - 3, 0L), last);
+				for (size_t c = 0; c < 4; c++)
+					sum[c] += row[4 * s + c] * tables.kaiser[k];
+			}
+			copy(sum, sum + 4, out + 4 * x);
+#endif
+		}
+	}
+}
+
+// halves the height; target has the source width. Whole rows are accumulated tap by tap,
+// so the inner loop streams through memory
+static void kaiser_vertical_rows(size_t begin, size_t end, void *context) {
+	const filter_job_t *job = static_cast<const filter_job_t *>(context);
+	const float_level_t &source = *(job->source);
+	float_level_t &target = *(job->target);
+	long last = source.height - 1;
+	size_t row_size = 4 * target.width;
+	for (size_t y = begin; y < end; y++) {
+		float *out = &target.pixels[y * row_size];
+		fill(out, out + row_size, 0.0f);
+		for (size_t k = 0; k < KAISER_TAPS; k++) {
+			long s = min(max((long)(2 * y + k) - 3, 0L), last);
+			const float *row = &source.pixels[s * row_size];
+#ifdef __SSE__
+			__m128 weight = _mm_set1_ps(tables.kaiser[k]);
+			for (size_t i = 0; i < row_size; i += 4)
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(row + i), weight)));
+#else
+			for (size_t i = 0; i < row_size; i++)
+				out[i] += row[i] * tables.kaiser[k];
+#endif
+		}
+	}
+}
+
+static void resize_level(float_level_t &level, size_t width, size_t height) {
+	level.width = width;
+	level.height = height;
+	level.pixels.resize(4 * width * height);
+}
+
+static void downsample(const float_level_t &source, float_level_t &target, float_level_t &scratch, mip_filter_t filter) {
+	size_t width = max(source.width / 2, (size_t)1), height = max(source.height / 2, (size_t)1);
+	filter_job_t job;
+	if (filter == MIP_FILTER_BOX) {
+		resize_level(target, width, height);
+		job.source = &source;
+		job.target = &target;
+		parallel_for(height, box_rows, &job, 16);
+		return;
+	}
+
+	// separable; an axis already down to one pixel is left alone
+	const float_level_t *current = &source;
+	if (source.width > 1) {
+		float_level_t &horizontal = (source.height > 1) ? scratch : target;
+		resize_level(horizontal, width, source.height);
+		job.source = current;
+		job.target = &horizontal;
+		parallel_for(source.height, kaiser_horizontal_rows, &job, 16);
+		current = &horizontal;
+	}
+	if (source.height > 1) {
+		resize_level(target, width, height);
+		job.source = current;
+		job.target = &target;
+		parallel_for(height, kaiser_vertical_rows, &job, 16);
+	}
+}
+
+void generate_mip_chain(const unsigned char *rgba, size_t width, size_t height, mip_content_t content, mip_filter_t filter,
+                        vector<mip_level_t> &levels) {
+	levels.clear();
+	if (width == 0 || height == 0)
+		return;
+
+	levels.push_back(mip_level_t());
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].pixels.assign(rgba, rgba + 4 * width * height);
+
+	// the two levels swap roles as the chain goes down
+	float_level_t buffers[3];
+	float_level_t *source = &buffers[0], *target = &buffers[1], &scratch = buffers[2];
+	resize_level(*source, width, height);
+	convert_job_t job;
+	job.bytes = rgba;
+	job.level = source;
+	job.content = content;
+	parallel_for(height, decode_rows, &job, 16);
+
+	while (source->width > 1 || source->height > 1) {
+		downsample(*source, *target, scratch, filter);
+		swap(source, target);
+
+		levels.push_back(mip_level_t());
+		mip_level_t &level = levels.back();
+		level.width = source->width;
+		level.height = source->height;
+		level.pixels.resize(4 * level.width * level.height);
+		job.target_bytes = &level.pixels[0];
+		job.level = source;
+		parallel_for(level.height, encode_rows, &job, 16);
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef MIPMAP_HPP
+#define MIPMAP_HPP
+
+#include <vector>
+#include <cstddef>
+
+enum mip_content_t {
+	MIP_CONTENT_COLOR,  // sRGB encoded; averaged in linear light
+	MIP_CONTENT_LINEAR, // data such as height maps; averaged as stored
+	MIP_CONTENT_NORMAL  // xyz packed as 0.5 * n + 0.5; renormalized after filtering
+};
+
+enum mip_filter_t {
+	MIP_FILTER_BOX,    // 2x2 average, 3 taps along an odd last row or column
+	MIP_FILTER_KAISER  // 8 tap Kaiser windowed sinc, sharper than the box and with less aliasing
+};
+
+struct mip_level_t {
+	size_t width;
+	size_t height;
+	std::vector<unsigned char> pixels; // RGBA8
+};
+
+// levels gets the whole chain down to 1x1, starting with a copy of the source. Every level
+// is filtered from the full precision one above it, not from its 8 bit rounding.
+void generate_mip_chain(const unsigned char *rgba, size_t width, size_t height, mip_content_t content, mip_filter_t filter,
+                        std::vector<mip_level_t> &levels);
+
+#endif
@@ -0,0 +1,58 @@
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.hpp"
+
+using namespace std;
+
+struct parallel_range_t {
+	size_t begin;
+	size_t end;
+	parallel_range_function function;
+	void *context;
+};
+
+static void* run_range(void *argument) {
+	const parallel_range_t *range = static_cast<const parallel_range_t *>(argument);
+	range->function(range->begin, range->end, range->context);
+	return NULL;
+}
+
+size_t hardware_thread_count() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? count : 1;
+}
+
+void parallel_for(size_t count, parallel_range_function function, void *context, size_t min_range_size) {
+	if (count == 0)
+		return;
+
+	size_t range_count = hardware_thread_count();
+	if (min_range_size > 0 && count / min_range_size < range_count)
+		range_count = count / min_range_size;
+	if (range_count <= 1) {
+		function(0, count, context);
+		return;
+	}
+
+	vector<parallel_range_t> ranges(range_count);
+	for (size_t i = 0; i < range_count; i++) {
+		ranges[i].begin = count * i / range_count;
+		ranges[i].end = count * (i + 1) / range_count;
+		ranges[i].function = function;
+		ranges[i].context = context;
+	}
+
+	vector<pthread_t> threads(range_count);
+	vector<bool> started(range_count, false);
+	for (size_t i = 1; i < range_count; i++)
+		started[i] = pthread_create(&threads[i], NULL, run_range, &ranges[i]) == 0;
+
+	run_range(&ranges[0]);
+	for (size_t i = 1; i < range_count; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			run_range(&ranges[i]); // out of threads; do it here
+	}
+}
@@ -0,0 +1,14 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <cstddef>
+
+typedef void (*parallel_range_function)(size_t begin, size_t end, void *context);
+
+size_t hardware_thread_count();
+
+// splits [0, count) into one contiguous range per thread (no range smaller than
+// min_range_size) and returns once every range is done; the calling thread takes the first
+void parallel_for(size_t count, parallel_range_function function, void *context, size_t min_range_size = 4096);
+
+#endif
@@ -0,0 +1,15 @@
+
+# Platform flags shared by every Makefile; include after CXXFLAGS and LDFLAGS.
+# "make HEADLESS=1" adds the EGL offscreen context used by --headless.
+
+ifeq ($(shell uname), Darwin)
+LDFLAGS += -framework Cocoa -framework OpenGL
+else
+LDFLAGS += -lGL -lpthread
+endif
+
+ifdef HEADLESS
+CXXFLAGS += -DUSE_EGL
+LDFLAGS += -lEGL
+endif
+
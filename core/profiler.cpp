@@ -0,0 +1,202 @@
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <ctime>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+#include "profiler.hpp"
+
+using namespace std;
+
+struct profile_total_t {
+	size_t count;
+	double cpu;
+	size_t gpu_count;
+	double gpu;
+};
+
+static double now_microseconds() {
+#ifdef __APPLE__
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return (double)mach_absolute_time() * timebase.numer / timebase.denom * 1.0e-3;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1.0e6 + ts.tv_nsec * 1.0e-3;
+#endif
+}
+
+profiler_t::profiler_t() {
+	__enabled = false;
+	__gpu_supported = false;
+	__gpu_active = false;
+	__origin = now_microseconds();
+	__frame_index = 0;
+}
+
+void profiler_t::begin_frame() {
+	if (!__enabled)
+		return;
+
+	if (__frame_index == 0)
+		__gpu_supported = has_gl_extension("GL_EXT_timer_query") || has_gl_extension("GL_ARB_timer_query");
+
+	vector<profile_event_t> &frame = __frames[__frame_index % FRAME_LATENCY];
+	resolve(frame);
+	begin("frame", false);
+}
+
+void profiler_t::end_frame() {
+	if (!__enabled)
+		return;
+
+	end();
+	__frame_index++;
+}
+
+void profiler_t::begin(const char *name, bool gpu) {
+	if (!__enabled)
+		return;
+
+	vector<profile_event_t> &frame = __frames[__frame_index % FRAME_LATENCY];
+	profile_event_t event;
+	event.name = name;
+	event.depth = __open_events.size();
+	event.cpu_begin = now_microseconds() - __origin;
+	event.cpu_end = event.cpu_begin;
+	event.query = 0;
+	event.gpu_duration = -1.0;
+	// the first frame carries driver warm-up (llvmpipe even reports a bogus first elapsed time), so it is timed on the CPU only
+	if (gpu && __gpu_supported && !__gpu_active && __frame_index > 0) {
+		event.query = acquire_query();
+		glBeginQuery(GL_TIME_ELAPSED_EXT, event.query);
+		__gpu_active = true;
+	}
+
+	__open_events.push_back(frame.size());
+	frame.push_back(event);
+}
+
+void profiler_t::end() {
+	if (!__enabled || __open_events.empty())
+		return;
+
+	profile_event_t &event = __frames[__frame_index % FRAME_LATENCY][__open_events.back()];
+	__open_events.pop_back();
+	if (event.query) {
+		glEndQuery(GL_TIME_ELAPSED_EXT);
+		__gpu_active = false;
+	}
+	event.cpu_end = now_microseconds() - __origin;
+}
+
+GLuint profiler_t::acquire_query() {
+	GLuint query;
+	if (__free_queries.empty()) {
+		glGenQueries(1, &query);
+	} else {
+		query = __free_queries.back();
+		__free_queries.pop_back();
+	}
+	return query;
+}
+
+void profiler_t::resolve(vector<profile_event_t> &frame) {
+	for (size_t i = 0; i < frame.size(); i++) {
+		profile_event_t &event = frame[i];
+		if (event.query) {
+			GLuint64EXT elapsed = 0;
+			glGetQueryObjectui64vEXT(event.query, GL_QUERY_RESULT, &elapsed);
+			event.gpu_duration = elapsed * 1.0e-3;
+			__free_queries.push_back(event.query);
+			event.query = 0;
+		}
+		__events.push_back(event);
+	}
+	frame.clear();
+}
+
+void profiler_t::flush() {
+	if (!__open_events.empty())
+		return;
+
+	for (size_t i = 0; i < FRAME_LATENCY; i++)
+		resolve(__frames[(__frame_index + i) % FRAME_LATENCY]);
+}
+
+bool profiler_t::write_trace(const char *filepath) {
+	flush();
+
+	ofstream output(filepath);
+	if (!output) {
+		cerr << "Failed to open trace file: " << filepath << endl;
+		return false;
+	}
+
+	output << "{\"traceEvents\":[" << endl;
+	output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}}," << endl;
+	output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	// without timestamp queries only durations are known on the GPU, so its events
+	// are laid out back to back, starting no earlier than the CPU issued them
+	double gpu_time = 0.0;
+	output.setf(ios::fixed);
+	output.precision(3);
+	for (size_t i = 0; i < __events.size(); i++) {
+		const profile_event_t &event = __events[i];
+		output << "," << endl << "{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+		       << event.cpu_begin << ",\"dur\":" << event.cpu_end - event.cpu_begin << "}";
+		if (event.gpu_duration >= 0.0) {
+			gpu_time = max(gpu_time, event.cpu_begin);
+			output << "," << endl << "{\"name\":\"" << event.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":"
+			       << gpu_time << ",\"dur\":" << event.gpu_duration << "}";
+			gpu_time += event.gpu_duration;
+		}
+	}
+	output << endl << "]}" << endl;
+
+	return output.good();
+}
+
+void profiler_t::report(ostream &output) {
+	flush();
+
+	map<string, profile_total_t> totals;
+	vector<string> order;
+	for (size_t i = 0; i < __events.size(); i++) {
+		const profile_event_t &event = __events[i];
+		map<string, profile_total_t>::iterator it = totals.find(event.name);
+		if (it == totals.end()) {
+			profile_total_t zero = { 0, 0.0, 0, 0.0 };
+			it = totals.insert(make_pair(string(event.name), zero)).first;
+			order.push_back(event.name);
+		}
+		it->second.count++;
+		it->second.cpu += event.cpu_end - event.cpu_begin;
+		if (event.gpu_duration >= 0.0) {
+			it->second.gpu_count++;
+			it->second.gpu += event.gpu_duration;
+		}
+	}
+
+	output.setf(ios::fixed);
+	output.precision(3);
+	for (size_t i = 0; i < order.size(); i++) {
+		const profile_total_t &total = totals[order[i]];
+		output << order[i] << ": cpu " << total.cpu / total.count * 1.0e-3 << " ms";
+		if (total.gpu_count > 0)
+			output << ", gpu " << total.gpu / total.gpu_count * 1.0e-3 << " ms";
+		output << " (" << total.count << " samples)" << endl;
+	}
+}
+
+void profiler_t::delete_queries() {
+	flush();
+	if (!__free_queries.empty())
+		glDeleteQueries(__free_queries.size(), &__free_queries[0]);
+	__free_queries.clear();
+}
@@ -0,0 +1,83 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <vector>
+#include <iostream>
+#include "gl.hpp"
+
+struct profile_event_t {
+	const char *name;
+	int depth;
+	double cpu_begin;      // microseconds since the profiler was created
+	double cpu_end;
+	GLuint query;          // GL_TIME_ELAPSED query, 0 when the scope is CPU only
+	double gpu_duration;   // microseconds, negative when not measured
+};
+
+// Scoped CPU/GPU profiler. GPU timings are read back two frames late, so the
+// queries of a frame are already finished when they are collected.
+class profiler_t {
+
+public:
+
+	profiler_t();
+
+	bool is_enabled() const { return __enabled; }
+	void set_enabled(bool enabled) { __enabled = enabled; }
+
+	void begin_frame();
+	void end_frame();
+
+	// GL_TIME_ELAPSED queries cannot nest; a GPU scope inside another one is timed on the CPU only
+	void begin(const char *name, bool gpu);
+	void end();
+
+	void flush();
+	bool write_trace(const char *filepath);
+	void report(std::ostream &output);
+	// call while the GL context is still current
+	void delete_queries();
+
+private:
+
+	enum { FRAME_LATENCY = 2 };
+
+	void resolve(std::vector<profile_event_t> &frame);
+	GLuint acquire_query();
+
+	bool __enabled;
+	bool __gpu_supported;
+	bool __gpu_active;
+	double __origin;
+	size_t __frame_index;
+	std::vector<profile_event_t> __frames[FRAME_LATENCY];
+	std::vector<size_t> __open_events;
+	std::vector<GLuint> __free_queries;
+	std::vector<profile_event_t> __events;
+
+};
+
+class profile_scope_t {
+
+public:
+
+	profile_scope_t(profiler_t &profiler, const char *name, bool gpu = false) : __profiler(profiler) {
+		__profiler.begin(name, gpu);
+	}
+
+	~profile_scope_t() {
+		__profiler.end();
+	}
+
+private:
+
+	profiler_t &__profiler;
+
+};
+
+#define PROFILE_CONCAT_(a, b)  a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(profiler, name)  profile_scope_t PROFILE_CONCAT(profile_scope_, __LINE__)(profiler, name)
+#define PROFILE_GPU_SCOPE(profiler, name)  profile_scope_t PROFILE_CONCAT(profile_scope_, __LINE__)(profiler, name, true)
+
+#endif
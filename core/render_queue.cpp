@@ -0,0 +1,148 @@
+#include <cstring>
+#include <algorithm>
+#include "shader.hpp"
+#include "render_state.hpp"
+#include "render_queue.hpp"
+
+using namespace std;
+
+static const unsigned int PASS_SHIFT = 60;
+static const unsigned int TRANSLUCENT_SHIFT = 59;
+static const uint64_t PROGRAM_MASK = (1 << 11) - 1;
+static const uint64_t MATERIAL_MASK = (1 << 16) - 1;
+
+static uint32_t depth_bits(float depth) {
+	// a non-negative float orders like its bit pattern; behind the camera counts as 0
+	if (!(depth > 0.0f))
+		return 0;
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits;
+}
+
+static bool same_textures(const draw_packet_t &a, const draw_packet_t &b) {
+	if (a.texture_count != b.texture_count)
+		return false;
+	for (size_t i = 0; i < a.texture_count; i++) {
+		if (a.textures[i].unit != b.textures[i].unit || a.textures[i].target != b.textures[i].target
+		    || a.textures[i].handle != b.textures[i].handle)
+			return false;
+	}
+	return true;
+}
+
+void draw_packet_t::add_texture(GLenum unit, GLenum target, GLuint handle) {
+	if (texture_count >= MAX_TEXTURES) {
+		cerr << "*** Draw packet has more than " << MAX_TEXTURES << " textures" << endl;
+		return;
+	}
+	draw_texture_t &texture = textures[texture_count++];
+	texture.unit = unit;
+	texture.target = target;
+	texture.handle = handle;
+}
+
+ostream& operator<<(ostream &output, const render_queue_stats_t &stats) {
+	output << "render queue: " << stats.packet_count << " packets, " << stats.draw_count << " draws, "
+	       << stats.program_changes << " program changes, " << stats.texture_changes << " texture changes";
+	return output;
+}
+
+uint64_t render_queue_t::make_key(unsigned int pass, GLuint program, unsigned int material, float depth, bool translucent) {
+	uint64_t key = (uint64_t)(pass & (MAX_PASSES - 1)) << PASS_SHIFT;
+	if (translucent) {
+		key |= (uint64_t)1 << TRANSLUCENT_SHIFT;
+		key |= (uint64_t)(~depth_bits(depth)) << 27;
+		key |= (program & PROGRAM_MASK) << 16;
+		key |= material & MATERIAL_MASK;
+	} else {
+		key |= (program & PROGRAM_MASK) << 48;
+		key |= (material & MATERIAL_MASK) << 32;
+		key |= depth_bits(depth);
+	}
+	return key;
+}
+
+void render_queue_t::clear() {
+	__packets.clear();
+	__items.clear();
+	__sorted = true;
+	__stats = render_queue_stats_t();
+}
+
+draw_packet_t& render_queue_t::push(unsigned int pass, const shader_program_t &program, unsigned int material, float depth, bool translucent,
+                                    const void *object, draw_function_t draw, const glm::mat4 &transform) {
+	sort_item_t item;
+	item.key = make_key(pass, program.handle(), material, depth, translucent);
+	item.index = __packets.size();
+	__items.push_back(item);
+	__sorted = false;
+
+	__packets.push_back(draw_packet_t());
+	draw_packet_t &packet = __packets.back();
+	packet.key = item.key;
+	packet.program = &program;
+	packet.object = object;
+	packet.draw = draw;
+	packet.transform = transform;
+	packet.texture_count = 0;
+	__stats.packet_count++;
+	return packet;
+}
+
+// least significant digit first, a byte at a time; a byte every key shares (the pass bits
+// of a single pass, the program bits above the handles in use) is skipped
+void render_queue_t::sort() {
+	size_t count = __items.size();
+	__scratch.resize(count);
+	size_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++) {
+		uint64_t key = __items[i].key;
+		for (size_t digit = 0; digit < 8; digit++)
+			histograms[digit][(key >> (8 * digit)) & 0xff]++;
+	}
+
+	sort_item_t *source = count > 0 ? &__items[0] : NULL, *target = count > 0 ? &__scratch[0] : NULL;
+	for (size_t digit = 0; digit < 8; digit++) {
+		size_t *histogram = histograms[digit];
+		if (count == 0 || histogram[(source[0].key >> (8 * digit)) & 0xff] == count)
+			continue;
+		size_t offset = 0;
+		for (size_t bucket = 0; bucket < 256; bucket++) {
+			size_t n = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += n;
+		}
+		for (size_t i = 0; i < count; i++)
+			target[histogram[(source[i].key >> (8 * digit)) & 0xff]++] = source[i];
+		swap(source, target);
+	}
+	if (count > 0 && source != &__items[0])
+		__items.swap(__scratch);
+	__sorted = true;
+}
+
+void render_queue_t::submit(unsigned int pass) {
+	if (!__sorted)
+		sort();
+
+	uint64_t first_key = (uint64_t)(pass & (MAX_PASSES - 1)) << PASS_SHIFT;
+	vector<sort_item_t>::const_iterator it = lower_bound(__items.begin(), __items.end(), first_key, pass_less_t());
+	const draw_packet_t *previous = NULL;
+	for (; it != __items.end() && (it->key >> PASS_SHIFT) == (first_key >> PASS_SHIFT); it++) {
+		const draw_packet_t &packet = __packets[it->index];
+		if (previous == NULL || packet.program != previous->program) {
+			packet.program->bind();
+			__stats.program_changes++;
+		}
+		if (previous == NULL || !same_textures(packet, *previous)) {
+			for (size_t i = 0; i < packet.texture_count; i++)
+				RENDER_STATE.bind_texture(packet.textures[i].unit, packet.textures[i].target, packet.textures[i].handle);
+			__stats.texture_changes++;
+		}
+		packet.draw(packet);
+		__stats.draw_count++;
+		previous = &packet;
+	}
+}
@@ -0,0 +1,104 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <vector>
+#include <iostream>
+#include <cstddef>
+#include <stdint.h>
+#include "gl.hpp"
+#include <glm/glm.hpp>
+
+class shader_program_t;
+struct draw_packet_t;
+
+// sets the object's own uniforms on packet.program and draws it; the program and the
+// packet's textures are bound already
+typedef void (*draw_function_t)(const draw_packet_t &packet);
+
+struct draw_texture_t {
+	GLenum unit;    // GL_TEXTURE0 + i
+	GLenum target;
+	GLuint handle;
+};
+
+struct draw_packet_t {
+	enum { MAX_TEXTURES = 4 };
+
+	uint64_t key;
+	const shader_program_t *program;
+	const void *object;
+	draw_function_t draw;
+	glm::mat4 transform;
+	draw_texture_t textures[MAX_TEXTURES];
+	size_t texture_count;
+
+	void add_texture(GLenum unit, GLenum target, GLuint handle);
+};
+
+struct render_queue_stats_t {
+	size_t packet_count;
+	size_t draw_count;        // in the submit() calls since clear()
+	size_t program_changes;
+	size_t texture_changes;   // draws whose textures differ from the previous draw's
+
+	render_queue_stats_t() : packet_count(0), draw_count(0), program_changes(0), texture_changes(0) { }
+};
+
+std::ostream& operator<<(std::ostream &output, const render_queue_stats_t &stats);
+
+// Collects a frame's draws and submits them sorted by a 64 bit key, so the program and
+// textures change once per run of packets that share them rather than once per object.
+// The key holds, from the top bit down, the pass (4 bits), whether the packet is
+// translucent, and then for opaque packets the program (11 bits), the material (16 bits)
+// and the view depth (32 bits) front to back; translucent packets sort by depth first,
+// back to front, then by program and material.
+class render_queue_t {
+
+public:
+
+	enum { MAX_PASSES = 16 };
+
+	render_queue_t() : __sorted(true) { }
+
+	// forgets the packets of the last frame, keeping their storage
+	void clear();
+	// the returned packet takes textures through add_texture() until the next push();
+	// depth is the object's distance in front of the camera
+	draw_packet_t& push(unsigned int pass, const shader_program_t &program, unsigned int material, float depth, bool translucent,
+	                    const void *object, draw_function_t draw, const glm::mat4 &transform);
+	// draws the packets of pass in key order; set up the frame buffer and the programs'
+	// per pass uniforms first
+	void submit(unsigned int pass);
+
+	size_t size() const { return __packets.size(); }
+	const render_queue_stats_t& stats() const { return __stats; }
+
+	static uint64_t make_key(unsigned int pass, GLuint program, unsigned int material, float depth, bool translucent);
+
+private:
+
+	struct sort_item_t {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	struct pass_less_t {
+		bool operator()(const sort_item_t &item, uint64_t key) const { return item.key < key; }
+	};
+
+	void sort();
+
+	std::vector<draw_packet_t> __packets;
+	std::vector<sort_item_t> __items;
+	std::vector<sort_item_t> __scratch;
+	bool __sorted;
+	render_queue_stats_t __stats;
+
+};
+
+// of an object placed by transform, for render_queue_t::push
+inline float view_depth(const glm::mat4 &view_matrix, const glm::mat4 &transform) {
+	return -(view_matrix * transform[3]).z;
+}
+
+#endif
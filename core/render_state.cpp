@@ -0,0 +1,180 @@
+#include <iomanip>
+#include "render_state.hpp"
+
+using namespace std;
+
+static const char *KIND_NAMES[RENDER_STATE_KIND_COUNT] = {
+	"program", "vertex array", "buffer", "active texture", "texture", "vertex attrib array", "capability", "raster", "frame buffer"
+};
+
+void render_state_counters_t::reset() {
+	for (size_t i = 0; i < RENDER_STATE_KIND_COUNT; i++)
+		issued[i] = skipped[i] = 0;
+}
+
+size_t render_state_counters_t::total_issued() const {
+	size_t total = 0;
+	for (size_t i = 0; i < RENDER_STATE_KIND_COUNT; i++)
+		total += issued[i];
+	return total;
+}
+
+size_t render_state_counters_t::total_skipped() const {
+	size_t total = 0;
+	for (size_t i = 0; i < RENDER_STATE_KIND_COUNT; i++)
+		total += skipped[i];
+	return total;
+}
+
+ostream& operator<<(ostream &output, const render_state_counters_t &counters) {
+	output << "render state: " << counters.total_issued() << " calls issued, " << counters.total_skipped() << " skipped";
+	for (size_t i = 0; i < RENDER_STATE_KIND_COUNT; i++) {
+		if (counters.issued[i] + counters.skipped[i] > 0)
+			output << endl << "  " << setw(20) << left << KIND_NAMES[i] << counters.issued[i] << " issued, " << counters.skipped[i] << " skipped";
+	}
+	return output;
+}
+
+render_state_t::render_state_t() {
+	invalidate();
+}
+
+render_state_t& render_state_t::current() {
+	static render_state_t state;
+	return state;
+}
+
+void render_state_t::invalidate() {
+	__program = __vertex_array = __array_buffer = __element_array_buffer = __active_texture = UNKNOWN;
+	__attrib_arrays_known = __attrib_arrays_enabled = 0;
+	__cull_face = __depth_func = __depth_mask = __frame_buffer = UNKNOWN;
+	__units.clear();
+	__capabilities.clear();
+}
+
+bool render_state_t::change(render_state_kind_t kind, GLuint &cached, GLuint value) {
+	if (cached == value) {
+		__counters.skipped[kind]++;
+		return false;
+	}
+	cached = value;
+	__counters.issued[kind]++;
+	return true;
+}
+
+render_state_t::texture_unit_state_t& render_state_t::unit_state(GLenum unit) {
+	size_t index = unit - GL_TEXTURE0;
+	if (index >= __units.size()) {
+		texture_unit_state_t unknown = { UNKNOWN, UNKNOWN };
+		__units.resize(index + 1, unknown);
+	}
+	return __units[index];
+}
+
+void render_state_t::use_program(GLuint program) {
+	if (change(RENDER_STATE_PROGRAM, __program, program))
+		glUseProgram(program);
+}
+
+void render_state_t::bind_vertex_array(GLuint vertex_array) {
+	if (change(RENDER_STATE_VERTEX_ARRAY, __vertex_array, vertex_array))
+		glBindVertexArray(vertex_array);
+}
+
+void render_state_t::bind_buffer(GLenum target, GLuint buffer) {
+	GLuint *cached = NULL;
+	if (target == GL_ARRAY_BUFFER)
+		cached = &__array_buffer;
+	else if (target == GL_ELEMENT_ARRAY_BUFFER && __vertex_array == 0)
+		cached = &__element_array_buffer;
+
+	if (cached == NULL)
+		__counters.issued[RENDER_STATE_BUFFER]++;
+	else if (!change(RENDER_STATE_BUFFER, *cached, buffer))
+		return;
+	glBindBuffer(target, buffer);
+}
+
+void render_state_t::active_texture(GLenum unit) {
+	if (change(RENDER_STATE_ACTIVE_TEXTURE, __active_texture, unit))
+		glActiveTexture(unit);
+}
+
+void render_state_t::bind_texture(GLenum unit, GLenum target, GLuint texture) {
+	texture_unit_state_t &state = unit_state(unit);
+	GLuint *cached = NULL;
+	if (target == GL_TEXTURE_2D)
+		cached = &state.texture_2d;
+	else if (target == GL_TEXTURE_CUBE_MAP)
+		cached = &state.cube_map;
+
+	if (cached != NULL && *cached == texture) {
+		__counters.skipped[RENDER_STATE_TEXTURE]++;
+		return;
+	}
+	active_texture(unit);
+	if (cached != NULL)
+		*cached = texture;
+	__counters.issued[RENDER_STATE_TEXTURE]++;
+	glBindTexture(target, texture);
+}
+
+void render_state_t::set_vertex_attrib_array(GLuint index, bool enabled) {
+	GLuint bit = attrib_array_bit(index);
+	if (__vertex_array == 0 && bit != 0) {
+		if ((__attrib_arrays_known & bit) && ((__attrib_arrays_enabled & bit) != 0) == enabled) {
+			__counters.skipped[RENDER_STATE_VERTEX_ATTRIB_ARRAY]++;
+			return;
+		}
+		__attrib_arrays_known |= bit;
+		if (enabled)
+			__attrib_arrays_enabled |= bit;
+		else
+			__attrib_arrays_enabled &= ~bit;
+	}
+	__counters.issued[RENDER_STATE_VERTEX_ATTRIB_ARRAY]++;
+	if (enabled)
+		glEnableVertexAttribArray(index);
+	else
+		glDisableVertexAttribArray(index);
+}
+
+void render_state_t::set_vertex_attrib_arrays(GLuint mask) {
+	for (GLuint i = 0; i < MAX_CACHED_ATTRIB_ARRAYS; i++) {
+		GLuint bit = 1u << i;
+		if (mask & bit)
+			set_vertex_attrib_array(i, true);
+		else if (__vertex_array == 0 && (__attrib_arrays_known & __attrib_arrays_enabled & bit))
+			set_vertex_attrib_array(i, false);
+	}
+}
+
+void render_state_t::set_capability(GLenum capability, bool enabled) {
+	GLuint &cached = __capabilities.insert(make_pair(capability, UNKNOWN)).first->second;
+	if (!change(RENDER_STATE_CAPABILITY, cached, enabled ? 1 : 0))
+		return;
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void render_state_t::cull_face(GLenum mode) {
+	if (change(RENDER_STATE_RASTER, __cull_face, mode))
+		glCullFace(mode);
+}
+
+void render_state_t::depth_func(GLenum function) {
+	if (change(RENDER_STATE_RASTER, __depth_func, function))
+		glDepthFunc(function);
+}
+
+void render_state_t::depth_mask(bool enabled) {
+	if (change(RENDER_STATE_RASTER, __depth_mask, enabled ? 1 : 0))
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void render_state_t::bind_frame_buffer(GLuint frame_buffer) {
+	if (change(RENDER_STATE_FRAME_BUFFER, __frame_buffer, frame_buffer))
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, frame_buffer);
+}
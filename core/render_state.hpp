@@ -0,0 +1,107 @@
+#ifndef RENDER_STATE_HPP
+#define RENDER_STATE_HPP
+
+#include <map>
+#include <vector>
+#include <iostream>
+#include <cstddef>
+#include "gl.hpp"
+
+enum render_state_kind_t {
+	RENDER_STATE_PROGRAM,
+	RENDER_STATE_VERTEX_ARRAY,
+	RENDER_STATE_BUFFER,
+	RENDER_STATE_ACTIVE_TEXTURE,
+	RENDER_STATE_TEXTURE,
+	RENDER_STATE_VERTEX_ATTRIB_ARRAY,
+	RENDER_STATE_CAPABILITY,       // glEnable / glDisable
+	RENDER_STATE_RASTER,           // glCullFace, glDepthFunc, glDepthMask
+	RENDER_STATE_FRAME_BUFFER,
+	RENDER_STATE_KIND_COUNT
+};
+
+struct render_state_counters_t {
+	size_t issued[RENDER_STATE_KIND_COUNT];
+	size_t skipped[RENDER_STATE_KIND_COUNT];
+
+	render_state_counters_t() { reset(); }
+
+	void reset();
+	size_t total_issued() const;
+	size_t total_skipped() const;
+};
+
+std::ostream& operator<<(std::ostream &output, const render_state_counters_t &counters);
+
+// Shadows the GL state draws change most, so setting what is already set costs no GL call.
+// Everything starts unknown and the first call of each kind goes through. Code that changes
+// this state with plain GL calls, or deletes a bound object, must invalidate() afterwards.
+// The element array buffer and the enabled vertex attribute arrays belong to the vertex
+// array object, so they are only cached while vertex array 0 is bound.
+class render_state_t {
+
+public:
+
+	render_state_t();
+
+	void use_program(GLuint program);
+	void bind_vertex_array(GLuint vertex_array);
+	// GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER are cached; other targets pass through
+	void bind_buffer(GLenum target, GLuint buffer);
+	void active_texture(GLenum unit);
+	// unit is GL_TEXTURE0 + i; GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP are cached
+	void bind_texture(GLenum unit, GLenum target, GLuint texture);
+	void set_vertex_attrib_array(GLuint index, bool enabled);
+	// enables the arrays in mask (see attrib_array_bit) and disables the others it knows are enabled
+	void set_vertex_attrib_arrays(GLuint mask);
+	void set_capability(GLenum capability, bool enabled);
+	void cull_face(GLenum mode);
+	void depth_func(GLenum function);
+	void depth_mask(bool enabled);
+	void bind_frame_buffer(GLuint frame_buffer);
+
+	// forgets everything, for after state changed behind the cache's back
+	void invalidate();
+
+	const render_state_counters_t& counters() const { return __counters; }
+	void reset_counters() { __counters.reset(); }
+
+	// of the one GL context the demos have
+	static render_state_t& current();
+	// 0 for the location of an attribute the program does not use
+	static GLuint attrib_array_bit(GLuint location) { return location < MAX_CACHED_ATTRIB_ARRAYS ? 1u << location : 0; }
+
+private:
+
+	static const GLuint UNKNOWN = ~0u;
+	enum { MAX_CACHED_ATTRIB_ARRAYS = 32 };
+
+	struct texture_unit_state_t {
+		GLuint texture_2d;
+		GLuint cube_map;
+	};
+
+	// true when the call is needed; counts it either way
+	bool change(render_state_kind_t kind, GLuint &cached, GLuint value);
+	texture_unit_state_t& unit_state(GLenum unit);
+
+	GLuint __program;
+	GLuint __vertex_array;
+	GLuint __array_buffer;
+	GLuint __element_array_buffer;  // of vertex array 0
+	GLuint __active_texture;
+	GLuint __attrib_arrays_known;   // bit per index; of vertex array 0
+	GLuint __attrib_arrays_enabled;
+	GLuint __cull_face;
+	GLuint __depth_func;
+	GLuint __depth_mask;
+	GLuint __frame_buffer;
+	std::vector<texture_unit_state_t> __units;
+	std::map<GLenum, GLuint> __capabilities;
+	render_state_counters_t __counters;
+
+};
+
+#define RENDER_STATE  render_state_t::current()
+
+#endif
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include "scene_graph.hpp"
+#include "transform_batch.hpp"
+
+using namespace std;
+
+const scene_graph_t::node_t scene_graph_t::NO_PARENT;
+
+ostream& operator<<(ostream &output, const scene_graph_stats_t &stats) {
+	output << "scene graph: " << stats.node_count << " nodes, " << stats.updated_count << " updated last, "
+	       << stats.update_count << " updates";
+	return output;
+}
+
+namespace {
+
+struct depth_less_t {
+	const vector<unsigned int> *depths;
+	bool operator()(size_t a, size_t b) const { return (*depths)[a] < (*depths)[b]; }
+};
+
+template <typename T>
+void permute(vector<T> &values, const vector<size_t> &order) {
+	vector<T> sorted(values.size());
+	for (size_t i = 0; i < order.size(); i++)
+		sorted[i] = values[order[i]];
+	values.swap(sorted);
+}
+
+}
+
+scene_graph_t::node_t scene_graph_t::add(node_t parent, const glm::vec3 &position, const glm::vec3 &scale, const glm::quat &orientation) {
+	node_t node = __indices.size();
+	size_t parent_index = parent == NO_PARENT ? NO_PARENT : __indices[parent];
+	unsigned int depth = parent == NO_PARENT ? 0 : __depths[parent_index] + 1;
+	if (!__depths.empty() && depth < __depths.back())
+		__sorted = false;
+
+	__indices.push_back(__handles.size());
+	__handles.push_back(node);
+	__parents.push_back(parent_index);
+	__depths.push_back(depth);
+	__positions.push_back(position);
+	__scales.push_back(scale);
+	__orientations.push_back(orientation);
+	__dirty_flags.push_back(1);
+	__world_matrices.push_back(glm::mat4(1.0f));
+	__world_normal_matrices.push_back(glm::mat3(1.0f));
+	__dirty = true;
+	__stats.node_count = __handles.size();
+	return node;
+}
+
+void scene_graph_t::mark_dirty(size_t index) {
+	__dirty_flags[index] = 1;
+	__dirty = true;
+}
+
+void scene_graph_t::set_position(node_t node, const glm::vec3 &position) {
+	size_t index = __indices[node];
+	__positions[index] = position;
+	mark_dirty(index);
+}
+
+void scene_graph_t::set_scale(node_t node, const glm::vec3 &scale) {
+	size_t index = __indices[node];
+	__scales[index] = scale;
+	mark_dirty(index);
+}
+
+void scene_graph_t::set_orientation(node_t node, const glm::quat &orientation) {
+	size_t index = __indices[node];
+	__orientations[index] = orientation;
+	mark_dirty(index);
+}
+
+scene_graph_t::node_t scene_graph_t::parent(node_t node) const {
+	size_t parent_index = __parents[__indices[node]];
+	return parent_index == NO_PARENT ? NO_PARENT : __handles[parent_index];
+}
+
+// stable, so nodes of one depth keep the order they were added in
+void scene_graph_t::sort() {
+	vector<size_t> order(__handles.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	depth_less_t less;
+	less.depths = &__depths;
+	stable_sort(order.begin(), order.end(), less);
+
+	vector<size_t> new_indices(order.size());
+	for (size_t i = 0; i < order.size(); i++)
+		new_indices[order[i]] = i;
+	for (size_t i = 0; i < __parents.size(); i++) {
+		if (__parents[i] != NO_PARENT)
+			__parents[i] = new_indices[__parents[i]];
+	}
+
+	permute(__handles, order);
+	permute(__parents, order);
+	permute(__depths, order);
+	permute(__positions, order);
+	permute(__scales, order);
+	permute(__orientations, order);
+	permute(__dirty_flags, order);
+	permute(__world_matrices, order);
+	permute(__world_normal_matrices, order);
+	for (size_t i = 0; i < __handles.size(); i++)
+		__indices[__handles[i]] = i;
+	__sorted = true;
+}
+
+size_t scene_graph_t::update() {
+	if (!__dirty) {
+		__stats.updated_count = 0;
+		return 0;
+	}
+	if (!__sorted)
+		sort();
+
+	size_t updated_count = 0;
+	for (size_t i = 0; i < __handles.size(); i++) {
+		size_t parent_index = __parents[i];
+		// the parents' flags are still set, as they are only cleared below
+		if (parent_index != NO_PARENT && __dirty_flags[parent_index])
+			__dirty_flags[i] = 1;
+		if (!__dirty_flags[i])
+			continue;
+
+		glm::mat4 local;
+		glm::mat3 local_normal;
+		compose_transform(__positions[i], __scales[i], __orientations[i], local, local_normal);
+		__world_matrices[i] = parent_index == NO_PARENT ? local : __world_matrices[parent_index] * local;
+		__world_normal_matrices[i] = parent_index == NO_PARENT ? local_normal : __world_normal_matrices[parent_index] * local_normal;
+		updated_count++;
+	}
+	fill(__dirty_flags.begin(), __dirty_flags.end(), 0);
+	__dirty = false;
+
+	__stats.updated_count = updated_count;
+	__stats.update_count++;
+	return updated_count;
+}
@@ -0,0 +1,88 @@
+#ifndef SCENE_GRAPH_HPP
+#define SCENE_GRAPH_HPP
+
+#include <vector>
+#include <iostream>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+struct scene_graph_stats_t {
+	size_t node_count;
+	size_t updated_count;   // world matrices recomputed by the last update()
+	size_t update_count;    // update() calls that found something dirty
+
+	scene_graph_stats_t() : node_count(0), updated_count(0), update_count(0) { }
+};
+
+std::ostream& operator<<(std::ostream &output, const scene_graph_stats_t &stats);
+
+// A hierarchy of transforms, each node placed relative to its parent by a position, scale
+// and orientation as model_t holds them: local = translate(position) * scale(scale) *
+// mat4_cast(orientation), world = parent's world * local.
+// The nodes live in arrays sorted by depth, each holding its parent's index, so update()
+// is one pass from the roots down in which every parent comes before its children. Only
+// the nodes whose transform changed since the last update(), and their descendants, are
+// recomputed, and a scene with nothing changed returns at once.
+// Nodes are named by the handle add() returns, which stays the same as the arrays are
+// sorted.
+class scene_graph_t {
+
+public:
+
+	typedef size_t node_t;
+	static const node_t NO_PARENT = (node_t)-1;
+
+	scene_graph_t() : __sorted(true), __dirty(false) { }
+
+	// the parent must have been added before
+	node_t add(node_t parent, const glm::vec3 &position = glm::vec3(0.0f), const glm::vec3 &scale = glm::vec3(1.0f),
+	           const glm::quat &orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+
+	void set_position(node_t node, const glm::vec3 &position);
+	void set_scale(node_t node, const glm::vec3 &scale);
+	void set_orientation(node_t node, const glm::quat &orientation);
+
+	const glm::vec3& position(node_t node) const { return __positions[__indices[node]]; }
+	const glm::vec3& scale(node_t node) const { return __scales[__indices[node]]; }
+	const glm::quat& orientation(node_t node) const { return __orientations[__indices[node]]; }
+	node_t parent(node_t node) const;
+
+	// as of the last update()
+	const glm::mat4& world_matrix(node_t node) const { return __world_matrices[__indices[node]]; }
+	// the inverse transpose of world_matrix's upper 3x3, composed from the nodes' scales and
+	// orientations rather than inverted
+	const glm::mat3& world_normal_matrix(node_t node) const { return __world_normal_matrices[__indices[node]]; }
+
+	// recomputes the world matrices of the changed nodes and their descendants, returning
+	// how many were recomputed
+	size_t update();
+
+	size_t size() const { return __handles.size(); }
+	const scene_graph_stats_t& stats() const { return __stats; }
+
+private:
+
+	void sort();
+	void mark_dirty(size_t index);
+
+	// by handle
+	std::vector<size_t> __indices;
+	// by index, in depth order
+	std::vector<node_t> __handles;
+	std::vector<size_t> __parents;   // indices, NO_PARENT for roots
+	std::vector<unsigned int> __depths;
+	std::vector<glm::vec3> __positions;
+	std::vector<glm::vec3> __scales;
+	std::vector<glm::quat> __orientations;
+	std::vector<unsigned char> __dirty_flags;
+	std::vector<glm::mat4> __world_matrices;
+	std::vector<glm::mat3> __world_normal_matrices;
+
+	bool __sorted;
+	bool __dirty;
+	scene_graph_stats_t __stats;
+
+};
+
+#endif
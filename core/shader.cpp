@@ -1,9 +1,11 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <iterator>
 #include <algorithm>
 
 #include "shader.hpp"
+#include "render_state.hpp"
 
 using namespace std;
 
@@ -76,6 +78,70 @@ bool shader_t::compile(const char *source_code) {
   }
 }
 
+unsigned int shader_variable_table_t::hash(const char *name) {
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	for (const char *c = name; *c != '\0'; c++) {
+		h ^= (unsigned char)(*c);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+void shader_variable_table_t::clear() {
+	__slots.clear();
+	__count = 0;
+}
+
+void shader_variable_table_t::grow() {
+	std::vector<shader_variable_t> slots;
+	slots.swap(__slots);
+	__slots.resize(slots.empty() ? 16 : 2 * slots.size());
+	__count = 0;
+
+	for (size_t i = 0; i < slots.size(); i++) {
+		if (! slots[i].name.empty())
+			insert(slots[i].name, slots[i].location);
+	}
+}
+
+void shader_variable_table_t::insert(const std::string &name, GLint location) {
+	if (2 * (__count + 1) > __slots.size())
+		grow();
+
+	unsigned int h = hash(name.c_str());
+	size_t mask = __slots.size() - 1;
+	size_t i = h & mask;
+	while (! __slots[i].name.empty()) {
+		if (__slots[i].hash == h && __slots[i].name == name) {
+			__slots[i].location = location;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+
+	__slots[i].name = name;
+	__slots[i].hash = h;
+	__slots[i].location = location;
+	__count++;
+}
+
+GLint shader_variable_table_t::find(const char *name) const {
+	if (__slots.empty())
+		return -1;
+
+	unsigned int h = hash(name);
+	size_t mask = __slots.size() - 1;
+	size_t i = h & mask;
+	while (! __slots[i].name.empty()) {
+		const shader_variable_t &slot = __slots[i];
+		if (slot.hash == h && slot.name.compare(name) == 0)
+			return slot.location;
+		i = (i + 1) & mask;
+	}
+	return -1;
+}
+
 shader_program_t::shader_program_t() {
 	__handle = 0;
 }
@@ -106,9 +172,18 @@ bool shader_program_t::add_shader_from_source_code(GLenum shader_type_id, const
 	}
 }
 
-bool shader_program_t::add_shader_from_source_file(GLenum shader_type_id, const char *source_filepath) {
+bool shader_program_t::add_shader_from_source_file(GLenum shader_type_id, const char *source_filepath, const char *defines) {
 	string source_code;
 	read_source_code(source_filepath, source_code);
+	if (defines != NULL) {
+		// #version has to stay the first line
+		size_t position = 0;
+		if (source_code.compare(0, 8, "#version") == 0) {
+			position = source_code.find('\n');
+			position = (position == string::npos) ? source_code.size() : position + 1;
+		}
+		source_code.insert(position, string(defines) + "\n");
+	}
 	return add_shader_from_source_code(shader_type_id, source_code.c_str());
 }
 
@@ -132,6 +207,7 @@ bool shader_program_t::link() {
 			glDeleteProgram(__handle);
 			
 		__handle = program_handle;
+		introspect();
 		return true;
 	} else {
 		GLint log_length = 0;
@@ -147,20 +223,73 @@ bool shader_program_t::link() {
   }	
 }
 
+static bool is_array_name(const std::string &name) {
+	return name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+}
+
+void shader_program_t::introspect() {
+	__uniforms.clear();
+	__attributes.clear();
+
+	GLint count = 0;
+	GLint max_length = 0;
+	glGetProgramiv(__handle, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(__handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+	std::vector<GLchar> buf(max_length + 1);
+
+	for (GLint i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type;
+		glGetActiveUniform(__handle, i, buf.size(), &length, &size, &type, &buf[0]);
+		string name(&buf[0], length);
+		if (name.compare(0, 3, "gl_") == 0)
+			continue;
+
+		if (is_array_name(name)) {
+			// arrays are reported once as "name[0]"; register the bare name and every element
+			string base = name.substr(0, name.size() - 3);
+			__uniforms.insert(base, glGetUniformLocation(__handle, name.c_str()));
+			for (GLint j = 0; j < size; j++) {
+				stringstream element;
+				element << base << "[" << j << "]";
+				__uniforms.insert(element.str(), glGetUniformLocation(__handle, element.str().c_str()));
+			}
+		} else {
+			__uniforms.insert(name, glGetUniformLocation(__handle, name.c_str()));
+		}
+	}
+
+	glGetProgramiv(__handle, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(__handle, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+	buf.resize(max_length + 1);
+
+	for (GLint i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type;
+		glGetActiveAttrib(__handle, i, buf.size(), &length, &size, &type, &buf[0]);
+		string name(&buf[0], length);
+		if (name.compare(0, 3, "gl_") == 0)
+			continue;
+		__attributes.insert(name, glGetAttribLocation(__handle, name.c_str()));
+	}
+}
+
 void shader_program_t::bind() const {
-	glUseProgram(__handle);
+	RENDER_STATE.use_program(__handle);
 }
 
 void shader_program_t::release() const {
-	glUseProgram(0);
+	RENDER_STATE.use_program(0);
 }
 
 GLuint shader_program_t::attribute_location(const char *name) const {
-	return glGetAttribLocation(__handle, name);
+	return __attributes.find(name);
 }
 
 GLuint shader_program_t::uniform_location(const char *name) const {
-	return glGetUniformLocation(__handle, name);
+	return __uniforms.find(name);
 }
 
 void shader_program_t::set_uniform_value(const char *name, const glm::mat4 &mat) const {
@@ -199,13 +328,22 @@ void shader_program_t::set_uniform_value(GLuint location, int value) const {
 	glUniform1i(location, value);
 }
 
-bool shader_program_t::build(shader_program_t &shader_program, const char *vertex_shader_filepath, const char *fragment_shader_filepath) {
-  if (!shader_program.add_shader_from_source_file(GL_VERTEX_SHADER, vertex_shader_filepath)) {
+bool shader_program_t::bind_uniform_block(const char *name, GLuint binding) const {
+	GLuint index = glGetUniformBlockIndex(__handle, name);
+	if (index == GL_INVALID_INDEX)
+		return false;
+	glUniformBlockBinding(__handle, index, binding);
+	return true;
+}
+
+bool shader_program_t::build(shader_program_t &shader_program, const char *vertex_shader_filepath, const char *fragment_shader_filepath,
+                             const char *defines) {
+  if (!shader_program.add_shader_from_source_file(GL_VERTEX_SHADER, vertex_shader_filepath, defines)) {
 		cerr << "*** " << vertex_shader_filepath << endl;
     cerr << shader_program.log() << endl;
     return false;
   }
-  if (!shader_program.add_shader_from_source_file(GL_FRAGMENT_SHADER, fragment_shader_filepath)) {
+  if (!shader_program.add_shader_from_source_file(GL_FRAGMENT_SHADER, fragment_shader_filepath, defines)) {
 		cerr << "*** " << fragment_shader_filepath << endl;
     cerr << shader_program.log() << endl;
     return false;
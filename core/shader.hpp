@@ -3,7 +3,7 @@
 
 #include <vector>
 #include <string>
-#include <OpenGL/gl.h>
+#include "gl.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -34,14 +34,44 @@ public:
 
 typedef std::vector<const shader_t *> shader_collection;
 
+struct shader_variable_t {
+	std::string name;
+	unsigned int hash;
+	GLint location;
+};
+
+// open addressing table from active uniform / attribute names to their locations
+class shader_variable_table_t {
+
+private:
+	std::vector<shader_variable_t> __slots;
+	size_t __count;
+
+	void grow();
+
+public:
+	shader_variable_table_t() : __count(0) { }
+
+	void clear();
+	void insert(const std::string &name, GLint location);
+	GLint find(const char *name) const;
+	size_t size() const { return __count; }
+
+	static unsigned int hash(const char *name);
+
+};
+
 class shader_program_t {
 
 private:
 	GLuint __handle;
 	std::string __log;
 	shader_collection __shaders;
+	shader_variable_table_t __uniforms;
+	shader_variable_table_t __attributes;
 
 	bool is_allocated() const;
+	void introspect();
 
 public:
 	shader_program_t();
@@ -49,7 +79,8 @@ public:
 	
 	bool add_shader(const shader_t &shader);
 	bool add_shader_from_source_code(GLenum shader_type_id, const char *source_code);
-	bool add_shader_from_source_file(GLenum shader_type_id, const char *source_filepath);
+	// defines are lines of "#define"s put in after the #version line
+	bool add_shader_from_source_file(GLenum shader_type_id, const char *source_filepath, const char *defines = NULL);
 	
 	bool link();
 	bool is_linked() const;
@@ -68,11 +99,14 @@ public:
 	void set_uniform_value(const char *name, const glm::vec4 &v) const;
 	void set_uniform_value(const char *name, const glm::mat3 &mat) const;
 	void set_uniform_value(const char *name, const glm::mat4 &mat) const;
+	// points the named uniform block at a GL_UNIFORM_BUFFER binding; false when the program has no such block
+	bool bind_uniform_block(const char *name, GLuint binding) const;
 	
 	const std::string& log() const { return __log; }
 	GLuint handle() const { return __handle; }
 
-	static bool build(shader_program_t &shader_program, const char *vertex_shader_filepath, const char *fragment_shader_filepath);
+	static bool build(shader_program_t &shader_program, const char *vertex_shader_filepath, const char *fragment_shader_filepath,
+	                  const char *defines = NULL);
 
 };
 
@@ -0,0 +1,343 @@
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#include "parallel.hpp"
+#include "tangent.hpp"
+
+// below this many vertices a second range costs more to sort faces into than it saves
+static const size_t MIN_RANGE_SIZE = 65536;
+
+// The vertices are cut into one range per thread, and each range sums straight into its
+// own part of the output, so there is no scratch by vertex. With more than one range the
+// faces are first sorted into the ranges they touch, so a face is only evaluated again by
+// the ranges its corners straddle.
+struct tangent_job_t {
+	const float *positions;
+	const float *normals;
+	const float *tex_coords;
+	const unsigned int *indices;
+	size_t vertex_count;
+	size_t face_count;
+	size_t range_size;
+	float *tangents;
+
+	std::vector<size_t> first_face;           // by range, into range_faces
+	std::vector<unsigned int> range_faces;    // grouped by range, in face order; empty for one range
+};
+
+// What a face adds to each of its corners: its unit tangent, and in w the sign of its uv
+// winding, both scaled by the corner angle. The sum is projected onto the vertex normal
+// when it is normalized, and w ends up as the angle weighted vote on the handedness.
+struct face_basis_t {
+	float t[4];
+	float weight[3]; // by corner
+};
+
+static inline float dot3(const float *a, const float *b) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Abramowitz and Stegun 4.4.45, within 7e-5 radians; plenty for a weight
+static inline float approximate_acos(float x) {
+	x = x < -1.0f ? -1.0f : (x > 1.0f ? 1.0f : x);
+	float a = fabsf(x);
+	float r = sqrtf(1.0f - a) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f + a * -0.0187293f)));
+	return x < 0.0f ? 3.14159265f - r : r;
+}
+
+// v minus its component along the unit normal n, normalized; zero stays zero
+static inline void project_normalized(const float *n, const float *v, float *out) {
+	float d = dot3(n, v);
+	out[0] = v[0] - d * n[0];
+	out[1] = v[1] - d * n[1];
+	out[2] = v[2] - d * n[2];
+	float length = sqrtf(dot3(out, out));
+	float scale = length > 0.0f ? 1.0f / length : 0.0f;
+	out[0] *= scale;
+	out[1] *= scale;
+	out[2] *= scale;
+}
+
+static void face_basis(const tangent_job_t &job, const unsigned int *index, face_basis_t &basis) {
+	const float *uv0 = job.tex_coords + 2 * index[0];
+	const float *uv1 = job.tex_coords + 2 * index[1];
+	const float *uv2 = job.tex_coords + 2 * index[2];
+	float s1 = uv1[0] - uv0[0], t1 = uv1[1] - uv0[1];
+	float s2 = uv2[0] - uv0[0], t2 = uv2[1] - uv0[1];
+	float det = s1 * t2 - s2 * t1;
+	float sign = det > 0.0f ? 1.0f : (det < 0.0f ? -1.0f : 0.0f); // no uv area, no tangent
+
+	const float *p0 = job.positions + 3 * index[0];
+	const float *p1 = job.positions + 3 * index[1];
+	const float *p2 = job.positions + 3 * index[2];
+	float e1[3], e2[3], e3[3];
+	for (int c = 0; c < 3; c++) {
+		e1[c] = p1[c] - p0[c];
+		e2[c] = p2[c] - p0[c];
+		e3[c] = p2[c] - p1[c];
+		basis.t[c] = sign * (e1[c] * t2 - e2[c] * t1);
+	}
+	float tt = dot3(basis.t, basis.t);
+	float scale = tt > 1.0e-30f ? 1.0f / sqrtf(tt) : 0.0f;
+	for (int c = 0; c < 3; c++)
+		basis.t[c] *= scale;
+	basis.t[3] = sign < 0.0f ? -1.0f : 1.0f;
+
+	// the angles add up to pi, so the last one needs no acos
+	float l1 = dot3(e1, e1), l2 = dot3(e2, e2), l3 = dot3(e3, e3);
+	basis.weight[0] = approximate_acos(dot3(e1, e2) / sqrtf(std::max(l1 * l2, 1.0e-30f)));
+	basis.weight[1] = approximate_acos(-dot3(e1, e3) / sqrtf(std::max(l1 * l3, 1.0e-30f)));
+	basis.weight[2] = std::max(3.14159265f - basis.weight[0] - basis.weight[1], 0.0f);
+}
+
+// corners outside [begin, end) belong to another range
+static inline void add_corner(tangent_job_t &job, const face_basis_t &basis, int corner, size_t vertex, size_t begin, size_t end) {
+	if (vertex - begin >= end - begin)
+		return;
+	float *t = job.tangents + 4 * vertex;
+	for (int c = 0; c < 4; c++)
+		t[c] += basis.weight[corner] * basis.t[c];
+}
+
+// the sum projected and normalized, and w down to the sign of the weighted vote
+static inline void normalize_tangent(const float *n, float *t) {
+	float sum[3] = { t[0], t[1], t[2] };
+	project_normalized(n, sum, t);
+	if (t[0] == 0.0f && t[1] == 0.0f && t[2] == 0.0f) {
+		// no uv gradient here; any direction orthogonal to the normal will do
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+		axis[fabsf(n[0]) < 0.9f ? 0 : 1] = 1.0f;
+		project_normalized(n, axis, t);
+	}
+	t[3] = t[3] < 0.0f ? -1.0f : 1.0f;
+}
+
+#ifdef __SSE__
+#define DOT3(ax, ay, az, bx, by, bz)  _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz))
+
+static inline __m128 approximate_acos_x4(__m128 x) {
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+	__m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+	__m128 a = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+	__m128 p = _mm_add_ps(_mm_set1_ps(0.0742610f), _mm_mul_ps(a, _mm_set1_ps(-0.0187293f)));
+	p = _mm_add_ps(_mm_set1_ps(-0.2121144f), _mm_mul_ps(a, p));
+	p = _mm_add_ps(_mm_set1_ps(1.5707288f), _mm_mul_ps(a, p));
+	__m128 r = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), a)), p);
+	__m128 mirrored = _mm_sub_ps(_mm_set1_ps(3.14159265f), r);
+	return _mm_or_ps(_mm_and_ps(negative, mirrored), _mm_andnot_ps(negative, r));
+}
+
+// xyz of four vertices, one component per register: xy and z are loaded apart so that
+// nothing past the end of the stream is read
+static inline void load_xyz_x4(const float *stream, unsigned int a, unsigned int b, unsigned int c, unsigned int d,
+                               __m128 &x, __m128 &y, __m128 &z) {
+	const float *pa = stream + 3 * a, *pb = stream + 3 * b, *pc = stream + 3 * c, *pd = stream + 3 * d;
+	__m128 ab = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(pa)), reinterpret_cast<const __m64 *>(pb));
+	__m128 cd = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(pc)), reinterpret_cast<const __m64 *>(pd));
+	x = _mm_shuffle_ps(ab, cd, _MM_SHUFFLE(2, 0, 2, 0));
+	y = _mm_shuffle_ps(ab, cd, _MM_SHUFFLE(3, 1, 3, 1));
+	z = _mm_movelh_ps(_mm_unpacklo_ps(_mm_load_ss(pa + 2), _mm_load_ss(pb + 2)), _mm_unpacklo_ps(_mm_load_ss(pc + 2), _mm_load_ss(pd + 2)));
+}
+
+static inline void load_uv_x4(const float *stream, unsigned int a, unsigned int b, unsigned int c, unsigned int d, __m128 &u, __m128 &v) {
+	__m128 ab = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(stream + 2 * a)), reinterpret_cast<const __m64 *>(stream + 2 * b));
+	__m128 cd = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(stream + 2 * c)), reinterpret_cast<const __m64 *>(stream + 2 * d));
+	u = _mm_shuffle_ps(ab, cd, _MM_SHUFFLE(2, 0, 2, 0));
+	v = _mm_shuffle_ps(ab, cd, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+// add_corner of the three corners of one face, its weights picked from lane l of w0..w2
+#define ADD_CORNERS(job, face, basis, l, w0, w1, w2, begin, end) do { \
+	add_row(job, face[0], _mm_mul_ps(basis, _mm_shuffle_ps(w0, w0, _MM_SHUFFLE(l, l, l, l))), begin, end); \
+	add_row(job, face[1], _mm_mul_ps(basis, _mm_shuffle_ps(w1, w1, _MM_SHUFFLE(l, l, l, l))), begin, end); \
+	add_row(job, face[2], _mm_mul_ps(basis, _mm_shuffle_ps(w2, w2, _MM_SHUFFLE(l, l, l, l))), begin, end); \
+} while (0)
+
+static inline void add_row(tangent_job_t &job, size_t vertex, __m128 row, size_t begin, size_t end) {
+	if (vertex - begin >= end - begin)
+		return;
+	float *tangent = job.tangents + 4 * vertex;
+	_mm_storeu_ps(tangent, _mm_add_ps(_mm_loadu_ps(tangent), row));
+}
+
+// face_basis and add_corner of four faces, one per lane until the bases are transposed
+// back to one xyzw vector per face
+static void add_faces_x4(tangent_job_t &job, const unsigned int *f0, const unsigned int *f1, const unsigned int *f2, const unsigned int *f3,
+                         size_t begin, size_t end) {
+	__m128 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+	load_xyz_x4(job.positions, f0[0], f1[0], f2[0], f3[0], x0, y0, z0);
+	load_xyz_x4(job.positions, f0[1], f1[1], f2[1], f3[1], x1, y1, z1);
+	load_xyz_x4(job.positions, f0[2], f1[2], f2[2], f3[2], x2, y2, z2);
+	__m128 e1x = _mm_sub_ps(x1, x0), e1y = _mm_sub_ps(y1, y0), e1z = _mm_sub_ps(z1, z0);
+	__m128 e2x = _mm_sub_ps(x2, x0), e2y = _mm_sub_ps(y2, y0), e2z = _mm_sub_ps(z2, z0);
+	__m128 e3x = _mm_sub_ps(x2, x1), e3y = _mm_sub_ps(y2, y1), e3z = _mm_sub_ps(z2, z1);
+
+	// the angles add up to pi, so the last one needs no acos; for a weight the estimate of
+	// rsqrt is plenty
+	__m128 zero = _mm_setzero_ps();
+	__m128 tiny = _mm_set1_ps(1.0e-30f);
+	__m128 r1 = _mm_rsqrt_ps(_mm_max_ps(DOT3(e1x, e1y, e1z, e1x, e1y, e1z), tiny));
+	__m128 r2 = _mm_rsqrt_ps(_mm_max_ps(DOT3(e2x, e2y, e2z, e2x, e2y, e2z), tiny));
+	__m128 r3 = _mm_rsqrt_ps(_mm_max_ps(DOT3(e3x, e3y, e3z, e3x, e3y, e3z), tiny));
+	__m128 w1 = approximate_acos_x4(_mm_mul_ps(_mm_sub_ps(zero, DOT3(e1x, e1y, e1z, e3x, e3y, e3z)), _mm_mul_ps(r1, r3)));
+	__m128 w0 = approximate_acos_x4(_mm_mul_ps(DOT3(e1x, e1y, e1z, e2x, e2y, e2z), _mm_mul_ps(r1, r2)));
+	__m128 w2 = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(3.14159265f), w0), w1), zero);
+
+	__m128 u0, v0, u1, v1, u2, v2;
+	load_uv_x4(job.tex_coords, f0[0], f1[0], f2[0], f3[0], u0, v0);
+	load_uv_x4(job.tex_coords, f0[1], f1[1], f2[1], f3[1], u1, v1);
+	load_uv_x4(job.tex_coords, f0[2], f1[2], f2[2], f3[2], u2, v2);
+	__m128 s1 = _mm_sub_ps(u1, u0), t1 = _mm_sub_ps(v1, v0);
+	__m128 s2 = _mm_sub_ps(u2, u0), t2 = _mm_sub_ps(v2, v0);
+	__m128 det = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+	__m128 negative = _mm_cmplt_ps(det, zero);
+	__m128 sign = _mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(det, zero), _mm_set1_ps(1.0f)), _mm_and_ps(negative, _mm_set1_ps(-1.0f)));
+
+	__m128 tx = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(e1x, t2), _mm_mul_ps(e2x, t1)));
+	__m128 ty = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(e1y, t2), _mm_mul_ps(e2y, t1)));
+	__m128 tz = _mm_mul_ps(sign, _mm_sub_ps(_mm_mul_ps(e1z, t2), _mm_mul_ps(e2z, t1)));
+	__m128 scale = _mm_rsqrt_ps(_mm_max_ps(DOT3(tx, ty, tz, tx, ty, tz), tiny));
+	__m128 b0 = _mm_mul_ps(tx, scale), b1 = _mm_mul_ps(ty, scale), b2 = _mm_mul_ps(tz, scale);
+	__m128 b3 = _mm_or_ps(_mm_set1_ps(1.0f), _mm_and_ps(negative, _mm_set1_ps(-0.0f)));
+	_MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+	ADD_CORNERS(job, f0, b0, 0, w0, w1, w2, begin, end);
+	ADD_CORNERS(job, f1, b1, 1, w0, w1, w2, begin, end);
+	ADD_CORNERS(job, f2, b2, 2, w0, w1, w2, begin, end);
+	ADD_CORNERS(job, f3, b3, 3, w0, w1, w2, begin, end);
+}
+
+// normalize_tangent of vertices [vertex, vertex + 4), the rare one with no uv gradient
+// left to the scalar path
+static void normalize_tangents_x4(tangent_job_t &job, size_t vertex) {
+	float *tangents = job.tangents + 4 * vertex;
+	__m128 tx = _mm_loadu_ps(tangents), ty = _mm_loadu_ps(tangents + 4);
+	__m128 tz = _mm_loadu_ps(tangents + 8), tw = _mm_loadu_ps(tangents + 12);
+	_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+	unsigned int first = (unsigned int)vertex;
+	__m128 nx, ny, nz;
+	load_xyz_x4(job.normals, first, first + 1, first + 2, first + 3, nx, ny, nz);
+
+	__m128 d = DOT3(nx, ny, nz, tx, ty, tz);
+	__m128 x = _mm_sub_ps(tx, _mm_mul_ps(d, nx));
+	__m128 y = _mm_sub_ps(ty, _mm_mul_ps(d, ny));
+	__m128 z = _mm_sub_ps(tz, _mm_mul_ps(d, nz));
+	__m128 length = _mm_sqrt_ps(DOT3(x, y, z, x, y, z));
+	__m128 nonzero = _mm_cmpgt_ps(length, _mm_setzero_ps());
+	__m128 scale = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), length), nonzero);
+	x = _mm_mul_ps(x, scale);
+	y = _mm_mul_ps(y, scale);
+	z = _mm_mul_ps(z, scale);
+	__m128 w = _mm_or_ps(_mm_set1_ps(1.0f), _mm_and_ps(_mm_set1_ps(-0.0f), _mm_cmplt_ps(tw, _mm_setzero_ps())));
+
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	_mm_storeu_ps(tangents, x);
+	_mm_storeu_ps(tangents + 4, y);
+	_mm_storeu_ps(tangents + 8, z);
+	_mm_storeu_ps(tangents + 12, w);
+	// those are zero now, with w already set
+	int degenerate = ~_mm_movemask_ps(nonzero) & 15;
+	for (int l = 0; degenerate != 0; l++, degenerate >>= 1) {
+		if (degenerate & 1)
+			normalize_tangent(job.normals + 3 * (vertex + l), tangents + 4 * l);
+	}
+}
+
+#undef ADD_CORNERS
+#undef DOT3
+#endif
+
+static void compute_range_tangents(size_t first_range, size_t last_range, void *context) {
+	tangent_job_t &job = *static_cast<tangent_job_t *>(context);
+	for (size_t range = first_range; range < last_range; range++) {
+		size_t begin = range * job.range_size;
+		size_t end = std::min(begin + job.range_size, job.vertex_count);
+		std::fill(job.tangents + 4 * begin, job.tangents + 4 * end, 0.0f);
+
+		// one range takes every face in order, without a list
+		const unsigned int *faces = job.range_faces.empty() ? NULL : &job.range_faces[job.first_face[range]];
+		size_t face_count = faces == NULL ? job.face_count : job.first_face[range + 1] - job.first_face[range];
+
+		size_t i = 0;
+#ifdef __SSE__
+		if (faces == NULL) {
+			for (; i + 4 <= face_count; i += 4) {
+				const unsigned int *index = job.indices + 3 * i;
+				add_faces_x4(job, index, index + 3, index + 6, index + 9, begin, end);
+			}
+		} else {
+			for (; i + 4 <= face_count; i += 4) {
+				add_faces_x4(job, job.indices + 3 * faces[i], job.indices + 3 * faces[i + 1],
+				             job.indices + 3 * faces[i + 2], job.indices + 3 * faces[i + 3], begin, end);
+			}
+		}
+#endif
+		face_basis_t basis;
+		for (; i < face_count; i++) {
+			const unsigned int *face_index = job.indices + 3 * (faces == NULL ? i : faces[i]);
+			face_basis(job, face_index, basis);
+			for (int k = 0; k < 3; k++)
+				add_corner(job, basis, k, face_index[k], begin, end);
+		}
+
+		size_t vertex = begin;
+#ifdef __SSE__
+		for (; vertex + 4 <= end; vertex += 4)
+			normalize_tangents_x4(job, vertex);
+#endif
+		for (; vertex < end; vertex++)
+			normalize_tangent(job.normals + 3 * vertex, job.tangents + 4 * vertex);
+	}
+}
+
+// each face goes to every range one of its corners is in, in face order
+static void sort_faces_into_ranges(tangent_job_t &job, size_t range_count) {
+	job.first_face.assign(range_count + 1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		std::vector<size_t> next(job.first_face.begin(), job.first_face.end() - 1);
+		for (size_t face = 0; face < job.face_count; face++) {
+			const unsigned int *index = job.indices + 3 * face;
+			size_t r0 = index[0] / job.range_size, r1 = index[1] / job.range_size, r2 = index[2] / job.range_size;
+			size_t ranges[3] = { r0, r1 != r0 ? r1 : range_count, r2 != r0 && r2 != r1 ? r2 : range_count };
+			for (int k = 0; k < 3; k++) {
+				if (ranges[k] >= range_count)
+					continue;
+				if (pass == 0)
+					job.first_face[ranges[k] + 1]++;
+				else
+					job.range_faces[next[ranges[k]]++] = face;
+			}
+		}
+		if (pass == 0) {
+			for (size_t range = 0; range < range_count; range++)
+				job.first_face[range + 1] += job.first_face[range];
+			job.range_faces.resize(job.first_face[range_count]);
+		}
+	}
+}
+
+void compute_tangents(const float *positions, const float *normals, const float *tex_coords, size_t vertex_count,
+                      const unsigned int *indices, size_t index_count, float *tangents) {
+	if (vertex_count == 0)
+		return;
+
+	tangent_job_t job;
+	job.positions = positions;
+	job.normals = normals;
+	job.tex_coords = tex_coords;
+	job.indices = indices;
+	job.vertex_count = vertex_count;
+	job.face_count = index_count / 3;
+	job.tangents = tangents;
+
+	size_t range_count = std::max<size_t>(1, std::min(hardware_thread_count(), vertex_count / MIN_RANGE_SIZE));
+	job.range_size = (vertex_count + range_count - 1) / range_count;
+	range_count = (vertex_count + job.range_size - 1) / job.range_size;
+	if (range_count > 1)
+		sort_faces_into_ranges(job, range_count);
+
+	parallel_for(range_count, compute_range_tangents, &job, 1);
+}
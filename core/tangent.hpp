@@ -0,0 +1,17 @@
+#ifndef TANGENT_HPP
+#define TANGENT_HPP
+
+#include <cstddef>
+
+// MikkTSpace-style tangent basis for an indexed triangle list with xyz positions and
+// normals and uv tex coords. Every corner adds its face's unit uv-aligned tangent weighted
+// by the corner angle, so the result does not depend on triangle size or on how a surface
+// is split, and the sum is projected onto the vertex normal. Writes four floats per
+// vertex: the unit tangent orthogonal to the normal, and in w the handedness, so that
+// bitangent = w * cross(normal, tangent); w is the sign of the uv winding of the faces
+// around the vertex, each voting with its corner angle. One range of vertices per core
+// sums straight into tangents, four faces at a time with SSE where available.
+void compute_tangents(const float *positions, const float *normals, const float *tex_coords, size_t vertex_count,
+                      const unsigned int *indices, size_t index_count, float *tangents);
+
+#endif
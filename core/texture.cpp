@@ -0,0 +1,19 @@
+#include "texture.hpp"
+
+std::vector<texture_unit_t> texture_unit_t::collection;
+
+void texture_unit_t::initialize() {
+	GLint unit_count = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &unit_count);
+	texture_unit_t::collection.resize(unit_count);
+	for (GLint i = 0; i < unit_count; i++)
+		texture_unit_t::collection[i].unit_id = GL_TEXTURE0 + i;
+}
+
+void texture_unit_t::attach(int index, const texture_t *texture) {
+	texture_unit_t::collection[index].texture = texture;
+}
+
+void texture_unit_t::dettach(int index) {
+	texture_unit_t::collection[index].texture = NULL;
+}
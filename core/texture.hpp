@@ -2,7 +2,9 @@
 #define TEXTURE_HPP
 
 #include <vector>
-#include <OpenGL/gl.h>
+#include <cstddef>
+#include "gl.hpp"
+#include "render_state.hpp"
 
 struct texture_t {
 	GLenum target;
@@ -21,19 +23,16 @@ struct texture_unit_t {
 	}
 	
 	void activate() const {
-		if (texture != NULL) {
-			glActiveTexture(unit_id);
-			glBindTexture(texture->target, texture->handle);	
-		}
+		if (texture != NULL)
+			RENDER_STATE.bind_texture(unit_id, texture->target, texture->handle);
 	}
 	
 	void deactivate() const {
-		if (texture != NULL) {
-			glBindTexture(texture->target, 0);
-			glActiveTexture(0);
-		}
+		if (texture != NULL)
+			RENDER_STATE.bind_texture(unit_id, texture->target, 0);
 	}
 	
+	// one per unit the context has (GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS), once initialize() has run
 	static std::vector<texture_unit_t> collection;
 	
 	static void initialize();
@@ -0,0 +1,290 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "parallel.hpp"
+#include "texture_compressor.hpp"
+
+using namespace std;
+
+struct compression_job_t {
+	const unsigned char *rgba;
+	unsigned char *blocks;
+	size_t width;
+	size_t height;
+	texture_compression_t compression;
+};
+
+size_t compressed_block_size(texture_compression_t compression) {
+	return compression == TEXTURE_COMPRESSION_BC1 ? 8 : 16;
+}
+
+size_t compressed_image_size(texture_compression_t compression, size_t width, size_t height) {
+	return ((width + 3) / 4) * ((height + 3) / 4) * compressed_block_size(compression);
+}
+
+GLenum compressed_internal_format(texture_compression_t compression) {
+	switch (compression) {
+	case TEXTURE_COMPRESSION_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case TEXTURE_COMPRESSION_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	default: return GL_COMPRESSED_RED_GREEN_RGTC2_EXT;
+	}
+}
+
+bool is_compression_supported(texture_compression_t compression) {
+	if (compression == TEXTURE_COMPRESSION_BC5)
+		return has_gl_extension("GL_ARB_texture_compression_rgtc") || has_gl_extension("GL_EXT_texture_compression_rgtc");
+	return has_gl_extension("GL_EXT_texture_compression_s3tc");
+}
+
+static void write_u16(unsigned char *out, unsigned int value) {
+	out[0] = value & 0xff;
+	out[1] = (value >> 8) & 0xff;
+}
+
+static unsigned int read_u16(const unsigned char *in) {
+	return in[0] | (in[1] << 8);
+}
+
+static unsigned int pack_565(const float *color) {
+	int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+	r = min(max(r, 0), 31);
+	g = min(max(g, 0), 63);
+	b = min(max(b, 0), 31);
+	return (r << 11) | (g << 5) | b;
+}
+
+static void unpack_565(unsigned int packed, int *color) {
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1_palette(unsigned int c0, unsigned int c1, int palette[4][3]) {
+	unpack_565(c0, palette[0]);
+	unpack_565(c1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		if (c0 > c1) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		} else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+}
+
+// endpoints at the extremes of the pixels along their principal axis
+static void encode_bc1_block(const unsigned char pixels[16][4], unsigned char *out) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += pixels[i][c] / 16.0f;
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+		covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+		covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+	}
+
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		float length = max(fabsf(x), max(fabsf(y), fabsf(z)));
+		if (length == 0.0f)
+			break;
+		axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+	}
+
+	float lower = 0.0f, upper = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+		lower = min(lower, t);
+		upper = max(upper, t);
+	}
+	float axis_length_squared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float endpoints[2][3];
+	for (int c = 0; c < 3; c++) {
+		endpoints[0][c] = mean[c] + axis[c] * upper / axis_length_squared;
+		endpoints[1][c] = mean[c] + axis[c] * lower / axis_length_squared;
+	}
+
+	unsigned int c0 = pack_565(endpoints[0]), c1 = pack_565(endpoints[1]);
+	if (c0 < c1)
+		swap(c0, c1);
+	write_u16(out, c0);
+	write_u16(out + 2, c1);
+	if (c0 == c1) {
+		// three colour mode, where index 0 is c0 as well
+		memset(out + 4, 0, 4);
+		return;
+	}
+
+	int palette[4][3];
+	bc1_palette(c0, c1, palette);
+	unsigned int indices = 0;
+	for (int i = 0; i < 16; i++) {
+		int best = 0, best_distance = 1 << 30;
+		for (int p = 0; p < 4; p++) {
+			int dr = pixels[i][0] - palette[p][0], dg = pixels[i][1] - palette[p][1], db = pixels[i][2] - palette[p][2];
+			int distance = dr * dr + dg * dg + db * db;
+			if (distance < best_distance) {
+				best_distance = distance;
+				best = p;
+			}
+		}
+		indices |= best << (2 * i);
+	}
+	write_u16(out + 4, indices & 0xffff);
+	write_u16(out + 6, indices >> 16);
+}
+
+static void bc4_palette(int a0, int a1, int palette[8]) {
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1) {
+		for (int i = 2; i < 8; i++)
+			palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+	} else {
+		for (int i = 2; i < 6; i++)
+			palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// one channel; endpoints at its minimum and maximum, in the eight value mode
+static void encode_bc4_block(const unsigned char pixels[16][4], int channel, unsigned char *out) {
+	int a0 = 0, a1 = 255;
+	for (int i = 0; i < 16; i++) {
+		a0 = max(a0, (int)pixels[i][channel]);
+		a1 = min(a1, (int)pixels[i][channel]);
+	}
+	out[0] = a0;
+	out[1] = a1;
+
+	int palette[8];
+	bc4_palette(a0, a1, palette);
+	unsigned long long indices = 0;
+	if (a0 > a1) {
+		for (int i = 0; i < 16; i++) {
+			int best = 0, best_distance = 256;
+			for (int p = 0; p < 8; p++) {
+				int distance = abs(pixels[i][channel] - palette[p]);
+				if (distance < best_distance) {
+					best_distance = distance;
+					best = p;
+				}
+			}
+			indices |= (unsigned long long)best << (3 * i);
+		}
+	}
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+static void decode_bc1_block(const unsigned char *in, unsigned char pixels[16][4]) {
+	int palette[4][3];
+	bc1_palette(read_u16(in), read_u16(in + 2), palette);
+	unsigned int indices = read_u16(in + 4) | (read_u16(in + 6) << 16);
+	for (int i = 0; i < 16; i++) {
+		const int *color = palette[(indices >> (2 * i)) & 3];
+		pixels[i][0] = color[0];
+		pixels[i][1] = color[1];
+		pixels[i][2] = color[2];
+		pixels[i][3] = 255;
+	}
+}
+
+static void decode_bc4_block(const unsigned char *in, int channel, unsigned char pixels[16][4]) {
+	int palette[8];
+	bc4_palette(in[0], in[1], palette);
+	unsigned long long indices = 0;
+	for (int i = 0; i < 6; i++)
+		indices |= (unsigned long long)in[2 + i] << (8 * i);
+	for (int i = 0; i < 16; i++)
+		pixels[i][channel] = palette[(indices >> (3 * i)) & 7];
+}
+
+static void encode_block(const unsigned char pixels[16][4], texture_compression_t compression, unsigned char *out) {
+	switch (compression) {
+	case TEXTURE_COMPRESSION_BC1:
+		encode_bc1_block(pixels, out);
+		break;
+	case TEXTURE_COMPRESSION_BC3:
+		encode_bc4_block(pixels, 3, out);
+		encode_bc1_block(pixels, out + 8);
+		break;
+	case TEXTURE_COMPRESSION_BC5:
+		encode_bc4_block(pixels, 0, out);
+		encode_bc4_block(pixels, 1, out + 8);
+		break;
+	}
+}
+
+static void decode_block(const unsigned char *in, texture_compression_t compression, unsigned char pixels[16][4]) {
+	switch (compression) {
+	case TEXTURE_COMPRESSION_BC1:
+		decode_bc1_block(in, pixels);
+		break;
+	case TEXTURE_COMPRESSION_BC3:
+		decode_bc1_block(in + 8, pixels);
+		decode_bc4_block(in, 3, pixels);
+		break;
+	case TEXTURE_COMPRESSION_BC5:
+		decode_bc4_block(in, 0, pixels);
+		decode_bc4_block(in + 8, 1, pixels);
+		for (int i = 0; i < 16; i++) {
+			pixels[i][2] = 0;
+			pixels[i][3] = 255;
+		}
+		break;
+	}
+}
+
+static void compress_block_rows(size_t begin, size_t end, void *context) {
+	const compression_job_t *job = static_cast<const compression_job_t *>(context);
+	size_t block_columns = (job->width + 3) / 4;
+	size_t block_size = compressed_block_size(job->compression);
+
+	unsigned char pixels[16][4];
+	for (size_t by = begin; by < end; by++) {
+		for (size_t bx = 0; bx < block_columns; bx++) {
+			// blocks hanging over the edge repeat the last row and column
+			for (size_t i = 0; i < 16; i++) {
+				size_t x = min(bx * 4 + i % 4, job->width - 1);
+				size_t y = min(by * 4 + i / 4, job->height - 1);
+				memcpy(pixels[i], job->rgba + 4 * (y * job->width + x), 4);
+			}
+			encode_block(pixels, job->compression, job->blocks + (by * block_columns + bx) * block_size);
+		}
+	}
+}
+
+void compress_image(const unsigned char *rgba, size_t width, size_t height, texture_compression_t compression, unsigned char *blocks) {
+	compression_job_t job = { rgba, blocks, width, height, compression };
+	parallel_for((height + 3) / 4, compress_block_rows, &job, 8);
+}
+
+void decompress_image(const unsigned char *blocks, size_t width, size_t height, texture_compression_t compression, unsigned char *rgba) {
+	size_t block_columns = (width + 3) / 4;
+	size_t block_size = compressed_block_size(compression);
+
+	unsigned char pixels[16][4];
+	for (size_t by = 0; by < (height + 3) / 4; by++) {
+		for (size_t bx = 0; bx < block_columns; bx++) {
+			decode_block(blocks + (by * block_columns + bx) * block_size, compression, pixels);
+			for (size_t i = 0; i < 16; i++) {
+				size_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+				if (x < width && y < height)
+					memcpy(rgba + 4 * (y * width + x), pixels[i], 4);
+			}
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef TEXTURE_COMPRESSOR_HPP
+#define TEXTURE_COMPRESSOR_HPP
+
+#include <cstddef>
+#include "gl.hpp"
+
+enum texture_compression_t {
+	TEXTURE_COMPRESSION_BC1, // RGB, 8 bytes per 4x4 block
+	TEXTURE_COMPRESSION_BC3, // RGBA, 16 bytes per block
+	TEXTURE_COMPRESSION_BC5  // two channels (normal map xy), 16 bytes per block
+};
+
+size_t compressed_block_size(texture_compression_t compression);
+size_t compressed_image_size(texture_compression_t compression, size_t width, size_t height);
+GLenum compressed_internal_format(texture_compression_t compression);
+// GL_EXT_texture_compression_s3tc for BC1 and BC3, RGTC for BC5
+bool is_compression_supported(texture_compression_t compression);
+
+// rgba holds width * height RGBA8 pixels; blocks gets compressed_image_size bytes.
+// Block rows are encoded in parallel.
+void compress_image(const unsigned char *rgba, size_t width, size_t height, texture_compression_t compression, unsigned char *blocks);
+// the inverse, for measuring what compression loses; BC5 decodes to (x, y, 0, 255)
+void decompress_image(const unsigned char *blocks, size_t width, size_t height, texture_compression_t compression, unsigned char *rgba);
+
+#endif
@@ -0,0 +1,100 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include "gl.hpp"
+#include "mipmap.hpp"
+#include "texture_loader.hpp"
+
+using namespace std;
+
+static bool read_tga_file(const char *filepath, size_t &width, size_t &height, size_t &channels, vector<unsigned char> &pixels) {
+	ifstream input(filepath, ios::in | ios::binary);
+	if (!input)
+		return false;
+
+	unsigned char header[18];
+	if (!input.read((char *)header, sizeof(header)))
+		return false;
+
+	int image_type = header[2];
+	width = header[12] | (header[13] << 8);
+	height = header[14] | (header[15] << 8);
+	channels = header[16] / 8;
+	bool top_left_origin = (header[17] & 0x20) != 0;
+	if ((image_type != 2 && image_type != 10) || header[1] != 0 || (channels != 3 && channels != 4)) {
+		cerr << "Unsupported TGA file: " << filepath << endl;
+		return false;
+	}
+	input.seekg(header[0], ios::cur);
+
+	size_t pixel_count = width * height;
+	vector<unsigned char> data(pixel_count * channels);
+	if (image_type == 2) {
+		input.read((char *)&data[0], data.size());
+	} else {
+		size_t i = 0;
+		unsigned char packet[4];
+		while (i < pixel_count && input) {
+			int count = input.get();
+			size_t run = (count & 0x7f) + 1;
+			if (i + run > pixel_count)
+				break;
+			if (count & 0x80) {
+				input.read((char *)packet, channels);
+				for (size_t k = 0; k < run; k++, i++)
+					copy(packet, packet + channels, &data[i * channels]);
+			} else {
+				input.read((char *)&data[i * channels], run * channels);
+				i += run;
+			}
+		}
+		if (i != pixel_count)
+			input.setstate(ios::failbit);
+	}
+	if (!input) {
+		cerr << "Truncated TGA file: " << filepath << endl;
+		return false;
+	}
+
+	// BGR(A) to RGB(A), bottom row first as glTexImage2D expects
+	pixels.resize(data.size());
+	size_t row_size = width * channels;
+	for (size_t y = 0; y < height; y++) {
+		const unsigned char *src = &data[(top_left_origin ? height - 1 - y : y) * row_size];
+		unsigned char *dst = &pixels[y * row_size];
+		for (size_t x = 0; x < row_size; x += channels) {
+			dst[x + 0] = src[x + 2];
+			dst[x + 1] = src[x + 1];
+			dst[x + 2] = src[x + 0];
+			if (channels == 4)
+				dst[x + 3] = src[x + 3];
+		}
+	}
+	return true;
+}
+
+bool load_texture_2d_from_file(const char *filepath, bool build_mipmaps) {
+	size_t width, height, channels;
+	vector<unsigned char> pixels;
+	if (!read_tga_file(filepath, width, height, channels, pixels))
+		return false;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (!build_mipmaps) {
+		GLenum format = (channels == 4) ? GL_RGBA : GL_RGB;
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, &pixels[0]);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		return true;
+	}
+
+	vector<unsigned char> rgba(4 * width * height, 255);
+	for (size_t i = 0; i < width * height; i++)
+		copy(&pixels[i * channels], &pixels[i * channels] + channels, &rgba[4 * i]);
+	vector<mip_level_t> levels;
+	generate_mip_chain(&rgba[0], width, height, MIP_CONTENT_COLOR, MIP_FILTER_BOX, levels);
+	for (size_t i = 0; i < levels.size(); i++)
+		glTexImage2D(GL_TEXTURE_2D, i, (channels == 4) ? GL_RGBA : GL_RGB, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &levels[i].pixels[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	return true;
+}
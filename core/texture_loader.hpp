@@ -0,0 +1,10 @@
+#ifndef TEXTURE_LOADER_HPP
+#define TEXTURE_LOADER_HPP
+
+#include "gl.hpp"
+
+// loads a truecolor TGA file into the bound GL_TEXTURE_2D; the mips are filtered on the CPU
+// (generate_mip_chain) as sRGB colour
+bool load_texture_2d_from_file(const char *filepath, bool build_mipmaps);
+
+#endif
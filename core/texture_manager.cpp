@@ -0,0 +1,269 @@
+#include <string>
+#include <algorithm>
+#include "job_queue.hpp"
+#include "texture_uploader.hpp"
+#include "texture_compressor.hpp"
+#include "compressed_texture.hpp"
+#include "render_state.hpp"
+#include "texture_manager.hpp"
+
+using namespace std;
+
+struct texture_manager_t::entry_t {
+	texture_manager_t *manager;
+	texture_t *texture;
+	string filepath;
+	string compressed_filepath;
+	mip_content_t content;
+	compressed_texture_file_t compressed;
+	vector<mip_level_t> levels; // in system memory when there is no compressed file
+	size_t level_count;
+	size_t tail;                // levels from here down are uploaded with the texture and never evicted
+	size_t resident;            // finest level on the GPU, level_count while there is none
+	size_t last_used;           // frame of the last request
+	float screen_size;          // largest requested in that frame
+	bool decoded;
+	bool loaded;
+
+	size_t extent(size_t level) const {
+		if (compressed.is_open())
+			return max(compressed.level(level).width, compressed.level(level).height);
+		return max(levels[level].width, levels[level].height);
+	}
+};
+
+ostream& operator<<(ostream &output, const texture_stats_t &stats) {
+	output << "textures: " << stats.texture_count
+	       << ", resident " << stats.resident_bytes / 1024 << " / " << stats.budget_bytes / 1024 << " KB"
+	       << " (wanted " << stats.wanted_bytes / 1024 << " KB)"
+	       << ", streamed " << stats.streamed_levels << " levels (" << stats.streamed_bytes / 1024 << " KB)"
+	       << ", evicted " << stats.evicted_levels << " levels (" << stats.evicted_bytes / 1024 << " KB)"
+	       << ", pending " << stats.pending_levels << " levels";
+	return output;
+}
+
+texture_manager_t::texture_manager_t(job_queue_t &jobs, texture_uploader_t &uploader, size_t budget_bytes, size_t upload_bytes_per_frame) :
+	__jobs(jobs), __uploader(uploader), __budget(budget_bytes), __upload_bytes_per_frame(upload_bytes_per_frame), __frame(1) {
+	for (size_t i = 0; i < 3; i++)
+		__compression_supported[i] = is_compression_supported((texture_compression_t)i);
+}
+
+texture_manager_t::~texture_manager_t() {
+	for (size_t i = 0; i < __entries.size(); i++) {
+		if (__entries[i]->loaded) {
+			glDeleteTextures(1, &__entries[i]->texture->handle);
+			__entries[i]->texture->handle = 0;
+		}
+		delete __entries[i];
+	}
+	RENDER_STATE.invalidate();
+}
+
+void texture_manager_t::load(texture_t &texture, const char *filepath, mip_content_t content) {
+	texture.target = GL_TEXTURE_2D;
+	texture.handle = 0;
+
+	entry_t *entry = new entry_t();
+	entry->manager = this;
+	entry->texture = &texture;
+	entry->filepath = filepath;
+	entry->compressed_filepath = compressed_texture_file_t::filepath_for(filepath);
+	entry->content = content;
+	entry->level_count = entry->tail = entry->resident = 0;
+	entry->last_used = 0;
+	entry->screen_size = 0.0f;
+	entry->decoded = entry->loaded = false;
+	__entries.push_back(entry);
+	__entries_by_texture[&texture] = entry;
+	__jobs.push(decode, upload, entry);
+}
+
+// runs on a worker thread
+void texture_manager_t::decode(void *context) {
+	entry_t *entry = static_cast<entry_t *>(context);
+	texture_manager_t &manager = *(entry->manager);
+	if (entry->compressed.open(entry->compressed_filepath.c_str()) && !manager.__compression_supported[entry->compressed.compression()])
+		entry->compressed.close();
+
+	if (entry->compressed.is_open()) {
+		entry->level_count = entry->compressed.level_count();
+	} else {
+		image_t image;
+		if (!read_image_from_png_file(entry->filepath.c_str(), image, &manager.__image_pool))
+			return;
+		vector<unsigned char> rgba;
+		convert_to_rgba8(image, rgba);
+		generate_mip_chain(&rgba[0], image.width, image.height, entry->content, MIP_FILTER_BOX, entry->levels);
+		release_image(image);
+		entry->level_count = entry->levels.size();
+	}
+	if (entry->level_count == 0)
+		return;
+
+	entry->tail = entry->level_count - 1;
+	while (entry->tail > 0 && entry->extent(entry->tail - 1) <= STREAM_TAIL_SIZE)
+		entry->tail--;
+	entry->resident = entry->level_count;
+	entry->decoded = true;
+}
+
+void texture_manager_t::upload(void *context) {
+	entry_t *entry = static_cast<entry_t *>(context);
+	texture_manager_t &manager = *(entry->manager);
+	if (!entry->decoded)
+		return;
+
+	glGenTextures(1, &entry->texture->handle);
+	RENDER_STATE.bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, entry->texture->handle);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry->level_count - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, entry->level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	for (size_t level = entry->level_count; level > entry->tail; level--)
+		manager.upload_level(*entry, level - 1);
+
+	entry->loaded = true;
+	manager.__stats.texture_count++;
+}
+
+size_t texture_manager_t::level_size(const entry_t &entry, size_t level) const {
+	if (entry.compressed.is_open())
+		return entry.compressed.level(level).size;
+	return entry.levels[level].pixels.size();
+}
+
+// the coarsest level with at least as many texels across as the texture covers pixels
+size_t texture_manager_t::wanted_level(const entry_t &entry) const {
+	if (entry.last_used != __frame || entry.screen_size <= 0.0f)
+		return entry.tail;
+	size_t level = 0;
+	while (level < entry.tail && entry.extent(level + 1) >= entry.screen_size)
+		level++;
+	return level;
+}
+
+// these leave the texture bound to unit 0, where render code binds what it draws with anyway
+void texture_manager_t::set_base_level(const entry_t &entry) {
+	RENDER_STATE.bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, entry.texture->handle);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, min(entry.resident, entry.level_count - 1));
+}
+
+void texture_manager_t::upload_level(entry_t &entry, size_t level) {
+	RENDER_STATE.bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, entry.texture->handle);
+	if (entry.compressed.is_open()) {
+		const compressed_texture_file_t::level_t &data = entry.compressed.level(level);
+		__uploader.upload_compressed(GL_TEXTURE_2D, level, compressed_internal_format(entry.compressed.compression()), data.width, data.height,
+		                             data.data, data.size);
+	} else {
+		const mip_level_t &data = entry.levels[level];
+		__uploader.upload(GL_TEXTURE_2D, level, GL_RGBA, data.width, data.height, GL_RGBA, GL_UNSIGNED_BYTE, &data.pixels[0], data.pixels.size());
+	}
+	entry.resident = level;
+	set_base_level(entry);
+	__stats.resident_bytes += level_size(entry, level);
+}
+
+void texture_manager_t::evict_level(entry_t &entry) {
+	size_t level = entry.resident;
+	entry.resident++;
+	set_base_level(entry);
+	// a zero sized image releases the level's storage; it is outside [BASE_LEVEL, MAX_LEVEL],
+	// so the texture stays complete
+	glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	size_t size = level_size(entry, level);
+	__stats.resident_bytes -= size;
+	__stats.evicted_levels++;
+	__stats.evicted_bytes += size;
+}
+
+bool texture_manager_t::evict(bool keep_requested) {
+	entry_t *victim = NULL;
+	for (size_t i = 0; i < __entries.size(); i++) {
+		entry_t *entry = __entries[i];
+		if (!entry->loaded || entry->resident >= entry->tail)
+			continue;
+		if (keep_requested && entry->last_used == __frame && entry->resident >= wanted_level(*entry))
+			continue;
+		if (victim == NULL || entry->last_used < victim->last_used
+		    || (entry->last_used == victim->last_used && level_size(*entry, entry->resident) > level_size(*victim, victim->resident)))
+			victim = entry;
+	}
+	if (victim == NULL)
+		return false;
+	evict_level(*victim);
+	return true;
+}
+
+void texture_manager_t::request(const texture_t &texture, float screen_size) {
+	map<const texture_t *, entry_t *>::iterator it = __entries_by_texture.find(&texture);
+	if (it == __entries_by_texture.end())
+		return;
+	entry_t *entry = it->second;
+	if (entry->last_used != __frame) {
+		entry->last_used = __frame;
+		entry->screen_size = 0.0f;
+	}
+	entry->screen_size = max(entry->screen_size, screen_size);
+}
+
+void texture_manager_t::update() {
+	__stats.streamed_levels = __stats.streamed_bytes = 0;
+	__stats.evicted_levels = __stats.evicted_bytes = 0;
+
+	// the budget may have shrunk, or new textures come in over it
+	while (__stats.resident_bytes > __budget && evict(true))
+		;
+	while (__stats.resident_bytes > __budget && evict(false))
+		;
+
+	// by how many levels short they are, so the blurriest go first
+	vector<pair<size_t, size_t> > candidates;
+	for (size_t i = 0; i < __entries.size(); i++) {
+		const entry_t &entry = *__entries[i];
+		if (entry.loaded && entry.last_used == __frame && wanted_level(entry) < entry.resident)
+			candidates.push_back(make_pair(entry.resident - wanted_level(entry), i));
+	}
+	sort(candidates.rbegin(), candidates.rend());
+
+	// a level at a time round the candidates, so every texture sharpens evenly
+	bool streaming = true;
+	while (streaming) {
+		bool progress = false;
+		for (size_t i = 0; streaming && i < candidates.size(); i++) {
+			entry_t &entry = *__entries[candidates[i].second];
+			if (wanted_level(entry) >= entry.resident)
+				continue;
+			size_t size = level_size(entry, entry.resident - 1);
+			if (__stats.streamed_bytes > 0 && __stats.streamed_bytes + size > __upload_bytes_per_frame) {
+				streaming = false;
+				break;
+			}
+			while (__stats.resident_bytes + size > __budget && evict(true))
+				;
+			if (__stats.resident_bytes + size > __budget)
+				continue;
+			upload_level(entry, entry.resident - 1);
+			__stats.streamed_levels++;
+			__stats.streamed_bytes += size;
+			progress = true;
+		}
+		streaming = streaming && progress;
+	}
+
+	__stats.budget_bytes = __budget;
+	__stats.wanted_bytes = 0;
+	__stats.pending_levels = 0;
+	for (size_t i = 0; i < __entries.size(); i++) {
+		const entry_t &entry = *__entries[i];
+		if (!entry.loaded || entry.last_used != __frame)
+			continue;
+		size_t wanted = wanted_level(entry);
+		for (size_t level = wanted; level < entry.level_count; level++)
+			__stats.wanted_bytes += level_size(entry, level);
+		if (wanted < entry.resident)
+			__stats.pending_levels += entry.resident - wanted;
+	}
+	__frame++;
+}
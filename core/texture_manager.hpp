@@ -0,0 +1,96 @@
+#ifndef TEXTURE_MANAGER_HPP
+#define TEXTURE_MANAGER_HPP
+
+#include <map>
+#include <vector>
+#include <iostream>
+#include <cstddef>
+#include "gl.hpp"
+#include "texture.hpp"
+#include "image_loader.hpp"
+#include "mipmap.hpp"
+
+class job_queue_t;
+class texture_uploader_t;
+
+struct texture_stats_t {
+	size_t texture_count;    // with their low mips in
+	size_t resident_bytes;
+	size_t budget_bytes;
+	size_t wanted_bytes;     // what the textures requested this frame take at the mip they want
+	size_t streamed_levels;  // in the last update()
+	size_t streamed_bytes;
+	size_t evicted_levels;
+	size_t evicted_bytes;
+	size_t pending_levels;   // wanted but not resident after the last update()
+
+	texture_stats_t() : texture_count(0), resident_bytes(0), budget_bytes(0), wanted_bytes(0), streamed_levels(0), streamed_bytes(0),
+		evicted_levels(0), evicted_bytes(0), pending_levels(0) { }
+};
+
+std::ostream& operator<<(std::ostream &output, const texture_stats_t &stats);
+
+// Streams the mips of 2D textures within a memory budget. A texture comes in with only its
+// small mips (up to STREAM_TAIL_SIZE), so it is drawable early; request() says how large it
+// is on screen this frame, and update() streams in the finer mips that size calls for, a
+// few megabytes a frame, evicting the finest mips of the least recently used textures when
+// the budget is full. GL_TEXTURE_BASE_LEVEL keeps the sampler on the resident mips, so a
+// texture_t keeps its handle throughout. Create and destroy with the GL context current,
+// and destroy after the job queue.
+class texture_manager_t {
+
+public:
+
+	enum { STREAM_TAIL_SIZE = 64 };
+
+	texture_manager_t(job_queue_t &jobs, texture_uploader_t &uploader, size_t budget_bytes, size_t upload_bytes_per_frame = 4 << 20);
+	~texture_manager_t();
+
+	// decodes filepath on the job queue; a .dds file cooked from it is used instead when present
+	// and its compression is supported. texture stays unbound (handle 0) until the small mips are
+	// uploaded. content says how mips generated from a PNG are filtered
+	void load(texture_t &texture, const char *filepath, mip_content_t content);
+	// texture covers about screen_size pixels across this frame; a texture requested more than
+	// once in a frame gets the largest size
+	void request(const texture_t &texture, float screen_size);
+	// once a frame, after the requests
+	void update();
+
+	size_t budget() const { return __budget; }
+	void set_budget(size_t budget_bytes) { __budget = budget_bytes; }
+	// of the last update()
+	const texture_stats_t& stats() const { return __stats; }
+
+private:
+
+	struct entry_t;
+
+	static void decode(void *context);
+	static void upload(void *context);
+
+	size_t level_size(const entry_t &entry, size_t level) const;
+	size_t wanted_level(const entry_t &entry) const;
+	void upload_level(entry_t &entry, size_t level);
+	void evict_level(entry_t &entry);
+	void set_base_level(const entry_t &entry);
+	// drops the finest mip of the least recently used texture that has one to spare; with
+	// keep_requested, the mips textures requested this frame want are spared
+	bool evict(bool keep_requested);
+
+	texture_manager_t(const texture_manager_t &);
+	texture_manager_t& operator=(const texture_manager_t &);
+
+	job_queue_t &__jobs;
+	texture_uploader_t &__uploader;
+	size_t __budget;
+	size_t __upload_bytes_per_frame;
+	size_t __frame;
+	bool __compression_supported[3]; // by texture_compression_t
+	image_pool_t __image_pool;
+	std::vector<entry_t *> __entries;
+	std::map<const texture_t *, entry_t *> __entries_by_texture;
+	texture_stats_t __stats;
+
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include <cstring>
+#include "texture_uploader.hpp"
+
+#define BUFFER_OFFSET(bytes) ((GLubyte *)NULL + (bytes))
+
+texture_uploader_t::texture_uploader_t(size_t buffer_size, size_t buffer_count) :
+	__buffer_size(buffer_size), __next(0), __mapped(false), __upload_count(0), __orphan_count(0), __buffers(buffer_count) {
+	for (size_t i = 0; i < __buffers.size(); i++) {
+		glGenBuffers(1, &__buffers[i].handle);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, __buffers[i].handle);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, __buffer_size, NULL, GL_STREAM_DRAW);
+		__buffers[i].fence = 0;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+texture_uploader_t::~texture_uploader_t() {
+	for (size_t i = 0; i < __buffers.size(); i++) {
+		if (__buffers[i].fence)
+			delete_gl_fence(__buffers[i].fence);
+		glDeleteBuffers(1, &__buffers[i].handle);
+	}
+}
+
+void* texture_uploader_t::map(size_t size) {
+	if (size > __buffer_size || __buffers.empty())
+		return NULL;
+
+	pixel_buffer_t &buffer = __buffers[__next];
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.handle);
+	if (buffer.fence) {
+		if (!gl_fence_passed(buffer.fence)) {
+			// still being read: let the driver hand out fresh storage rather than wait for it
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, __buffer_size, NULL, GL_STREAM_DRAW);
+			__orphan_count++;
+		}
+		delete_gl_fence(buffer.fence);
+		buffer.fence = 0;
+	}
+
+	void *memory = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	if (memory == NULL) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return NULL;
+	}
+	__mapped = true;
+	return memory;
+}
+
+bool texture_uploader_t::unmap() {
+	if (!__mapped)
+		return false;
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	__mapped = false;
+	return true;
+}
+
+void texture_uploader_t::fence() {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	__buffers[__next].fence = insert_gl_fence();
+	__next = (__next + 1) % __buffers.size();
+	__upload_count++;
+}
+
+void texture_uploader_t::upload(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLenum format, GLenum type) {
+	if (!unmap())
+		return;
+
+	// rows are packed tightly in the buffer
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(target, level, internal_format, width, height, 0, format, type, BUFFER_OFFSET(0));
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	fence();
+}
+
+void texture_uploader_t::upload(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLenum format, GLenum type,
+                                const void *pixels, size_t size) {
+	void *memory = map(size);
+	if (memory == NULL) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(target, level, internal_format, width, height, 0, format, type, pixels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		return;
+	}
+	std::memcpy(memory, pixels, size);
+	upload(target, level, internal_format, width, height, format, type);
+}
+
+void texture_uploader_t::upload_compressed(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height, size_t size) {
+	if (!unmap())
+		return;
+
+	glCompressedTexImage2D(target, level, internal_format, width, height, 0, size, BUFFER_OFFSET(0));
+	fence();
+}
+
+void texture_uploader_t::upload_compressed(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height,
+                                           const void *data, size_t size) {
+	void *memory = map(size);
+	if (memory == NULL) {
+		glCompressedTexImage2D(target, level, internal_format, width, height, 0, size, data);
+		return;
+	}
+	std::memcpy(memory, data, size);
+	upload_compressed(target, level, internal_format, width, height, size);
+}
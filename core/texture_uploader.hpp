@@ -0,0 +1,59 @@
+#ifndef TEXTURE_UPLOADER_HPP
+#define TEXTURE_UPLOADER_HPP
+
+#include <vector>
+#include <cstddef>
+#include "gl.hpp"
+
+struct pixel_buffer_t {
+	GLuint handle;
+	gl_fence_t fence; // set after the last upload from the buffer, 0 once it has passed
+};
+
+// Uploads texture images through a ring of GL_PIXEL_UNPACK_BUFFERs, so glTexImage2D returns
+// without copying and the transfer overlaps rendering. A buffer the GPU still reads from is
+// orphaned instead of waited on. Create and destroy with the GL context current.
+class texture_uploader_t {
+
+public:
+
+	texture_uploader_t(size_t buffer_size = 8 << 20, size_t buffer_count = 3);
+	~texture_uploader_t();
+
+	size_t buffer_size() const { return __buffer_size; }
+
+	// returns the next buffer of the ring mapped for size bytes of pixel data, for the caller
+	// to write into before upload(); NULL when size is larger than a buffer
+	void* map(size_t size);
+	// unmaps the buffer from map() and specifies a level of the texture bound to target from it
+	void upload(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLenum format, GLenum type);
+	// map, copy and upload in one; images larger than a buffer are uploaded from client memory
+	void upload(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLenum format, GLenum type,
+	            const void *pixels, size_t size);
+	// the same for a level of block compressed data
+	void upload_compressed(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height, size_t size);
+	void upload_compressed(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height,
+	                       const void *data, size_t size);
+
+	size_t upload_count() const { return __upload_count; }
+	size_t orphan_count() const { return __orphan_count; }
+
+private:
+
+	// unmaps the buffer from map(); returns false when nothing is mapped
+	bool unmap();
+	void fence();
+
+	texture_uploader_t(const texture_uploader_t &);
+	texture_uploader_t& operator=(const texture_uploader_t &);
+
+	size_t __buffer_size;
+	size_t __next;
+	bool __mapped;
+	size_t __upload_count;
+	size_t __orphan_count;
+	std::vector<pixel_buffer_t> __buffers;
+
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#include "transform_batch.hpp"
+
+void transform_batch_t::resize(size_t size) {
+	size_t padded_size = (size + 3) & ~(size_t)3;
+	for (int c = 0; c < COMPONENT_COUNT; c++)
+		__components[c].resize(padded_size);
+	__size = size;
+	for (size_t i = size; i < padded_size; i++)
+		set(i, glm::vec3(0.0f), glm::vec3(1.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+}
+
+void transform_batch_t::set(size_t i, const glm::vec3 &position, const glm::vec3 &scale, const glm::quat &orientation) {
+	__components[POSITION_X][i] = position.x;
+	__components[POSITION_Y][i] = position.y;
+	__components[POSITION_Z][i] = position.z;
+	__components[SCALE_X][i] = scale.x;
+	__components[SCALE_Y][i] = scale.y;
+	__components[SCALE_Z][i] = scale.z;
+	__components[ORIENTATION_X][i] = orientation.x;
+	__components[ORIENTATION_Y][i] = orientation.y;
+	__components[ORIENTATION_Z][i] = orientation.z;
+	__components[ORIENTATION_W][i] = orientation.w;
+}
+
+#ifdef __SSE__
+
+// m[row][column] holds that element of four matrices, one per lane
+static inline void store_mat4x4(__m128 m[4][4], glm::mat4 *out, size_t count) {
+	for (int c = 0; c < 4; c++) {
+		__m128 lanes[4] = { m[0][c], m[1][c], m[2][c], m[3][c] };
+		_MM_TRANSPOSE4_PS(lanes[0], lanes[1], lanes[2], lanes[3]);
+		for (size_t l = 0; l < count; l++)
+			_mm_storeu_ps(&out[l][c][0], lanes[l]);
+	}
+}
+
+static inline void store_mat3x4(__m128 m[3][3], glm::mat3 *out, size_t count) {
+	for (int c = 0; c < 3; c++) {
+		__m128 lanes[4] = { m[0][c], m[1][c], m[2][c], _mm_setzero_ps() };
+		_MM_TRANSPOSE4_PS(lanes[0], lanes[1], lanes[2], lanes[3]);
+		for (size_t l = 0; l < count; l++) {
+			float column[4];
+			_mm_storeu_ps(column, lanes[l]);
+			out[l][c] = glm::vec3(column[0], column[1], column[2]);
+		}
+	}
+}
+
+static void compute_transforms_x4(const transform_batch_t &batch, size_t i, size_t count, const glm::mat4 &view_matrix,
+                                  const glm::mat3 &view_normal_matrix, glm::mat4 *model_matrices, glm::mat4 *model_view_matrices,
+                                  glm::mat3 *normal_matrices) {
+	__m128 p[3], s[3];
+	for (int k = 0; k < 3; k++) {
+		p[k] = _mm_loadu_ps(batch.component((transform_batch_t::component_t)(transform_batch_t::POSITION_X + k)) + i);
+		s[k] = _mm_loadu_ps(batch.component((transform_batch_t::component_t)(transform_batch_t::SCALE_X + k)) + i);
+	}
+	__m128 x = _mm_loadu_ps(batch.component(transform_batch_t::ORIENTATION_X) + i);
+	__m128 y = _mm_loadu_ps(batch.component(transform_batch_t::ORIENTATION_Y) + i);
+	__m128 z = _mm_loadu_ps(batch.component(transform_batch_t::ORIENTATION_Z) + i);
+	__m128 w = _mm_loadu_ps(batch.component(transform_batch_t::ORIENTATION_W) + i);
+
+	// the rotation, as glm::mat3_cast builds it
+	__m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+	__m128 x2 = _mm_mul_ps(two, x), y2 = _mm_mul_ps(two, y), z2 = _mm_mul_ps(two, z);
+	__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+	__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+	__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+	__m128 r[3][3] = {
+		{ _mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_sub_ps(xy, wz), _mm_add_ps(xz, wy) },
+		{ _mm_add_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_sub_ps(yz, wx) },
+		{ _mm_sub_ps(xz, wy), _mm_add_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy)) }
+	};
+
+	// model = T * S * R: row k of the rotation scaled by s[k]
+	__m128 model[4][4];
+	for (int k = 0; k < 3; k++) {
+		for (int c = 0; c < 3; c++)
+			model[k][c] = _mm_mul_ps(s[k], r[k][c]);
+		model[k][3] = p[k];
+		model[3][k] = zero;
+	}
+	model[3][3] = one;
+	if (model_matrices)
+		store_mat4x4(model, model_matrices + i, count);
+
+	if (model_view_matrices) {
+		__m128 model_view[4][4];
+		for (int row = 0; row < 3; row++) {
+			for (int c = 0; c < 4; c++) {
+				__m128 sum = c == 3 ? _mm_set1_ps(view_matrix[3][row]) : zero;
+				for (int k = 0; k < 3; k++)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(view_matrix[k][row]), model[k][c]));
+				model_view[row][c] = sum;
+			}
+		}
+		for (int c = 0; c < 4; c++)
+			model_view[3][c] = model[3][c];
+		store_mat4x4(model_view, model_view_matrices + i, count);
+	}
+
+	// the inverse transpose of S * R is S^-1 * R, so only the view's needs a real inverse
+	if (normal_matrices) {
+		__m128 inverse_scaled[3][3];
+		for (int k = 0; k < 3; k++) {
+			__m128 inverse_scale = _mm_div_ps(one, s[k]);
+			for (int c = 0; c < 3; c++)
+				inverse_scaled[k][c] = _mm_mul_ps(inverse_scale, r[k][c]);
+		}
+		__m128 normal[3][3];
+		for (int row = 0; row < 3; row++) {
+			for (int c = 0; c < 3; c++) {
+				__m128 sum = zero;
+				for (int k = 0; k < 3; k++)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(view_normal_matrix[k][row]), inverse_scaled[k][c]));
+				normal[row][c] = sum;
+			}
+		}
+		store_mat3x4(normal, normal_matrices + i, count);
+	}
+}
+
+#else
+
+static void compute_transform(const transform_batch_t &batch, size_t i, const glm::mat4 &view_matrix, const glm::mat3 &view_normal_matrix,
+                              glm::mat4 *model_matrices, glm::mat4 *model_view_matrices, glm::mat3 *normal_matrices) {
+	glm::vec3 p(batch.component(transform_batch_t::POSITION_X)[i], batch.component(transform_batch_t::POSITION_Y)[i],
+	            batch.component(transform_batch_t::POSITION_Z)[i]);
+	glm::vec3 s(batch.component(transform_batch_t::SCALE_X)[i], batch.component(transform_batch_t::SCALE_Y)[i],
+	            batch.component(transform_batch_t::SCALE_Z)[i]);
+	glm::quat q(batch.component(transform_batch_t::ORIENTATION_W)[i], batch.component(transform_batch_t::ORIENTATION_X)[i],
+	            batch.component(transform_batch_t::ORIENTATION_Y)[i], batch.component(transform_batch_t::ORIENTATION_Z)[i]);
+
+	glm::mat4 model;
+	glm::mat3 normal;
+	compose_transform(p, s, q, model, normal);
+	if (model_matrices)
+		model_matrices[i] = model;
+	if (model_view_matrices)
+		model_view_matrices[i] = view_matrix * model;
+	if (normal_matrices)
+		normal_matrices[i] = view_normal_matrix * normal;
+}
+
+#endif
+
+// the inverse transpose of S * R is S^-1 * R
+void compose_transform(const glm::vec3 &position, const glm::vec3 &scale, const glm::quat &orientation,
+                       glm::mat4 &model_matrix, glm::mat3 &normal_matrix) {
+	glm::mat3 r = glm::mat3_cast(orientation);
+	model_matrix = glm::mat4(glm::vec4(scale * r[0], 0.0f), glm::vec4(scale * r[1], 0.0f), glm::vec4(scale * r[2], 0.0f),
+	                         glm::vec4(position, 1.0f));
+	normal_matrix = glm::mat3(r[0] / scale, r[1] / scale, r[2] / scale);
+}
+
+void compute_transforms(const transform_batch_t &batch, const glm::mat4 &view_matrix,
+                        glm::mat4 *model_matrices, glm::mat4 *model_view_matrices, glm::mat3 *normal_matrices) {
+	glm::mat3 view_normal_matrix = glm::transpose(glm::inverse(glm::mat3(view_matrix)));
+#ifdef __SSE__
+	for (size_t i = 0; i < batch.size(); i += 4) {
+		size_t count = batch.size() - i < 4 ? batch.size() - i : 4;
+		compute_transforms_x4(batch, i, count, view_matrix, view_normal_matrix, model_matrices, model_view_matrices, normal_matrices);
+	}
+#else
+	for (size_t i = 0; i < batch.size(); i++)
+		compute_transform(batch, i, view_matrix, view_normal_matrix, model_matrices, model_view_matrices, normal_matrices);
+#endif
+}
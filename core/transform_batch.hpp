@@ -0,0 +1,56 @@
+#ifndef TRANSFORM_BATCH_HPP
+#define TRANSFORM_BATCH_HPP
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// The position, scale and orientation of many objects, as scene_graph_t holds them, with an array
+// per component so four objects load into one SSE register. The arrays are padded to a
+// multiple of four with identity transforms.
+class transform_batch_t {
+
+public:
+
+	enum component_t {
+		POSITION_X, POSITION_Y, POSITION_Z,
+		SCALE_X, SCALE_Y, SCALE_Z,
+		ORIENTATION_X, ORIENTATION_Y, ORIENTATION_Z, ORIENTATION_W,
+		COMPONENT_COUNT
+	};
+
+	transform_batch_t() : __size(0) { }
+
+	void resize(size_t size);
+	void set(size_t i, const glm::vec3 &position, const glm::vec3 &scale, const glm::quat &orientation);
+
+	size_t size() const { return __size; }
+	float* component(component_t c) { return __components[c].empty() ? NULL : &__components[c][0]; }
+	const float* component(component_t c) const { return __components[c].empty() ? NULL : &__components[c][0]; }
+
+private:
+
+	size_t __size;
+	std::vector<float> __components[COMPONENT_COUNT];
+
+};
+
+// For every object of batch, as scene_graph_t composes them:
+//   model_matrices[i] = translate(position) * scale(scale) * mat4_cast(orientation)
+//   model_view_matrices[i] = view_matrix * model_matrices[i]
+//   normal_matrices[i] = transpose(inverse(mat3(model_view_matrices[i])))
+// Any of the outputs may be NULL. The normal matrix comes from the TRS structure, the
+// rotation with the scales inverted, and the inverse transpose of view_matrix taken once,
+// rather than a general inverse per object. Orientations must be unit quaternions. Four
+// objects at a time with SSE where available.
+void compute_transforms(const transform_batch_t &batch, const glm::mat4 &view_matrix,
+                        glm::mat4 *model_matrices, glm::mat4 *model_view_matrices, glm::mat3 *normal_matrices);
+
+// The model matrix of one object and the inverse transpose of its upper 3x3, composed as
+// compute_transforms does, for objects and scene graph nodes kept outside a batch. Normal
+// matrices compose like model matrices, so a hierarchy multiplies them down from its roots.
+void compose_transform(const glm::vec3 &position, const glm::vec3 &scale, const glm::quat &orientation,
+                       glm::mat4 &model_matrix, glm::mat3 &normal_matrix);
+
+#endif
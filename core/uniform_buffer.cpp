@@ -0,0 +1,105 @@
+#include <iostream>
+#include <cstring>
+#include "uniform_buffer.hpp"
+
+using namespace std;
+
+bool uniform_buffers_supported() {
+	return has_gl_extension("GL_ARB_uniform_buffer_object");
+}
+
+uniform_ring_t::uniform_ring_t(size_t frame_size, size_t frame_count) :
+	__handle(0), __frame_size(frame_size), __alignment(256), __frame(0), __head(0), __flushed(0), __started(false), __persistent(false), __memory(NULL), __fences(frame_count, 0) {
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0)
+		__alignment = alignment;
+	__frame_size = aligned_size(__frame_size);
+	size_t size = __frame_size * frame_count;
+
+	glGenBuffers(1, &__handle);
+	glBindBuffer(GL_UNIFORM_BUFFER, __handle);
+#ifdef GL_ARB_buffer_storage
+	if (has_gl_extension("GL_ARB_buffer_storage")) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, size, NULL, flags);
+		__memory = static_cast<unsigned char *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+		__persistent = __memory != NULL;
+		if (!__persistent) {
+			// storage from glBufferStorage is immutable, so start over with a fresh buffer
+			glDeleteBuffers(1, &__handle);
+			glGenBuffers(1, &__handle);
+			glBindBuffer(GL_UNIFORM_BUFFER, __handle);
+		}
+	}
+#endif
+	if (!__persistent) {
+		glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_STREAM_DRAW);
+		__staging.resize(size);
+		__memory = &__staging[0];
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+uniform_ring_t::~uniform_ring_t() {
+	for (size_t i = 0; i < __fences.size(); i++) {
+		if (__fences[i])
+			delete_gl_fence(__fences[i]);
+	}
+	if (__persistent) {
+		glBindBuffer(GL_UNIFORM_BUFFER, __handle);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &__handle);
+}
+
+void uniform_ring_t::begin_frame() {
+	// the draws of the last frame are all issued by now
+	if (__persistent && __started)
+		__fences[__frame] = insert_gl_fence();
+	__started = true;
+
+	__frame = (__frame + 1) % __fences.size();
+	__head = __flushed = 0;
+	gl_fence_t &fence = __fences[__frame];
+	if (fence) {
+		wait_gl_fence(fence);
+		delete_gl_fence(fence);
+		fence = 0;
+	}
+}
+
+void* uniform_ring_t::allocate(size_t size, GLintptr &offset) {
+	size = aligned_size(size);
+	if (__head + size > __frame_size) {
+		cerr << "*** Uniform ring frame of " << __frame_size << " bytes is full" << endl;
+		return NULL;
+	}
+	offset = __frame * __frame_size + __head;
+	__head += size;
+	return __memory + offset;
+}
+
+GLintptr uniform_ring_t::push(const void *data, size_t size) {
+	GLintptr offset;
+	void *memory = allocate(size, offset);
+	if (memory == NULL)
+		return -1;
+	memcpy(memory, data, size);
+	return offset;
+}
+
+void uniform_ring_t::flush() {
+	if (__persistent || __head == __flushed)
+		return;
+	size_t begin = __frame * __frame_size + __flushed;
+	glBindBuffer(GL_UNIFORM_BUFFER, __handle);
+	glBufferSubData(GL_UNIFORM_BUFFER, begin, __head - __flushed, __memory + begin);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	__flushed = __head;
+}
+
+void uniform_ring_t::bind(GLuint binding, GLintptr offset, size_t size) const {
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, __handle, offset, size);
+}
@@ -0,0 +1,73 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <vector>
+#include <cstddef>
+#include "gl.hpp"
+#include <glm/glm.hpp>
+
+// a mat3 as a std140 block lays it out: three columns, each padded to a vec4
+struct std140_mat3_t {
+	glm::vec4 columns[3];
+
+	std140_mat3_t() { }
+	std140_mat3_t(const glm::mat3 &m) {
+		for (int i = 0; i < 3; i++)
+			columns[i] = glm::vec4(m[i], 0.0f);
+	}
+};
+
+// call with a context current
+bool uniform_buffers_supported();
+
+// Streams uniform blocks through one GL_UNIFORM_BUFFER split into a region per frame in
+// flight. Blocks are written straight into the buffer where GL_ARB_buffer_storage maps it
+// persistently; elsewhere they are staged in client memory and go up in one glBufferSubData
+// per flush(). Either way a block is bound for a draw with bind(), a glBindBufferRange at
+// its offset, in place of setting its uniforms one by one. Create and destroy with the GL
+// context current.
+class uniform_ring_t {
+
+public:
+
+	uniform_ring_t(size_t frame_size = 1 << 20, size_t frame_count = 3);
+	~uniform_ring_t();
+
+	// waits for the GPU to finish with the region of the frame frame_count frames back; call
+	// before writing the frame's blocks, after the last frame's draws
+	void begin_frame();
+	// returns memory for size bytes of blocks, at the buffer offset set in offset, to be
+	// written before flush(); NULL when the frame's region is full
+	void* allocate(size_t size, GLintptr &offset);
+	// allocate and copy in one; returns -1 when the frame's region is full
+	GLintptr push(const void *data, size_t size);
+	// makes the blocks written since the last flush visible to the draws issued after it
+	void flush();
+
+	void bind(GLuint binding, GLintptr offset, size_t size) const;
+
+	// of a block of size bytes, so consecutive blocks stay bindable
+	size_t aligned_size(size_t size) const { return (size + __alignment - 1) / __alignment * __alignment; }
+	bool is_persistent() const { return __persistent; }
+	GLuint handle() const { return __handle; }
+
+private:
+
+	uniform_ring_t(const uniform_ring_t &);
+	uniform_ring_t& operator=(const uniform_ring_t &);
+
+	GLuint __handle;
+	size_t __frame_size;
+	size_t __alignment;
+	size_t __frame;
+	size_t __head;         // in the frame's region
+	size_t __flushed;
+	bool __started;
+	bool __persistent;
+	unsigned char *__memory; // the mapping, or the staging copy
+	std::vector<unsigned char> __staging;
+	std::vector<gl_fence_t> __fences;
+
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include "vertex_format.hpp"
+
+using namespace std;
+
+struct compact_vertex_t {
+	float position[3];
+	int16_t normal[2];
+	int16_t tangent[2];
+	uint16_t tex_coord[2];
+};
+
+struct quantized_vertex_t {
+	uint16_t position[4]; // w is padding
+	int16_t normal[2];
+	int16_t tangent[2];
+	uint16_t tex_coord[2];
+};
+
+static const vertex_layout_t LAYOUTS[] = {
+	{ VERTEX_FORMAT_FLOAT, "float", sizeof(vertex_t), 4, {
+		{ "vertex_position", 4, GL_FLOAT, GL_FALSE, offsetof(vertex_t, position) },
+		{ "vertex_normal", 3, GL_FLOAT, GL_FALSE, offsetof(vertex_t, normal) },
+		{ "vertex_tex_coord", 2, GL_FLOAT, GL_FALSE, offsetof(vertex_t, tex_coord) },
+		{ "vertex_tangent", 4, GL_FLOAT, GL_FALSE, offsetof(vertex_t, tangent) } } },
+	{ VERTEX_FORMAT_COMPACT, "compact", sizeof(compact_vertex_t), 4, {
+		{ "vertex_position", 3, GL_FLOAT, GL_FALSE, offsetof(compact_vertex_t, position) },
+		{ "vertex_normal", 2, GL_SHORT, GL_TRUE, offsetof(compact_vertex_t, normal) },
+		{ "vertex_tex_coord", 2, GL_HALF_FLOAT_ARB, GL_FALSE, offsetof(compact_vertex_t, tex_coord) },
+		{ "vertex_tangent", 2, GL_SHORT, GL_TRUE, offsetof(compact_vertex_t, tangent) } } },
+	{ VERTEX_FORMAT_QUANTIZED, "quantized", sizeof(quantized_vertex_t), 4, {
+		{ "vertex_position", 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(quantized_vertex_t, position) },
+		{ "vertex_normal", 2, GL_SHORT, GL_TRUE, offsetof(quantized_vertex_t, normal) },
+		{ "vertex_tex_coord", 2, GL_HALF_FLOAT_ARB, GL_FALSE, offsetof(quantized_vertex_t, tex_coord) },
+		{ "vertex_tangent", 2, GL_SHORT, GL_TRUE, offsetof(quantized_vertex_t, tangent) } } }
+};
+
+const vertex_layout_t& vertex_layout_t::of(vertex_format_t format) {
+	return LAYOUTS[format];
+}
+
+bool vertex_layout_t::parse(const char *name, vertex_format_t &format) {
+	for (size_t i = 0; i < sizeof(LAYOUTS) / sizeof(LAYOUTS[0]); i++) {
+		if (strcmp(LAYOUTS[i].name, name) == 0) {
+			format = LAYOUTS[i].format;
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint16_t float_to_half(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent >= 31) // overflow, infinity and nan all become infinity
+		return sign | 0x7c00;
+	if (exponent <= 0) {
+		if (exponent < -10)
+			return sign;
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			half++;
+		return sign | half;
+	}
+
+	uint32_t half = (exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++; // may carry into the exponent, which is still right
+	return sign | half;
+}
+
+static float half_to_float(uint16_t half) {
+	float sign = (half & 0x8000) ? -1.0f : 1.0f;
+	int exponent = (half >> 10) & 0x1f;
+	int mantissa = half & 0x3ff;
+	if (exponent == 0)
+		return sign * ldexpf((float)mantissa, -24);
+	if (exponent == 31)
+		return sign * HUGE_VALF;
+	return sign * ldexpf((float)(mantissa | 0x400), exponent - 25);
+}
+
+static int16_t to_snorm16(float value) {
+	value = min(max(value, -1.0f), 1.0f);
+	return (int16_t)floorf(value * 32767.0f + 0.5f);
+}
+
+static float from_snorm16(int16_t value) {
+	return max(value / 32767.0f, -1.0f);
+}
+
+static inline float sign_not_zero(float value) {
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// unit vector onto the [-1, 1] square of an octahedron unfolded around +z
+static glm::vec2 octahedral_encode(const glm::vec3 &v) {
+	float l1 = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+	if (l1 == 0.0f)
+		return glm::vec2(0.0f);
+	glm::vec2 e(v.x / l1, v.y / l1);
+	if (v.z < 0.0f)
+		e = glm::vec2((1.0f - fabsf(e.y)) * sign_not_zero(e.x), (1.0f - fabsf(e.x)) * sign_not_zero(e.y));
+	return e;
+}
+
+static glm::vec3 octahedral_decode(const glm::vec2 &e) {
+	glm::vec3 v(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+	if (v.z < 0.0f) {
+		float x = v.x;
+		v.x = (1.0f - fabsf(v.y)) * sign_not_zero(x);
+		v.y = (1.0f - fabsf(x)) * sign_not_zero(v.y);
+	}
+	return glm::normalize(v);
+}
+
+// The handedness rides on the sign of the second component, which therefore only
+// holds (y + 1) / 2, kept away from zero so that the sign survives.
+static void encode_tangent(const glm::vec4 &tangent, int16_t *out) {
+	glm::vec2 e = octahedral_encode(glm::vec3(tangent));
+	out[0] = to_snorm16(e.x);
+	int16_t y = max(to_snorm16(0.5f * e.y + 0.5f), (int16_t)1);
+	out[1] = tangent.w < 0.0f ? -y : y;
+}
+
+static glm::vec4 decode_tangent(const int16_t *in) {
+	float y = from_snorm16(in[1]);
+	glm::vec3 t = octahedral_decode(glm::vec2(from_snorm16(in[0]), 2.0f * fabsf(y) - 1.0f));
+	return glm::vec4(t, y < 0.0f ? -1.0f : 1.0f);
+}
+
+template <typename T>
+static void encode_attributes(const vertex_t &vertex, T &out) {
+	glm::vec2 n = octahedral_encode(vertex.normal);
+	out.normal[0] = to_snorm16(n.x);
+	out.normal[1] = to_snorm16(n.y);
+	encode_tangent(vertex.tangent, out.tangent);
+	out.tex_coord[0] = float_to_half(vertex.tex_coord.x);
+	out.tex_coord[1] = float_to_half(vertex.tex_coord.y);
+}
+
+template <typename T>
+static void decode_attributes(const T &in, vertex_t &vertex) {
+	vertex.normal = octahedral_decode(glm::vec2(from_snorm16(in.normal[0]), from_snorm16(in.normal[1])));
+	vertex.tangent = decode_tangent(in.tangent);
+	vertex.tex_coord = glm::vec2(half_to_float(in.tex_coord[0]), half_to_float(in.tex_coord[1]));
+}
+
+void encode_vertices(const vertex_t *vertices, size_t count, vertex_format_t format,
+                     vector<unsigned char> &data, vertex_quantization_t &quantization) {
+	quantization = vertex_quantization_t();
+	data.resize(count * vertex_layout_t::of(format).stride);
+	if (count == 0)
+		return;
+
+	switch (format) {
+	case VERTEX_FORMAT_FLOAT:
+		memcpy(&data[0], vertices, count * sizeof(vertex_t));
+		break;
+
+	case VERTEX_FORMAT_COMPACT: {
+		compact_vertex_t *out = reinterpret_cast<compact_vertex_t *>(&data[0]);
+		for (size_t i = 0; i < count; i++) {
+			out[i].position[0] = vertices[i].position.x;
+			out[i].position[1] = vertices[i].position.y;
+			out[i].position[2] = vertices[i].position.z;
+			encode_attributes(vertices[i], out[i]);
+		}
+		break;
+	}
+
+	case VERTEX_FORMAT_QUANTIZED: {
+		glm::vec3 lower(vertices[0].position), upper(vertices[0].position);
+		for (size_t i = 1; i < count; i++) {
+			lower = glm::min(lower, glm::vec3(vertices[i].position));
+			upper = glm::max(upper, glm::vec3(vertices[i].position));
+		}
+		quantization.offset = lower;
+		quantization.scale = upper - lower;
+
+		quantized_vertex_t *out = reinterpret_cast<quantized_vertex_t *>(&data[0]);
+		for (size_t i = 0; i < count; i++) {
+			for (int c = 0; c < 3; c++) {
+				float extent = quantization.scale[c];
+				float unit = extent > 0.0f ? (vertices[i].position[c] - lower[c]) / extent : 0.0f;
+				out[i].position[c] = (uint16_t)floorf(min(max(unit, 0.0f), 1.0f) * 65535.0f + 0.5f);
+			}
+			out[i].position[3] = 0;
+			encode_attributes(vertices[i], out[i]);
+		}
+		break;
+	}
+	}
+}
+
+void decode_vertex(const unsigned char *data, vertex_format_t format,
+                   const vertex_quantization_t &quantization, vertex_t &vertex) {
+	switch (format) {
+	case VERTEX_FORMAT_FLOAT:
+		memcpy(&vertex, data, sizeof(vertex_t));
+		break;
+
+	case VERTEX_FORMAT_COMPACT: {
+		const compact_vertex_t *in = reinterpret_cast<const compact_vertex_t *>(data);
+		vertex.position = glm::vec4(in->position[0], in->position[1], in->position[2], 1.0f);
+		decode_attributes(*in, vertex);
+		break;
+	}
+
+	case VERTEX_FORMAT_QUANTIZED: {
+		const quantized_vertex_t *in = reinterpret_cast<const quantized_vertex_t *>(data);
+		glm::vec3 unit(in->position[0] / 65535.0f, in->position[1] / 65535.0f, in->position[2] / 65535.0f);
+		vertex.position = glm::vec4(quantization.offset + quantization.scale * unit, 1.0f);
+		decode_attributes(*in, vertex);
+		break;
+	}
+	}
+}
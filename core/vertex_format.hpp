@@ -0,0 +1,56 @@
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#include <vector>
+#include <cstddef>
+#include "gl.hpp"
+#include <glm/glm.hpp>
+
+struct vertex_t {
+	glm::vec4 position;
+	glm::vec3 normal;
+	glm::vec2 tex_coord;
+	glm::vec4 tangent; // w is the handedness: bitangent = w * cross(normal, tangent)
+};
+
+enum vertex_format_t {
+	VERTEX_FORMAT_FLOAT,     // vertex_t as is
+	VERTEX_FORMAT_COMPACT,   // float position, octahedral normal and tangent in 2 shorts each, half float uv
+	VERTEX_FORMAT_QUANTIZED  // as compact, with the position in 16-bit normalized bounding box coordinates
+};
+
+struct vertex_attribute_t {
+	const char *name;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	size_t offset;
+};
+
+// Where each shader attribute lives in one interleaved vertex. The compact formats
+// have to be decoded by the vertex shader: see octahedral_decode in the shaders.
+struct vertex_layout_t {
+	vertex_format_t format;
+	const char *name;
+	GLsizei stride;
+	size_t attribute_count;
+	vertex_attribute_t attributes[4];
+
+	static const vertex_layout_t& of(vertex_format_t format);
+	static bool parse(const char *name, vertex_format_t &format);
+};
+
+// Decoded position = offset + scale * stored position; the identity for the float formats.
+struct vertex_quantization_t {
+	glm::vec3 offset;
+	glm::vec3 scale;
+
+	vertex_quantization_t() : offset(0.0f), scale(1.0f) { }
+};
+
+void encode_vertices(const vertex_t *vertices, size_t count, vertex_format_t format,
+                     std::vector<unsigned char> &data, vertex_quantization_t &quantization);
+void decode_vertex(const unsigned char *data, vertex_format_t format,
+                   const vertex_quantization_t &quantization, vertex_t &vertex);
+
+#endif
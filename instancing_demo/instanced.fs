@@ -0,0 +1,11 @@
+#version 120
+
+uniform vec3 light_direction;
+
+varying vec3 normal;
+varying vec3 color;
+
+void main(void) {
+	float kd = max(dot(normalize(normal), -light_direction), 0.0);
+	gl_FragColor = vec4(color * (0.2 + 0.8 * kd), 1.0);
+}
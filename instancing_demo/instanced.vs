@@ -0,0 +1,40 @@
+#version 120
+
+uniform mat4 projection_matrix;
+uniform mat4 view_matrix;
+uniform vec3 palette[8];
+uniform bool compact_vertex; // set by mesh_t::render, see core/vertex_format.hpp
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+
+attribute vec4 vertex_position;
+attribute vec3 vertex_normal;
+// per instance from an instance_buffer_t, or set once per draw with glVertexAttrib
+attribute mat4 instance_model_matrix;
+attribute float instance_material;
+
+varying vec3 normal;
+varying vec3 color;
+
+vec3 octahedral_decode(vec2 e) {
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(v);
+}
+
+vec3 decode_normal() {
+	return compact_vertex ? octahedral_decode(vertex_normal.xy) : vertex_normal;
+}
+
+vec4 decode_position() {
+	return vec4(position_offset + position_scale * vertex_position.xyz, 1.0);
+}
+
+void main(void) {
+	mat4 model_view_matrix = view_matrix * instance_model_matrix;
+	// the instances are only rotated and uniformly scaled
+	normal = mat3(model_view_matrix) * decode_normal();
+	color = palette[int(instance_material)];
+	gl_Position = projection_matrix * model_view_matrix * decode_position();
+}
@@ -0,0 +1,360 @@
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <sys/time.h>
+
+#include "gl.hpp"
+#include <GL/glfw.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shader.hpp"
+#include "mesh.hpp"
+#include "instance_buffer.hpp"
+#include "geometry_arena.hpp"
+#include "transform_batch.hpp"
+#include "bvh.hpp"
+#include "context.hpp"
+#include "render_state.hpp"
+#include "profiler.hpp"
+
+// A grid of copies of the meshes given, in turn, drawn with one glDrawElementsInstanced per
+// mesh and submesh; with --per-object, one draw per copy the way render_model does it; with
+// --multi-draw, from a geometry_arena_t by one multi_draw_t command per copy. --sweep steps the
+// copies from 1 to 100000 and reports the draws and instances per second of each step.
+// With --cull only the copies a bvh_t finds in the view frustum are drawn; --fovy narrows the
+// view from 30 degrees to leave more of them out.
+
+static const size_t SWEEP_COUNTS[] = { 1, 10, 100, 1000, 10000, 100000 };
+static const size_t MATERIAL_COUNT = 8;
+
+enum draw_mode_t {
+	DRAW_INSTANCED,
+	DRAW_PER_OBJECT,
+	DRAW_MULTI
+};
+
+struct step_t {
+	size_t count;
+	size_t frame;     // the step's first
+	size_t drawn;     // copies drawn over the step's frames, fewer than count each frame when culling
+	double start_time;
+};
+
+shader_program_t instanced_shader;
+draw_mode_t draw_mode = DRAW_INSTANCED;
+std::vector<mesh_t *> meshes;
+std::vector<instance_t> instances;                 // copy i is of mesh i % meshes.size()
+std::vector<instance_buffer_t *> instance_buffers; // of each mesh, or of all copies for DRAW_MULTI
+geometry_arena_t *arena = NULL;
+std::vector<geometry_range_t> ranges;              // of each mesh in the arena
+multi_draw_t *multi_draw = NULL;
+bool culling = false;
+bvh_t bvh;                                         // over the copies' boxes, with culling
+std::vector<size_t> visible;                       // the copies drawn this frame
+glm::mat4 projection_matrix;
+glm::mat4 view_matrix;
+
+static double current_time() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+float mesh_radius(const mesh_t &mesh) {
+	float radius = 0.0f;
+	const vertex_t *vertices = mesh.vertex_data();
+	for (size_t i = 0; i < mesh.vertex_count(); i++)
+		radius = std::max(radius, glm::length(glm::vec3(vertices[i].position)));
+	return radius > 0.0f ? radius : 1.0f;
+}
+
+// the visible copies of each mesh into its instance buffer
+void update_instance_buffers() {
+	std::vector<instance_t> mesh_instances;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		mesh_instances.clear();
+		for (size_t j = 0; j < visible.size(); j++) {
+			if (visible[j] % meshes.size() == i)
+				mesh_instances.push_back(instances[visible[j]]);
+		}
+		instance_buffers[i]->update(mesh_instances.empty() ? NULL : &mesh_instances[0], mesh_instances.size());
+	}
+}
+
+// count copies spread over a 2x2 square around the origin, each turned a little further
+void layout_instances(size_t count, float radius) {
+	size_t side = (size_t)ceil(sqrt((double)count));
+	float spacing = 2.0f / side;
+	float scale = 0.4f * spacing / radius;
+	transform_batch_t transforms;
+	transforms.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		float half_angle = 0.35f * i;
+		glm::vec3 position(-1.0f + spacing * (i % side + 0.5f), 0.0f, -1.0f + spacing * (i / side + 0.5f));
+		transforms.set(i, position, glm::vec3(scale), glm::quat(cos(half_angle), 0.0f, sin(half_angle), 0.0f));
+	}
+	std::vector<glm::mat4> model_matrices(count);
+	compute_transforms(transforms, glm::mat4(1.0f), model_matrices.empty() ? NULL : &model_matrices[0], NULL, NULL);
+
+	instances.resize(count);
+	visible.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		instances[i].model_matrix = model_matrices[i];
+		instances[i].material = i % MATERIAL_COUNT;
+		visible[i] = i;
+	}
+	if (culling) {
+		std::vector<aabb_t> bounds(count);
+		for (size_t i = 0; i < count; i++)
+			bounds[i] = transform_bounds(meshes[i % meshes.size()]->bounds, model_matrices[i]);
+		bvh.build(bounds);
+	}
+	if (draw_mode == DRAW_MULTI)
+		instance_buffers[0]->update(instances.empty() ? NULL : &instances[0], count);
+	else if (draw_mode == DRAW_INSTANCED)
+		update_instance_buffers();
+}
+
+// each frame, and for DRAW_INSTANCED the instance buffers with it
+void cull_instances() {
+	bvh.cull(frustum_t(projection_matrix * view_matrix), visible);
+	if (draw_mode == DRAW_INSTANCED)
+		update_instance_buffers();
+}
+
+void render_instanced() {
+	for (size_t i = 0; i < meshes.size(); i++)
+		meshes[i]->render_instanced(instanced_shader, *instance_buffers[i]);
+}
+
+// the commands are rebuilt every frame, of the copies culling left
+void render_multi_draw() {
+	multi_draw->clear();
+	for (size_t i = 0; i < visible.size(); i++)
+		multi_draw->add(ranges[visible[i] % ranges.size()], visible[i]);
+	multi_draw->draw(*arena, instanced_shader, *instance_buffers[0]);
+}
+
+// the instance attributes stay disabled arrays in the mesh's vertex array, so a
+// glVertexAttrib value feeds every vertex of the draw
+void render_per_object() {
+	GLuint matrix_location = instanced_shader.attribute_location("instance_model_matrix");
+	GLuint material_location = instanced_shader.attribute_location("instance_material");
+	for (size_t i = 0; i < visible.size(); i++) {
+		const instance_t &instance = instances[visible[i]];
+		for (GLuint j = 0; j < 4; j++)
+			glVertexAttrib4fv(matrix_location + j, glm::value_ptr(instance.model_matrix[j]));
+		glVertexAttrib1f(material_location, instance.material);
+		meshes[visible[i] % meshes.size()]->render(instanced_shader);
+	}
+}
+
+size_t draws_per_frame() {
+	if (draw_mode == DRAW_MULTI)
+		return multi_draw->is_indirect() ? (visible.empty() ? 0 : 1) : visible.size();
+	std::vector<size_t> copies(meshes.size(), 0);
+	for (size_t i = 0; i < visible.size(); i++)
+		copies[visible[i] % meshes.size()]++;
+	size_t draws = 0;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		if (draw_mode == DRAW_INSTANCED)
+			copies[i] = copies[i] > 0 ? 1 : 0;
+		draws += copies[i] * meshes[i]->submeshes.size();
+	}
+	return draws;
+}
+
+void report_step(const step_t &step, size_t frame_count, size_t draws_per_frame) {
+	glFinish();
+	double elapsed = current_time() - step.start_time;
+	if (frame_count == 0 || elapsed <= 0.0)
+		return;
+	std::cout << step.count << " instances: " << 1000.0 * elapsed / frame_count << " ms/frame, "
+	          << draws_per_frame * frame_count / elapsed << " draws/s, "
+	          << step.drawn / elapsed << " instances/s" << std::endl;
+	if (culling)
+		std::cout << bvh.stats() << std::endl;
+}
+
+int main(int argc, char **args) {
+	context_t context(640, 480, 16);
+	context.parse_arguments(argc, args);
+	profiler_t profiler;
+	profiler.set_enabled(!context.profile_filepath().empty());
+
+	bool sweep = false;
+	size_t instance_count = 1000;
+	size_t step_frames = 10;
+	float fovy = 30.0f;
+	std::vector<const char *> ctm_filepaths;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(args[i], "--per-object") == 0)
+			draw_mode = DRAW_PER_OBJECT;
+		else if (strcmp(args[i], "--multi-draw") == 0)
+			draw_mode = DRAW_MULTI;
+		else if (strcmp(args[i], "--cull") == 0)
+			culling = true;
+		else if (strcmp(args[i], "--fovy") == 0 && i + 1 < argc)
+			fovy = atof(args[++i]);
+		else if (strcmp(args[i], "--sweep") == 0)
+			sweep = true;
+		else if (strcmp(args[i], "--instances") == 0 && i + 1 < argc)
+			instance_count = atoi(args[++i]);
+		else if (strcmp(args[i], "--step-frames") == 0 && i + 1 < argc)
+			step_frames = std::max(1, atoi(args[++i]));
+		else
+			ctm_filepaths.push_back(args[i]);
+	}
+	if (ctm_filepaths.empty())
+		ctm_filepaths.push_back("../reflection_demo/mesh/teapot.ctm");
+
+	if (!context.open("Instancing")) {
+		exit(EXIT_FAILURE);
+	}
+	if (draw_mode != DRAW_PER_OBJECT && !instancing_supported()) {
+		std::cerr << "*** GL_ARB_instanced_arrays and GL_ARB_draw_instanced are needed for instancing, drawing per object" << std::endl;
+		draw_mode = DRAW_PER_OBJECT;
+	}
+
+	if (!shader_program_t::build(instanced_shader, "instanced.vs", "instanced.fs")) {
+		context.close();
+		exit(EXIT_FAILURE);
+	}
+	float radius = 0.0f;
+	size_t vertex_count = 0, index_count = 0;
+	for (size_t i = 0; i < ctm_filepaths.size(); i++) {
+		meshes.push_back(new mesh_t());
+		if (!mesh_t::read_from_file(ctm_filepaths[i], *meshes.back())) {
+			context.close();
+			exit(EXIT_FAILURE);
+		}
+		radius = std::max(radius, mesh_radius(*meshes.back()));
+		vertex_count += meshes.back()->vertex_count();
+		index_count += meshes.back()->index_count();
+	}
+
+	if (draw_mode == DRAW_MULTI) {
+		arena = new geometry_arena_t(vertex_count, index_count, context.vertex_format());
+		ranges.resize(meshes.size());
+		for (size_t i = 0; i < meshes.size(); i++)
+			arena->add(*meshes[i], ranges[i]);
+		multi_draw = new multi_draw_t();
+		instance_buffers.push_back(new instance_buffer_t());
+	} else {
+		for (size_t i = 0; i < meshes.size(); i++)
+			meshes[i]->load_to_buffers(context.vertex_format());
+		if (draw_mode == DRAW_INSTANCED) {
+			for (size_t i = 0; i < meshes.size(); i++)
+				instance_buffers.push_back(new instance_buffer_t());
+		}
+	}
+
+	std::vector<size_t> counts;
+	if (sweep)
+		counts.assign(SWEEP_COUNTS, SWEEP_COUNTS + sizeof(SWEEP_COUNTS) / sizeof(SWEEP_COUNTS[0]));
+	else
+		counts.push_back(instance_count);
+	if (draw_mode == DRAW_PER_OBJECT)
+		std::cout << "One draw per object and submesh" << std::endl;
+	else if (draw_mode == DRAW_INSTANCED)
+		std::cout << "One instanced draw per mesh and submesh" << std::endl;
+	else
+		std::cout << "One " << (multi_draw->is_indirect() ? "glMultiDrawElementsIndirect" : "instanced draw per object")
+		          << " from a geometry arena of " << vertex_count << " vertices" << std::endl;
+
+	if (culling)
+		std::cout << "Culling to the view frustum" << std::endl;
+
+	projection_matrix = glm::perspective(fovy, (float)context.width() / context.height(), 0.5f, 10.0f);
+	view_matrix = glm::lookAt(glm::vec3(0.0f, 2.2f, 2.6f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::vec3 palette[MATERIAL_COUNT] = {
+		glm::vec3(0.9f, 0.3f, 0.2f), glm::vec3(0.2f, 0.7f, 0.3f), glm::vec3(0.2f, 0.4f, 0.9f), glm::vec3(0.9f, 0.8f, 0.2f),
+		glm::vec3(0.7f, 0.3f, 0.8f), glm::vec3(0.2f, 0.8f, 0.8f), glm::vec3(0.9f, 0.6f, 0.3f), glm::vec3(0.8f, 0.8f, 0.8f)
+	};
+
+	RENDER_STATE.invalidate();
+	RENDER_STATE.set_capability(GL_DEPTH_TEST, true);
+	RENDER_STATE.set_capability(GL_CULL_FACE, true);
+	RENDER_STATE.cull_face(GL_BACK);
+	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+	instanced_shader.bind();
+	instanced_shader.set_uniform_value("projection_matrix", projection_matrix);
+	instanced_shader.set_uniform_value("view_matrix", view_matrix);
+	instanced_shader.set_uniform_value("light_direction", glm::normalize(glm::vec3(view_matrix * glm::vec4(-0.3f, -1.0f, -0.5f, 0.0f))));
+	glUniform3fv(instanced_shader.uniform_location("palette[0]"), MATERIAL_COUNT, glm::value_ptr(palette[0]));
+
+	size_t step_index = 0;
+	size_t frame = 0;
+	step_t step;
+	step.count = counts[0];
+	step.frame = 0;
+	step.drawn = 0;
+	layout_instances(step.count, radius);
+	glFinish();
+	step.start_time = current_time();
+
+	while (context.is_running()) {
+		profiler.begin_frame();
+		glViewport(0, 0, context.width(), context.height());
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (culling) {
+			PROFILE_SCOPE(profiler, "cull");
+			cull_instances();
+		}
+		{
+			PROFILE_GPU_SCOPE(profiler, "draw");
+			instanced_shader.bind();
+			if (draw_mode == DRAW_PER_OBJECT)
+				render_per_object();
+			else if (draw_mode == DRAW_INSTANCED)
+				render_instanced();
+			else
+				render_multi_draw();
+		}
+		step.drawn += visible.size();
+		{
+			PROFILE_SCOPE(profiler, "swap buffers");
+			context.swap_buffers();
+		}
+		profiler.end_frame();
+		frame++;
+
+		// the last step keeps drawing until the demo is closed
+		if (frame - step.frame == step_frames && step_index < counts.size()) {
+			report_step(step, step_frames, draws_per_frame());
+			if (++step_index < counts.size()) {
+				step.count = counts[step_index];
+				layout_instances(step.count, radius);
+			}
+			step.frame = frame;
+			step.drawn = 0;
+			glFinish();
+			step.start_time = current_time();
+		}
+	}
+
+	if (profiler.is_enabled()) {
+		profiler.write_trace(context.profile_filepath().c_str());
+		profiler.report(std::cout);
+		std::cout << RENDER_STATE.counters() << std::endl;
+		if (culling)
+			std::cout << bvh.stats() << std::endl;
+	}
+	profiler.delete_queries();
+	for (size_t i = 0; i < instance_buffers.size(); i++)
+		delete instance_buffers[i];
+	delete multi_draw;
+	delete arena;
+	for (size_t i = 0; i < meshes.size(); i++)
+		delete meshes[i];
+
+	context.close();
+
+	return 0;
+}
@@ -20,7 +20,9 @@ void main(void) {
 	float offset = height * scale_bias.r + scale_bias.g;
 	vec2 tex_coord_parallax = tex_coord + offset*e.xy;
 	
-	vec3 n = 2.0 * texture2D(texture2, tex_coord_parallax).rgb - 1.0;
+	// z is rebuilt from x and y, so two channel (BC5) normal maps work as well
+	vec2 n_xy = 2.0 * texture2D(texture2, tex_coord_parallax).rg - 1.0;
+	vec3 n = vec3(n_xy, sqrt(max(1.0 - dot(n_xy, n_xy), 0.0)));
 	vec3 h = normalize(l + e);
 	
 	float kd = clamp(dot(l, n), 0.0, 1.0);
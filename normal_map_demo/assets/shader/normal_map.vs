@@ -3,18 +3,44 @@
 uniform mat4 projection_matrix;
 uniform mat4 model_view_matrix;
 uniform mat3 normal_matrix;
+uniform bool compact_vertex; // set by mesh_t::render, see core/vertex_format.hpp
+uniform vec3 position_offset;
+uniform vec3 position_scale;
 uniform float texcoord_scale;
 uniform vec4 light_position; // in eye space
 
 attribute vec4 vertex_position;
 attribute vec3 vertex_normal;
 attribute vec2 vertex_tex_coord;
-attribute vec3 vertex_tangent;
+attribute vec4 vertex_tangent;
 
 varying vec2 tex_coord;
 varying vec3 light_dir;
 varying vec3 eye_dir;
 
+vec3 octahedral_decode(vec2 e) {
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(v);
+}
+
+vec3 decode_normal() {
+	return compact_vertex ? octahedral_decode(vertex_normal.xy) : vertex_normal;
+}
+
+vec4 decode_position() {
+	return vec4(position_offset + position_scale * vertex_position.xyz, 1.0);
+}
+
+// the handedness is the sign of y, which holds (y + 1) / 2
+vec4 decode_tangent() {
+	if (!compact_vertex)
+		return vertex_tangent;
+	vec2 e = vec2(vertex_tangent.x, 2.0 * abs(vertex_tangent.y) - 1.0);
+	return vec4(octahedral_decode(e), vertex_tangent.y < 0.0 ? -1.0 : 1.0);
+}
+
 
 mat3 tangent_matrix(vec3 t, vec3 b, vec3 n) {
 	return mat3(
@@ -25,11 +51,12 @@ mat3 tangent_matrix(vec3 t, vec3 b, vec3 n) {
 }
 
 void main(void) {
-	vec4 position = model_view_matrix * vertex_position;
+	vec4 position = model_view_matrix * decode_position();
+	vec4 tangent = decode_tangent();
 	
-	vec3 n = normalize(normal_matrix * vertex_normal);
-	vec3 t = normalize(normal_matrix * vertex_tangent);
-	vec3 b = cross(n, t);
+	vec3 n = normalize(normal_matrix * decode_normal());
+	vec3 t = normalize(normal_matrix * tangent.xyz);
+	vec3 b = tangent.w * cross(n, t);
 
 	mat3 m = tangent_matrix(t, b, n);
 	light_dir = normalize(m * (light_position.xyz - position.xyz));
@@ -6,9 +6,10 @@
 #include <cassert>
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <cmath>
 
-#include <OpenGL/gl.h>
-#include <OpenGL/glext.h>
+#include "gl.hpp"
 #include <GL/glfw.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -17,28 +18,30 @@
 #include <glm/gtx/string_cast.hpp>
 #include <openctmpp.h>
 
-#define PNG_DEBUG 3
-#include <png.h>
-
 #include "shader.hpp"
 #include "mesh.hpp"
 #include "fbo.hpp"
 #include "texture.hpp"
 #include "trackball.hpp"
+#include "context.hpp"
+#include "job_queue.hpp"
+#include "texture_uploader.hpp"
+#include "texture_manager.hpp"
+#include "render_state.hpp"
+#include "scene_graph.hpp"
+#include "profiler.hpp"
 
-struct image_t {
-	GLenum format;
-	size_t width;
-	size_t height;
-	size_t byte_depth;
-	unsigned char *data;
+struct model_t {
+	mesh_t *mesh;
+	scene_graph_t::node_t node;
 };
 
-struct model_t {
+struct mesh_job_t {
+	model_t *model;
+	const char *filepath;
+	vertex_format_t vertex_format;
 	mesh_t *mesh;
-	glm::vec3 position;
-	glm::vec3 scale;
-	glm::quat orientation;
+	bool decoded;
 };
 
 struct camera_t {
@@ -48,16 +51,25 @@ struct camera_t {
 	
 	glm::mat4 projection_matrix;
 	glm::mat4 view_inverse_matrix;
+	glm::mat3 view_normal_matrix; // the inverse transpose of view_inverse_matrix's upper 3x3
 };
  
 glm::vec4 light_position;
 glm::vec2 parallax_scale_bias;
 
+scene_graph_t scene;
 model_t teapot;
 model_t board;
 shader_program_t normal_map_shader;
 frame_buffer_t *fbo;
 
+job_queue_t *jobs;
+texture_uploader_t *texture_uploader;
+texture_manager_t *textures;
+const double UPLOAD_BUDGET_SECONDS = 0.004; // of each frame, for finished assets
+const size_t TEXTURE_BUDGET_BYTES = 64 << 20;
+const float TEXCOORD_SCALE = 2.0f; // times the images repeat across the board
+
 glm::ivec2 viewport;
 camera_t camera;
 
@@ -69,109 +81,11 @@ texture_t depth_texture;
 
 trackball_t trackball(200.0f);
 
+profiler_t profiler;
+
 bool camera_zoom = false;
 bool parallax_mapping_enabled = true;
 
-void log(const char *format, ...) {
-  va_list args;
-  va_start(args, format);
-  std::vfprintf(stderr, format, args);
-  std::fprintf(stderr, "\n");
-  va_end(args);
-}
-
-// ref: http://zarb.org/~gc/html/libpng.html
-bool read_image_from_png_file(const char *filepath, image_t &image) {
-  FILE *fp = fopen(filepath, "rb");
-  if (!fp) {
-    log("[read_png_file] File %s could not be opened for reading", filepath);
-		return false;
-	}
-
-  unsigned char header[8]; 
-  fread(header, 1, 8, fp);
-  if (png_sig_cmp(header, 0, 8)) {
-    log("[read_png_file] File %s is not recognized as a PNG file", filepath);
-		return false;
-	}
-
-  png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-  if (!png_ptr) {
-    log("[read_png_file] png_create_read_struct failed");
-		return false;
-	}
-
-  png_infop info_ptr = png_create_info_struct(png_ptr);
-  if (!info_ptr) {
-    log("[read_png_file] png_create_info_struct failed");
-		return false;
-	}
-
-  if (setjmp(png_jmpbuf(png_ptr))) {
-    log("[read_png_file] Error during init_io");
-		return false;
-	}
-
-  png_init_io(png_ptr, fp);
-  png_set_sig_bytes(png_ptr, 8);
-
-  png_read_info(png_ptr, info_ptr);
-
-  int width = png_get_image_width(png_ptr, info_ptr);
-  int height = png_get_image_height(png_ptr, info_ptr);
-  png_byte color_type = png_get_color_type(png_ptr, info_ptr);
-  png_byte bit_depth = png_get_bit_depth(png_ptr, info_ptr);
-
-  png_set_interlace_handling(png_ptr);
-  png_read_update_info(png_ptr, info_ptr);
-
-  if (setjmp(png_jmpbuf(png_ptr))) {
-    log("[read_png_file] Error during read_image");
-		return false;
-	}
-
-	png_byte byte_depth = png_get_channels(png_ptr, info_ptr);
-	if (bit_depth == 16)
-		byte_depth *= 2;
-
-	png_byte *buf = new png_byte[width * height * byte_depth];
-
-	int offset = 0;
-  for (int y = 0; y < height; y++) {
-		png_read_row(png_ptr, buf + offset, NULL);
-		offset += width * byte_depth;
-	}
-
-	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-	
-  fclose(fp);
-
-	image.width = width;
-	image.height = height;
-	image.byte_depth = byte_depth;
-	image.data = (unsigned char *)buf;
-
-  switch (color_type) {
-  case PNG_COLOR_TYPE_GRAY:
-		image.format = GL_LUMINANCE;
-    break;
-  case PNG_COLOR_TYPE_RGB:
-		image.format = GL_RGB;
-    break;
-  case PNG_COLOR_TYPE_RGBA:
-		image.format = GL_RGBA;
-    break;
-  case PNG_COLOR_TYPE_GA:
-		image.format = GL_LUMINANCE_ALPHA;
-    break;
-  default:
-    log("Non-support color type");
-		return false;
-  }
-
-	return true;
-}
-
 bool build_color_texture(texture_t &texture, size_t width, size_t height) {
 	GLuint texture_handle;
 	
@@ -209,34 +123,41 @@ bool build_depth_texture(texture_t &texture, size_t width, size_t height) {
 	return true;
 }
 
-bool build_image_texutre(texture_t &texture, const char *filepath) {
-	image_t image;
-	if (! read_image_from_png_file(filepath, image) )
-		return false;
-
-	GLuint texture_handle;
-	glGenTextures(1, &texture_handle);
-	glBindTexture(GL_TEXTURE_2D, texture_handle);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid *)image.data);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glBindTexture(GL_TEXTURE_2D, 0);
+// runs on a worker thread
+void decode_mesh(void *context) {
+	mesh_job_t *job = static_cast<mesh_job_t *>(context);
+	job->decoded = mesh_t::read_from_file(job->filepath, *(job->mesh));
+}
 
-	texture.handle = texture_handle;
-	texture.target = GL_TEXTURE_2D;
+void upload_mesh(void *context) {
+	mesh_job_t *job = static_cast<mesh_job_t *>(context);
+	if (job->decoded) {
+		job->mesh->load_to_buffers(job->vertex_format);
+		job->model->mesh = job->mesh;
+	} else {
+		delete job->mesh;
+	}
+	delete job;
+}
 
-	return true;
+// the model is not drawn until its mesh is uploaded
+void load_model_mesh(model_t &model, const char *filepath, vertex_format_t vertex_format) {
+	model.mesh = NULL;
+	mesh_job_t *job = new mesh_job_t();
+	job->model = &model;
+	job->filepath = filepath;
+	job->vertex_format = vertex_format;
+	job->mesh = new mesh_t();
+	jobs->push(decode_mesh, upload_mesh, job);
 }
 
 void debug_draw_texture(GLuint texture_handle) {
-	glEnable(GL_TEXTURE_2D);
+	RENDER_STATE.set_capability(GL_TEXTURE_2D, true);
 	glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
-  glBindTexture(GL_TEXTURE_2D, texture_handle);
+  RENDER_STATE.bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture_handle);
   glBegin(GL_TRIANGLE_FAN);
   glTexCoord2d(0.0, 0.0);
   glVertex2d(-1.0, -1.0);
@@ -247,21 +168,14 @@ void debug_draw_texture(GLuint texture_handle) {
   glTexCoord2d(0.0, 1.0);
   glVertex2d(-1.0,  1.0);
   glEnd();
-  glBindTexture(GL_TEXTURE_2D, 0);	
 }
 
-void model_setup() {
-	teapot.mesh = new mesh_t();
-	mesh_t::read_from_file("assets/mesh/teapot.ctm", *(teapot.mesh));
-	teapot.mesh->load_to_buffers();
-	teapot.position.y = 0.5f;
-	teapot.scale.x = teapot.scale.y = teapot.scale.z = 1.0f;
+void model_setup(vertex_format_t vertex_format) {
+	load_model_mesh(teapot, "assets/mesh/teapot.ctm", vertex_format);
+	teapot.node = scene.add(scene_graph_t::NO_PARENT, glm::vec3(0.0f, 0.5f, 0.0f));
 	
-	board.mesh = new mesh_t();
-	mesh_t::read_from_file("assets/mesh/quad.ctm", *(board.mesh));
-	board.mesh->load_to_buffers();
-	board.scale.x = board.scale.z = 1.5f;
-	board.scale.y = 1.0f;
+	load_model_mesh(board, "assets/mesh/quad.ctm", vertex_format);
+	board.node = scene.add(scene_graph_t::NO_PARENT, glm::vec3(0.0f), glm::vec3(1.5f, 1.0f, 1.5f));
 }
 
 void camera_setup() {	
@@ -277,7 +191,7 @@ void shader_setup() {
 	
 	shader_program_t::build(normal_map_shader, "assets/shader/normal_map.vs", "assets/shader/normal_map.fs");	
 	normal_map_shader.bind();
-	normal_map_shader.set_uniform_value("texcoord_scale", 2.0f);
+	normal_map_shader.set_uniform_value("texcoord_scale", TEXCOORD_SCALE);
 	normal_map_shader.set_uniform_value("texture1", 1);
 	normal_map_shader.set_uniform_value("texture2", 2);
 	normal_map_shader.set_uniform_value("texture3", 3);
@@ -287,9 +201,11 @@ void shader_setup() {
 }
 
 void texture_setup() {	
-	build_image_texutre(image_texture, "assets/image/polkadots.png");
-	build_image_texutre(normal_texture, "assets/image/polkadots_normal.png");
-	build_image_texutre(height_texture, "assets/image/polkadots_height.png");
+	// a .dds file cooked from a PNG by tools/texture_cooker ("make textures") is loaded instead when present
+	textures = new texture_manager_t(*jobs, *texture_uploader, TEXTURE_BUDGET_BYTES);
+	textures->load(image_texture, "assets/image/polkadots.png", MIP_CONTENT_COLOR);
+	textures->load(normal_texture, "assets/image/polkadots_normal.png", MIP_CONTENT_NORMAL);
+	textures->load(height_texture, "assets/image/polkadots_height.png", MIP_CONTENT_LINEAR);
 	
 	build_color_texture(color_texture, viewport.x, viewport.y);
 	build_depth_texture(depth_texture, viewport.x, viewport.y);
@@ -301,28 +217,27 @@ void texture_setup() {
 	texture_unit_t::attach(3, &height_texture);
 }
 
-void frame_buffer_setup() {
+bool frame_buffer_setup() {
 	fbo = new frame_buffer_t(viewport.x, viewport.y);
 	fbo->bind();
 	fbo->attach_texture(GL_COLOR_ATTACHMENT0_EXT, color_texture);
 	fbo->attach_render_buffer(GL_DEPTH_ATTACHMENT_EXT, GL_DEPTH_COMPONENT);
 	GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0_EXT };
-	fbo->select_color_buffers(draw_buffers);
+	fbo->select_color_buffers(draw_buffers, 1);
 	if (! fbo->is_valid()) {
-	  glfwTerminate();
-    exit(EXIT_FAILURE);		
+		std::cerr << "*** Frame buffer incomplete" << std::endl;
+		return false;
 	}
-	fbo->release();	
+	fbo->release();
+	return true;
 }
 
 void render_model(const model_t &model, const camera_t &camera, const shader_program_t &shader_program) {
-	glm::mat4 rotation_matrix = glm::mat4_cast(model.orientation);
-	glm::mat4 scale_matrix = glm::scale(glm::mat4(1.0), model.scale);
-	glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0), model.position); 
-	
-	glm::mat4 model_matrix = translation_matrix * scale_matrix * rotation_matrix;
-	glm::mat4 model_view_matrix = camera.view_inverse_matrix * model_matrix; 
-	glm::mat3 normal_matrix = glm::mat3(glm::transpose(glm::inverse(model_view_matrix)));
+	if (model.mesh == NULL)
+		return;
+
+	glm::mat4 model_view_matrix = camera.view_inverse_matrix * scene.world_matrix(model.node);
+	glm::mat3 normal_matrix = camera.view_normal_matrix * scene.world_normal_matrix(model.node);
 	
 	shader_program.set_uniform_value("projection_matrix", camera.projection_matrix);
 	shader_program.set_uniform_value("model_view_matrix", model_view_matrix);	
@@ -331,28 +246,58 @@ void render_model(const model_t &model, const camera_t &camera, const shader_pro
 	model.mesh->render(shader_program);
 }
 
-void setup() {
-	model_setup();	
+bool setup(vertex_format_t vertex_format) {
+	jobs = new job_queue_t();
+	texture_uploader = new texture_uploader_t();
+	model_setup(vertex_format);	
 	camera_setup();
 	texture_setup();
-	frame_buffer_setup();
+	if (!frame_buffer_setup())
+		return false;
 	shader_setup();
 	
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);	
-	glCullFace(GL_BACK);	
+	RENDER_STATE.invalidate(); // the setup above binds with plain GL
+	RENDER_STATE.set_capability(GL_DEPTH_TEST, true);
+	RENDER_STATE.set_capability(GL_CULL_FACE, true);
+	RENDER_STATE.cull_face(GL_BACK);
+	return true;
 }
 
+// the queued jobs point into the models and textures, and free themselves once uploaded
 void cleanup() {
-	
+	jobs->finish();
+	delete jobs;
+	delete textures;
+	delete texture_uploader;
+	delete teapot.mesh;
+	delete board.mesh;
+}
+
+// about how many pixels the model spans on screen, from a bounding sphere of its scale
+float projected_size(const model_t &model, const camera_t &camera) {
+	const glm::mat4 &world_matrix = scene.world_matrix(model.node);
+	glm::vec4 center = camera.view_inverse_matrix * world_matrix[3];
+	float radius = std::max(glm::length(world_matrix[0]), std::max(glm::length(world_matrix[1]), glm::length(world_matrix[2])));
+	float distance = std::max(-center.z - radius, 1.0f);
+	return viewport.y * radius / (distance * tanf(0.5f * glm::radians(camera.fovy)));
 }
 
 void update() {
+	scene.update();
 	camera.projection_matrix = glm::perspective(camera.fovy, camera.aspect_ratio, 1.0f, 30.0f);
 	camera.view_inverse_matrix = glm::lookAt(glm::vec3(0.0f, 1.5f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::mat4_cast(camera.orientation);	
+	camera.view_normal_matrix = glm::transpose(glm::inverse(glm::mat3(camera.view_inverse_matrix)));
+
+	float board_texture_size = projected_size(board, camera) / TEXCOORD_SCALE;
+	textures->request(image_texture, board_texture_size);
+	textures->request(normal_texture, board_texture_size);
+	textures->request(height_texture, board_texture_size);
+	textures->update();
 }
 
 void render() {
+	PROFILE_GPU_SCOPE(profiler, "normal map pass");
+
 	for (size_t i = 0; i < TEXTURE_UNITS.size(); i++) {
 		TEXTURE_UNITS[i].activate();
 	}
@@ -417,6 +362,11 @@ void keyboard(int key, int action) {
 		if (key == GLFW_KEY_SPACE) {
 			parallax_mapping_enabled = !parallax_mapping_enabled;
 		}
+		if (key == 'T') {
+			std::cout << textures->stats() << std::endl;
+			std::cout << RENDER_STATE.counters() << std::endl;
+			std::cout << scene.stats() << std::endl;
+		}
     break;
   case GLFW_RELEASE:
 		if (key == GLFW_KEY_LSHIFT) {
@@ -435,39 +385,59 @@ void resize(int width, int height) {
 
 int main(int argc, char **args)
 {
-  if (!glfwInit()) {
-		log("Failed to initialize GLFW");
-    exit(EXIT_FAILURE);
-  }
-
-  int depth_bits = 16;
-  if (!glfwOpenWindow(640, 480, 0, 0, 0, 0, depth_bits, 0, GLFW_WINDOW)) {
-		log("Failed to open GLFW window");
-    glfwTerminate();
+	context_t context(640, 480, 16);
+	context.parse_arguments(argc, args);
+	profiler.set_enabled(!context.profile_filepath().empty());
+	if (!context.open("Teapot")) {
     exit(EXIT_FAILURE);
   }
-  glfwSetWindowTitle("Teapot");
-  glfwEnable(GLFW_STICKY_KEYS);
-  glfwSwapInterval(1);
-
-	glfwSetKeyCallback(keyboard);
-  glfwSetMouseButtonCallback(mouse_button);
-  glfwSetMousePosCallback(mouse_motion);
-	glfwSetWindowSizeCallback(resize);
 
-	setup();
+	if (context.is_headless()) {
+		resize(context.width(), context.height());
+	} else {
+		glfwSetKeyCallback(keyboard);
+	  glfwSetMouseButtonCallback(mouse_button);
+	  glfwSetMousePosCallback(mouse_motion);
+		glfwSetWindowSizeCallback(resize);
+	}
 
-  do {
-		update();
-		render();						
-    glfwSwapBuffers();
+	if (!setup(context.vertex_format())) {
+		cleanup();
+		context.close();
+		exit(EXIT_FAILURE);
+	}
+	if (context.is_headless())
+		jobs->finish(); // snapshots and profiles of a fixed frame count should see every asset
+
+  while (context.is_running()) {
+		profiler.begin_frame();
+		{
+			PROFILE_SCOPE(profiler, "uploads");
+			jobs->process_uploads(UPLOAD_BUDGET_SECONDS);
+		}
+		{
+			PROFILE_SCOPE(profiler, "update");
+			update();
+		}
+		render();
+		{
+			PROFILE_SCOPE(profiler, "swap buffers");
+	    context.swap_buffers();
+		}
+		profiler.end_frame();
   }
-  while (glfwGetKey(GLFW_KEY_ESC) != GLFW_PRESS && glfwGetWindowParam(GLFW_OPENED));
+
+	if (profiler.is_enabled()) {
+		profiler.write_trace(context.profile_filepath().c_str());
+		profiler.report(std::cout);
+		std::cout << textures->stats() << std::endl;
+		std::cout << RENDER_STATE.counters() << std::endl;
+	}
+	profiler.delete_queries();
 
 	cleanup();
 
-  glfwTerminate();
+  context.close();
 
   return 0;
 }
-
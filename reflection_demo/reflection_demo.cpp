@@ -7,8 +7,7 @@
 #include <fstream>
 #include <string>
 
-#include <OpenGL/gl.h>
-#include <OpenGL/glext.h>
+#include "gl.hpp"
 #include <GL/glfw.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -17,29 +16,37 @@
 #include <glm/gtx/string_cast.hpp>
 #include <openctmpp.h>
 
-#define PNG_DEBUG 3
-#include <png.h>
-
 #include "shader.hpp"
 #include "mesh.hpp"
 #include "fbo.hpp"
 #include "texture.hpp"
 #include "trackball.hpp"
+#include "context.hpp"
+#include "job_queue.hpp"
+#include "texture_uploader.hpp"
+#include "image_loader.hpp"
+#include "render_state.hpp"
+#include "scene_graph.hpp"
 
 
-struct image_t {
-	GLenum format;
-	size_t width;
-	size_t height;
-	size_t byte_depth;
-	unsigned char *data;
+struct model_t {
+	mesh_t *mesh;
+	scene_graph_t::node_t node;
 };
 
-struct model_t {
+struct mesh_job_t {
+	model_t *model;
+	const char *filepath;
+	vertex_format_t vertex_format;
 	mesh_t *mesh;
-	glm::vec3 position;
-	glm::vec3 scale;
-	glm::quat orientation;
+	bool decoded;
+};
+
+struct image_job_t {
+	texture_t *texture;
+	const char *filepath;
+	image_t image;
+	bool decoded;
 };
 
 struct camera_t {
@@ -48,37 +55,34 @@ struct camera_t {
 	
 	glm::mat4 projection_matrix;
 	glm::mat4 view_inverse_matrix;
+	glm::mat3 view_normal_matrix; // the inverse transpose of view_inverse_matrix's upper 3x3
 };
  
 glm::vec3 light_direction;
 
+scene_graph_t scene;
 model_t teapot;
 model_t board;
 shader_program_t diffuse_shader;
 shader_program_t reflection_shader;
 frame_buffer_t *fbo;
 
+job_queue_t *jobs;
+texture_uploader_t *texture_uploader;
+image_pool_t image_pool;
+const double UPLOAD_BUDGET_SECONDS = 0.004; // of each frame, for finished assets
+
 glm::ivec2 viewport;
 camera_t cameras[2];
 
 texture_t image_texture;
 texture_t color_texture;
 texture_t depth_texture;
-texture_unit_t texture_unit_0 = { GL_TEXTURE0, 0, &color_texture };
-texture_unit_t texture_unit_1 = { GL_TEXTURE1, 1, &image_texture };
 
 trackball_t trackball(200.0f);
 bool camera_zoom = false;
 
 
-void log(const char *format, ...) {
-  va_list args;
-  va_start(args, format);
-  std::vfprintf(stderr, format, args);
-  std::fprintf(stderr, "\n");
-  va_end(args);
-}
-
 glm::mat4 mirror_matrix(const glm::vec3 &n, float d) {
 	glm::vec4 P = glm::vec4(n, d);
 	return glm::mat4(
@@ -89,98 +93,6 @@ glm::mat4 mirror_matrix(const glm::vec3 &n, float d) {
 			);	
 }
 
-// ref: http://zarb.org/~gc/html/libpng.html
-bool read_image_from_png_file(const char *filepath, image_t &image) {
-  FILE *fp = fopen(filepath, "rb");
-  if (!fp) {
-    log("[read_png_file] File %s could not be opened for reading", filepath);
-		return false;
-	}
-
-  unsigned char header[8]; 
-  fread(header, 1, 8, fp);
-  if (png_sig_cmp(header, 0, 8)) {
-    log("[read_png_file] File %s is not recognized as a PNG file", filepath);
-		return false;
-	}
-
-  png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-  if (!png_ptr) {
-    log("[read_png_file] png_create_read_struct failed");
-		return false;
-	}
-
-  png_infop info_ptr = png_create_info_struct(png_ptr);
-  if (!info_ptr) {
-    log("[read_png_file] png_create_info_struct failed");
-		return false;
-	}
-
-  if (setjmp(png_jmpbuf(png_ptr))) {
-    log("[read_png_file] Error during init_io");
-		return false;
-	}
-
-  png_init_io(png_ptr, fp);
-  png_set_sig_bytes(png_ptr, 8);
-
-  png_read_info(png_ptr, info_ptr);
-
-  int width = png_get_image_width(png_ptr, info_ptr);
-  int height = png_get_image_height(png_ptr, info_ptr);
-  png_byte color_type = png_get_color_type(png_ptr, info_ptr);
-  png_byte bit_depth = png_get_bit_depth(png_ptr, info_ptr);
-
-  png_set_interlace_handling(png_ptr);
-  png_read_update_info(png_ptr, info_ptr);
-
-  if (setjmp(png_jmpbuf(png_ptr))) {
-    log("[read_png_file] Error during read_image");
-		return false;
-	}
-
-	png_byte byte_depth = png_get_channels(png_ptr, info_ptr);
-	if (bit_depth == 16)
-		byte_depth *= 2;
-
-	png_byte *buf = new png_byte[width * height * byte_depth];
-
-	int offset = 0;
-  for (int y = 0; y < height; y++) {
-		png_read_row(png_ptr, buf + offset, NULL);
-		offset += width * byte_depth;
-	}
-
-	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-	
-  fclose(fp);
-
-	image.width = width;
-	image.height = height;
-	image.byte_depth = byte_depth;
-	image.data = (unsigned char *)buf;
-
-  switch (color_type) {
-  case PNG_COLOR_TYPE_GRAY:
-		image.format = GL_LUMINANCE;
-    break;
-  case PNG_COLOR_TYPE_RGB:
-		image.format = GL_RGB;
-    break;
-  case PNG_COLOR_TYPE_RGBA:
-		image.format = GL_RGBA;
-    break;
-  case PNG_COLOR_TYPE_GA:
-		image.format = GL_LUMINANCE_ALPHA;
-    break;
-  default:
-    log("Non-support color type");
-		return false;
-  }
-
-	return true;
-}
-
 bool build_color_texture(texture_t &texture, size_t width, size_t height) {
 	GLuint texture_handle;
 	
@@ -218,20 +130,15 @@ bool build_depth_texture(texture_t &texture, size_t width, size_t height) {
 	return true;
 }
 
-bool build_image_texutre(texture_t &texture, const char *filepath) {
-	image_t image;
-	if (! read_image_from_png_file(filepath, image) )
-		return false;
-
+bool build_image_texutre(texture_t &texture, const image_t &image) {
 	GLuint texture_handle;
 	glGenTextures(1, &texture_handle);
-	glBindTexture(GL_TEXTURE_2D, texture_handle);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid *)image.data);
+	RENDER_STATE.bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture_handle);
+	texture_uploader->upload(GL_TEXTURE_2D, 0, image.format, image.width, image.height, image.format, image.type, image.data, image.size());
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glBindTexture(GL_TEXTURE_2D, 0);
 
 	texture.handle = texture_handle;
 	texture.target = GL_TEXTURE_2D;
@@ -239,12 +146,65 @@ bool build_image_texutre(texture_t &texture, const char *filepath) {
 	return true;
 }
 
+// runs on a worker thread
+void decode_mesh(void *context) {
+	mesh_job_t *job = static_cast<mesh_job_t *>(context);
+	job->decoded = mesh_t::read_from_file(job->filepath, *(job->mesh));
+}
+
+void upload_mesh(void *context) {
+	mesh_job_t *job = static_cast<mesh_job_t *>(context);
+	if (job->decoded) {
+		job->mesh->load_to_buffers(job->vertex_format);
+		job->model->mesh = job->mesh;
+	} else {
+		delete job->mesh;
+	}
+	delete job;
+}
+
+// runs on a worker thread
+void decode_image(void *context) {
+	image_job_t *job = static_cast<image_job_t *>(context);
+	job->decoded = read_image_from_png_file(job->filepath, job->image, &image_pool);
+}
+
+void upload_image(void *context) {
+	image_job_t *job = static_cast<image_job_t *>(context);
+	if (job->decoded) {
+		build_image_texutre(*(job->texture), job->image);
+		release_image(job->image);
+	}
+	delete job;
+}
+
+// the model is not drawn until its mesh is uploaded
+void load_model_mesh(model_t &model, const char *filepath, vertex_format_t vertex_format) {
+	model.mesh = NULL;
+	mesh_job_t *job = new mesh_job_t();
+	job->model = &model;
+	job->filepath = filepath;
+	job->vertex_format = vertex_format;
+	job->mesh = new mesh_t();
+	jobs->push(decode_mesh, upload_mesh, job);
+}
+
+// the texture stays unbound (handle 0) until its image is uploaded
+void load_image_texture(texture_t &texture, const char *filepath) {
+	texture.target = GL_TEXTURE_2D;
+	texture.handle = 0;
+	image_job_t *job = new image_job_t();
+	job->texture = &texture;
+	job->filepath = filepath;
+	jobs->push(decode_image, upload_image, job);
+}
+
 void debug_draw_texture(GLuint texture_handle) {
 	glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
-  glBindTexture(GL_TEXTURE_2D, texture_handle);
+  RENDER_STATE.bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture_handle);
   glBegin(GL_TRIANGLE_FAN);
   glTexCoord2d(0.0, 0.0);
   glVertex2d(-1.0, -1.0);
@@ -255,21 +215,14 @@ void debug_draw_texture(GLuint texture_handle) {
   glTexCoord2d(0.0, 1.0);
   glVertex2d(-1.0,  1.0);
   glEnd();
-  glBindTexture(GL_TEXTURE_2D, 0);	
 }
 
-void setup_models() {
-	teapot.mesh = new mesh_t();
-	mesh_t::read_from_file("mesh/teapot.ctm", *(teapot.mesh));
-	teapot.mesh->load_to_buffers();
-	teapot.position.y = 0.5f;
-	teapot.scale.x = teapot.scale.y = teapot.scale.z = 1.0f;
+void setup_models(vertex_format_t vertex_format) {
+	load_model_mesh(teapot, "mesh/teapot.ctm", vertex_format);
+	teapot.node = scene.add(scene_graph_t::NO_PARENT, glm::vec3(0.0f, 0.5f, 0.0f));
 	
-	board.mesh = new mesh_t();
-	mesh_t::read_from_file("mesh/quad.ctm", *(board.mesh));
-	board.mesh->load_to_buffers();
-	board.scale.x = board.scale.z = 1.5f;
-	board.scale.y = 1.0f;
+	load_model_mesh(board, "mesh/quad.ctm", vertex_format);
+	board.node = scene.add(scene_graph_t::NO_PARENT, glm::vec3(0.0f), glm::vec3(1.5f, 1.0f, 1.5f));
 }
 
 void setup_cameras() {
@@ -281,23 +234,23 @@ void setup_cameras() {
 		
 	cameras[0].projection_matrix = projection_matrix;
 	cameras[0].view_inverse_matrix = view_inverse_matrix;
+	cameras[0].view_normal_matrix = glm::transpose(glm::inverse(glm::mat3(cameras[0].view_inverse_matrix)));
 	cameras[0].fovy = fovy;
 	cameras[0].aspect_ratio = aspect_ratio;
 
 	cameras[1].projection_matrix = projection_matrix;
 	cameras[1].view_inverse_matrix = view_inverse_matrix * mirror_matrix(glm::vec3(0.0f, 1.0f, 0.0f), 0.0f);
+	cameras[1].view_normal_matrix = glm::transpose(glm::inverse(glm::mat3(cameras[1].view_inverse_matrix)));
 	cameras[1].fovy = fovy;
 	cameras[1].aspect_ratio = aspect_ratio;
 }
 
 void render_model(const model_t &model, const camera_t &camera, const shader_program_t &shader_program) {
-	glm::mat4 rotation_matrix = glm::mat4_cast(model.orientation);
-	glm::mat4 scale_matrix = glm::scale(glm::mat4(1.0), model.scale);
-	glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0), model.position); // from model to world	
-	
-	glm::mat4 model_matrix = translation_matrix * scale_matrix * rotation_matrix;
-	glm::mat4 model_view_matrix = camera.view_inverse_matrix * model_matrix; 
-	glm::mat3 normal_matrix = glm::mat3(glm::transpose(glm::inverse(model_view_matrix)));
+	if (model.mesh == NULL)
+		return;
+
+	glm::mat4 model_view_matrix = camera.view_inverse_matrix * scene.world_matrix(model.node);
+	glm::mat3 normal_matrix = camera.view_normal_matrix * scene.world_normal_matrix(model.node);
 	
 	shader_program.set_uniform_value("projection_matrix", camera.projection_matrix);
 	shader_program.set_uniform_value("model_view_matrix", model_view_matrix);	
@@ -306,8 +259,10 @@ void render_model(const model_t &model, const camera_t &camera, const shader_pro
 	model.mesh->render(shader_program);
 }
 
-void setup() {
-	setup_models();
+bool setup(vertex_format_t vertex_format) {
+	jobs = new job_queue_t();
+	texture_uploader = new texture_uploader_t();
+	setup_models(vertex_format);
 	
 	setup_cameras();
 	
@@ -316,33 +271,46 @@ void setup() {
 
 	light_direction = glm::vec3(0.0f, -1.0f, 0.0f);
 	
-	build_image_texutre(image_texture, "wood.png");
+	load_image_texture(image_texture, "wood.png");
 	build_color_texture(color_texture, viewport.x, viewport.y);
 	build_depth_texture(depth_texture, viewport.x, viewport.y);
 
+	texture_unit_t::initialize();
+	texture_unit_t::attach(0, &color_texture);
+	texture_unit_t::attach(1, &image_texture);
+
 	fbo = new frame_buffer_t(viewport.x, viewport.y);
 	fbo->bind();
 	fbo->attach_texture(GL_COLOR_ATTACHMENT0_EXT, color_texture);
 	fbo->attach_render_buffer(GL_DEPTH_ATTACHMENT_EXT, GL_DEPTH_COMPONENT);
 	GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0_EXT };
-	fbo->select_color_buffers(draw_buffers);
+	fbo->select_color_buffers(draw_buffers, 1);
 	if (! fbo->is_valid()) {
-	  glfwTerminate();
-    exit(EXIT_FAILURE);		
+		std::cerr << "*** Frame buffer incomplete" << std::endl;
+		return false;
 	}
 	fbo->release();
 	
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);	
-	glCullFace(GL_BACK);	
+	RENDER_STATE.invalidate(); // the setup above binds with plain GL
+	RENDER_STATE.set_capability(GL_TEXTURE_2D, true);
+	RENDER_STATE.set_capability(GL_DEPTH_TEST, true);
+	RENDER_STATE.set_capability(GL_CULL_FACE, true);
+	RENDER_STATE.cull_face(GL_BACK);
+	return true;
 }
 
+// the queued jobs point into the models and textures, and free themselves once uploaded
 void cleanup() {
-	
+	jobs->finish();
+	delete jobs;
+	delete texture_uploader;
+	delete teapot.mesh;
+	delete board.mesh;
 }
 
 void render() {
+	scene.update();
+
 	for (int i = 0; i < 2; i++) {
 		cameras[i].projection_matrix = glm::perspective(cameras[i].fovy, cameras[i].aspect_ratio, 1.0f, 30.0f);
 	}	
@@ -367,19 +335,17 @@ void render() {
 	render_model(teapot, cameras[0], diffuse_shader);
 	diffuse_shader.release();
 
-	glActiveTexture(texture_unit_0.unit_id);
-	glBindTexture(texture_unit_0.texture->target, texture_unit_0.texture->handle);
-	glActiveTexture(texture_unit_1.unit_id);
-	glBindTexture(texture_unit_1.texture->target, texture_unit_1.texture->handle);
+	TEXTURE_UNITS[0].activate();
+	TEXTURE_UNITS[1].activate();
 	reflection_shader.bind();
 	reflection_shader.set_uniform_value("R0", 0.08f);
 	reflection_shader.set_uniform_value("viewport", viewport);
-	reflection_shader.set_uniform_value("texture0", texture_unit_0.index);
-	reflection_shader.set_uniform_value("texture1", texture_unit_1.index);
+	reflection_shader.set_uniform_value("texture0", TEXTURE_UNITS[0].index());
+	reflection_shader.set_uniform_value("texture1", TEXTURE_UNITS[1].index());
 	render_model(board, cameras[0], reflection_shader);
 	reflection_shader.release();
-	glBindTexture(texture_unit_0.texture->target, 0);
-	glActiveTexture(0);
+	TEXTURE_UNITS[1].deactivate();
+	TEXTURE_UNITS[0].deactivate();
 
 	// debug_draw_texture(color_texture.handle);
 
@@ -411,7 +377,9 @@ void mouse_motion(int x, int y) {
 			cameras[i].fovy += delta;
 		}		
 	} else {
-		trackball.rotate(teapot.orientation, x, y);
+		glm::quat orientation = scene.orientation(teapot.node);
+		trackball.rotate(orientation, x, y);
+		scene.set_orientation(teapot.node, orientation);
 	}
 		
 	trackball.drag_update(x, y);	
@@ -441,38 +409,38 @@ void resize(int width, int height) {
 
 int main(int argc, char **args)
 {
-  if (!glfwInit()) {
-		log("Failed to initialize GLFW");
-    exit(EXIT_FAILURE);
-  }
-
-  int depth_bits = 16;
-  if (!glfwOpenWindow(640, 480, 0, 0, 0, 0, depth_bits, 0, GLFW_WINDOW)) {
-		log("Failed to open GLFW window");
-    glfwTerminate();
+	context_t context(640, 480, 16);
+	context.parse_arguments(argc, args);
+	if (!context.open("Teapot")) {
     exit(EXIT_FAILURE);
   }
-  glfwSetWindowTitle("Teapot");
-  glfwEnable(GLFW_STICKY_KEYS);
-  glfwSwapInterval(1);
 
-	glfwSetKeyCallback(keyboard);
-  glfwSetMouseButtonCallback(mouse_button);
-  glfwSetMousePosCallback(mouse_motion);
-	glfwSetWindowSizeCallback(resize);
+	if (context.is_headless()) {
+		resize(context.width(), context.height());
+	} else {
+		glfwSetKeyCallback(keyboard);
+	  glfwSetMouseButtonCallback(mouse_button);
+	  glfwSetMousePosCallback(mouse_motion);
+		glfwSetWindowSizeCallback(resize);
+	}
 
-	setup();
+	if (!setup(context.vertex_format())) {
+		cleanup();
+		context.close();
+		exit(EXIT_FAILURE);
+	}
+	if (context.is_headless())
+		jobs->finish(); // snapshots and profiles of a fixed frame count should see every asset
 
-  do {
-		render();						
-    glfwSwapBuffers();
+  while (context.is_running()) {
+		jobs->process_uploads(UPLOAD_BUDGET_SECONDS);
+		render();
+    context.swap_buffers();
   }
-  while (glfwGetKey(GLFW_KEY_ESC) != GLFW_PRESS && glfwGetWindowParam(GLFW_OPENED));
 
 	cleanup();
 
-  glfwTerminate();
+  context.close();
 
   return 0;
 }
-
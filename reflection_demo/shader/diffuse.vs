@@ -3,15 +3,33 @@
 uniform mat4 projection_matrix;
 uniform mat4 model_view_matrix;
 uniform mat3 normal_matrix;
+uniform bool compact_vertex; // set by mesh_t::render, see core/vertex_format.hpp
+uniform vec3 position_offset;
+uniform vec3 position_scale;
 
 attribute vec4 vertex_position;
 attribute vec3 vertex_normal;
 attribute vec2 vertex_tex_coord;
-attribute vec3 vertex_tangent;
+attribute vec4 vertex_tangent;
 
 varying vec3 normal;
 
+vec3 octahedral_decode(vec2 e) {
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(v);
+}
+
+vec3 decode_normal() {
+	return compact_vertex ? octahedral_decode(vertex_normal.xy) : vertex_normal;
+}
+
+vec4 decode_position() {
+	return vec4(position_offset + position_scale * vertex_position.xyz, 1.0);
+}
+
 void main(void) {
-	normal = normal_matrix * vertex_normal;	
-	gl_Position = projection_matrix * model_view_matrix * vertex_position;
+	normal = normal_matrix * decode_normal();
+	gl_Position = projection_matrix * model_view_matrix * decode_position();
 }
\ No newline at end of file
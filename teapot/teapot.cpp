@@ -12,9 +12,14 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <openctmpp.h>
+#include "gl.hpp"
 #include <GL/glfw.h>
 
 #include "shader.hpp"
+#include "mesh_optimizer.hpp"
+#include "index_buffer.hpp"
+#include "texture_loader.hpp"
+#include "context.hpp"
 
 #define BUFFER_OFFSET(bytes) ((GLubyte *)NULL + (bytes))
 
@@ -38,6 +43,7 @@ struct teapot_t {
   GLuint tex_coord_buffer_handle;
   unsigned int vertex_count;
   unsigned int index_count;
+  GLenum index_type;
 
   shader_program_t shader_program;
   vertex_attribute_handles_t vertex_attributes;
@@ -67,19 +73,16 @@ bool load_mesh(const char *ctm_filepath, mesh_t & mesh)
     unsigned int vertex_count = ctm.GetInteger(CTM_VERTEX_COUNT);
     unsigned int vertex_element_count = 3 * vertex_count;
     const CTMfloat *vertices = ctm.GetFloatArray(CTM_VERTICES);
-    mesh.vertices.resize(vertex_element_count);
-    std::memcpy(&mesh.vertices[0], vertices, vertex_element_count * sizeof(float));
+    mesh.vertices.assign(vertices, vertices + vertex_element_count);
 
     unsigned int face_count = ctm.GetInteger(CTM_TRIANGLE_COUNT);
     unsigned int indice_count = face_count * 3;
     const CTMuint *indices = ctm.GetIntegerArray(CTM_INDICES);
-    mesh.indices.resize(indice_count);
-    std::memcpy(&mesh.indices[0], indices, indice_count * sizeof(unsigned int));
+    mesh.indices.assign(indices, indices + indice_count);
 
     if (ctm.GetInteger(CTM_HAS_NORMALS) == CTM_TRUE) {
       const CTMfloat *normals = ctm.GetFloatArray(CTM_NORMALS);
-      mesh.normals.resize(vertex_element_count);
-      std::memcpy(&mesh.normals[0], normals, vertex_element_count * sizeof(float));
+      mesh.normals.assign(normals, normals + vertex_element_count);
     } else {
       std::cerr << "*** CTM_HAS_NORMALS == false" << std::endl;
     }
@@ -88,12 +91,18 @@ bool load_mesh(const char *ctm_filepath, mesh_t & mesh)
     if (uv_map_count > 0) {
       const CTMfloat *tex_coords = ctm.GetFloatArray(CTM_UV_MAP_1);
       unsigned int tex_coord_element_count = 2 * vertex_count;
-      mesh.tex_coords.resize(tex_coord_element_count);
-      std::memcpy(&mesh.tex_coords[0], tex_coords, tex_coord_element_count * sizeof(float));
+      mesh.tex_coords.assign(tex_coords, tex_coords + tex_coord_element_count);
     } else {
       std::cerr << "*** UV map not found" << std::endl;
     }
 
+    mesh_optimization_t optimization;
+    optimize_mesh(mesh.indices, mesh.vertices.empty() ? NULL : &mesh.vertices[0], 3, vertex_count, optimization);
+    remap_vertex_stream(mesh.vertices, 3, optimization.remap, optimization.vertex_count);
+    remap_vertex_stream(mesh.normals, 3, optimization.remap, optimization.vertex_count);
+    remap_vertex_stream(mesh.tex_coords, 2, optimization.remap, optimization.vertex_count);
+    optimization.report(std::cout, ctm_filepath);
+
     return true;
   }
   catch(ctm_error & e) {
@@ -215,9 +224,12 @@ bool load_teapot(const char *ctm_filepath, teapot_t & teapot)
   glBufferData(GL_ARRAY_BUFFER, ARRAY_BUFFER_SIZE(mesh.normals, float), &mesh.normals[0], GL_STATIC_DRAW);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+  std::vector<unsigned char> indices;
+  std::vector<submesh_t> submeshes;
+  teapot.index_type = build_index_buffer(&mesh.indices[0], mesh.indices.size(), mesh.vertices.size() / 3, false, indices, submeshes);
   glGenBuffers(1, &teapot.index_buffer_handle);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, teapot.index_buffer_handle);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, ARRAY_BUFFER_SIZE(mesh.indices, unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), &indices[0], GL_STATIC_DRAW);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
   glGenBuffers(1, &teapot.tex_coord_buffer_handle);
@@ -269,7 +281,7 @@ void draw_teapot(const teapot_t & teapot)
   glEnableVertexAttribArray(vertex_attributes->normal);
   glEnableVertexAttribArray(vertex_attributes->tex_coord);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, teapot.index_buffer_handle);
-  glDrawElements(GL_TRIANGLES, teapot.index_count, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
+  glDrawElements(GL_TRIANGLES, teapot.index_count, teapot.index_type, BUFFER_OFFSET(0));
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   glDisableVertexAttribArray(vertex_attributes->tex_coord);
   glDisableVertexAttribArray(vertex_attributes->normal);
@@ -279,8 +291,6 @@ void draw_teapot(const teapot_t & teapot)
 
 int main(int argc, char **args)
 {
-  const char *ctm_filepath = (argc > 1) ? args[1] : "teapot.ctm";
-
   trackball_state.radius = 150.0f;
   trackball_state.dragged = false;
   trackball_state.orientation.w = 1.0f;
@@ -288,25 +298,20 @@ int main(int argc, char **args)
   trackball_state.orientation.y = 0.0f;
   trackball_state.orientation.z = 0.0f;
 
-  if (!glfwInit()) {
-    std::cerr << "Failed to initialize GLFW" << std::endl;
+  context_t context(640, 480, 16);
+  context.parse_arguments(argc, args);
+  const char *ctm_filepath = (argc > 1) ? args[1] : "teapot.ctm";
+  if (!context.open("Spinning Teapot")) {
     exit(EXIT_FAILURE);
   }
-
-  int depth_bits = 16;
-  if (!glfwOpenWindow(640, 480, 0, 0, 0, 0, depth_bits, 0, GLFW_WINDOW)) {
-    std::cerr << "Failed to open GLFW window" << std::endl;
-    glfwTerminate();
-    exit(EXIT_FAILURE);
+  screen_width = context.width();
+  screen_height = context.height();
+  if (!context.is_headless()) {
+    glfwSetWindowSizeCallback(resize);
+    glfwSetKeyCallback(keyboard);
+    glfwSetMouseButtonCallback(mouse);
+    glfwSetMousePosCallback(motion);
   }
-  glfwGetWindowSize(&screen_width, &screen_height);
-  glfwSetWindowSizeCallback(resize);
-  glfwSetKeyCallback(keyboard);
-  glfwSetMouseButtonCallback(mouse);
-  glfwSetMousePosCallback(motion);
-  glfwSetWindowTitle("Spinning Teapot");
-  glfwEnable(GLFW_STICKY_KEYS);
-  glfwSwapInterval(1);
 
   teapot_t teapot;
   load_teapot(ctm_filepath, teapot);
@@ -316,9 +321,9 @@ int main(int argc, char **args)
   GLuint texture_id;
   glGenTextures(1, &texture_id);
   glBindTexture(GL_TEXTURE_2D, texture_id);
-  if (!glfwLoadTexture2D(texture_filepath, GLFW_BUILD_MIPMAPS_BIT)) {
+  if (!load_texture_2d_from_file(texture_filepath, true)) {
     std::cout << "Failed to load texture: " << texture_filepath << std::endl;
-    glfwTerminate();
+    context.close();
     exit(EXIT_FAILURE);
   }
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -342,7 +347,7 @@ int main(int argc, char **args)
   glEnable(GL_CULL_FACE);
   glCullFace(GL_BACK);
 
-  do {
+  while (context.is_running()) {
     glClearColor(0.5f, 0.5f, 0.5f, 0.0f);
     glClearDepth(1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -365,12 +370,11 @@ int main(int argc, char **args)
     glBindTexture(GL_TEXTURE_2D, 0);
     glActiveTexture(0);
 
-    glfwSwapBuffers();
+    context.swap_buffers();
 
   }
-  while (glfwGetKey(GLFW_KEY_ESC) != GLFW_PRESS && glfwGetWindowParam(GLFW_OPENED));
 
-  glfwTerminate();
+  context.close();
 
   return 0;
 }
@@ -1,4 +1,7 @@
 #version 120
+#ifdef UNIFORM_BUFFERS
+#extension GL_ARB_uniform_buffer_object : require
+#endif
 // #define TEXTURE_UNIT_1
 
 struct material_t {
@@ -9,8 +12,22 @@ struct material_t {
 
 const float depth_bias = -0.0005;
 
+#ifdef UNIFORM_BUFFERS
+layout(std140) uniform frame_block {
+	mat4 projection_matrix;
+	mat4 view_matrix;
+	mat4 light_pov_matrix;
+	vec3 light_position;
+};
+layout(std140) uniform object_block {
+	mat4 model_matrix;
+	mat3 normal_matrix;
+	material_t material;
+};
+#else
 uniform vec3 light_position;
 uniform material_t material;
+#endif
 uniform sampler2D texture1;
 uniform sampler2D texture2;
 
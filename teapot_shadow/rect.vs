@@ -1,8 +1,29 @@
 #version 120
+#ifdef UNIFORM_BUFFERS
+#extension GL_ARB_uniform_buffer_object : require
 
+struct material_t {
+	vec3 diffuse;
+	vec3 specular;
+	float shininess;
+};
+
+layout(std140) uniform frame_block {
+	mat4 projection_matrix;
+	mat4 view_matrix;
+	mat4 light_pov_matrix;
+	vec3 light_position;
+};
+layout(std140) uniform object_block {
+	mat4 model_matrix;
+	mat3 normal_matrix;
+	material_t material;
+};
+#else
 uniform mat4 projection_matrix;
 uniform mat4 view_matrix;
 uniform mat4 model_matrix;
+#endif
 
 attribute vec3 vertex_position;
 attribute vec3 vertex_normal;
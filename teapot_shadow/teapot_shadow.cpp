@@ -8,8 +8,7 @@
 #include <string>
 #include <sstream>
 
-#include <OpenGL/gl.h>
-#include <OpenGL/glext.h>
+#include "gl.hpp"
 #include <GL/glfw.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -18,6 +17,16 @@
 #include <openctmpp.h>
 
 #include "shader.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "index_buffer.hpp"
+#include "texture_loader.hpp"
+#include "render_state.hpp"
+#include "render_queue.hpp"
+#include "transform_batch.hpp"
+#include "uniform_buffer.hpp"
+#include "context.hpp"
+#include "profiler.hpp"
 
 #define BUFFER_OFFSET(bytes) ((GLubyte *)NULL + (bytes))
 
@@ -39,6 +48,7 @@ struct array_buffer_t {
 };
 
 struct material_t {
+	unsigned int id; // sort key of the draws
 	glm::vec3 diffuse;
 	glm::vec3 specular;
 	float shininess;
@@ -48,14 +58,46 @@ struct mesh_object_t {
 	array_buffer_t vertex_buffer;
 	array_buffer_t normal_buffer;
 	array_buffer_t index_buffer;
+	GLenum index_type;
+	std::vector<submesh_t> submeshes;
 	array_buffer_t tex_coord_buffer;
 	bool has_tex_coords;
 	std::vector<texture_t> textures;
-	shader_program_t *shader_program;
 	material_t material;
 	glm::mat4 transform_matrix;
+	glm::mat3 normal_matrix;  // the inverse transpose of transform_matrix's upper 3x3
+	GLintptr uniform_offset; // of its object_block in the uniform ring this frame
 };
 
+enum render_pass_t {
+	SHADOW_PASS,
+	MAIN_PASS
+};
+
+// std140 mirrors of the blocks the shaders declare when built with UNIFORM_BUFFERS
+struct frame_block_t {
+	glm::mat4 projection_matrix;
+	glm::mat4 view_matrix;
+	glm::mat4 light_pov_matrix;
+	glm::vec4 light_position;
+};
+
+struct object_block_t {
+	glm::mat4 model_matrix;
+	std140_mat3_t normal_matrix;
+	glm::vec4 diffuse;
+	glm::vec3 specular;
+	float shininess;
+};
+
+enum uniform_block_binding_t {
+	FRAME_BLOCK_BINDING,
+	OBJECT_BLOCK_BINDING
+};
+
+// NULL where uniform buffers are not supported, and the shaders take plain uniforms
+uniform_ring_t *uniform_ring = NULL;
+
 struct trackball_state_t {
   glm::ivec2 center_position;
   glm::ivec2 prev_position;
@@ -265,7 +307,7 @@ bool load_mesh_cube(mesh_t &mesh) {
 	return true;
 }
 
-bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
+bool load_mesh_from_ctm_file(const char *ctm_filepath, mesh_t & mesh)
 {
   CTMimporter ctm;
 
@@ -275,19 +317,16 @@ bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
     unsigned int vertex_count = ctm.GetInteger(CTM_VERTEX_COUNT);
     unsigned int vertex_element_count = 3 * vertex_count;
     const CTMfloat *vertices = ctm.GetFloatArray(CTM_VERTICES);
-    mesh.vertices.resize(vertex_element_count);
-    std::memcpy(&mesh.vertices[0], vertices, vertex_element_count * sizeof(float));
+    mesh.vertices.assign(vertices, vertices + vertex_element_count);
 
     unsigned int face_count = ctm.GetInteger(CTM_TRIANGLE_COUNT);
     unsigned int indice_count = face_count * 3;
     const CTMuint *indices = ctm.GetIntegerArray(CTM_INDICES);
-    mesh.indices.resize(indice_count);
-    std::memcpy(&mesh.indices[0], indices, indice_count * sizeof(unsigned int));
+    mesh.indices.assign(indices, indices + indice_count);
 
     if (ctm.GetInteger(CTM_HAS_NORMALS) == CTM_TRUE) {
       const CTMfloat *normals = ctm.GetFloatArray(CTM_NORMALS);
-      mesh.normals.resize(vertex_element_count);
-      std::memcpy(&mesh.normals[0], normals, vertex_element_count * sizeof(float));
+      mesh.normals.assign(normals, normals + vertex_element_count);
     } else {
       std::cerr << "*** CTM_HAS_NORMALS == false" << std::endl;
     }
@@ -296,12 +335,18 @@ bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
     if (uv_map_count > 0) {
       const CTMfloat *tex_coords = ctm.GetFloatArray(CTM_UV_MAP_1);
       unsigned int tex_coord_element_count = 2 * vertex_count;
-      mesh.tex_coords.resize(tex_coord_element_count);
-      std::memcpy(&mesh.tex_coords[0], tex_coords, tex_coord_element_count * sizeof(float));
+      mesh.tex_coords.assign(tex_coords, tex_coords + tex_coord_element_count);
     } else {
       std::cerr << "*** UV map not found" << std::endl;
     }
 
+    mesh_optimization_t optimization;
+    optimize_mesh(mesh.indices, mesh.vertices.empty() ? NULL : &mesh.vertices[0], 3, vertex_count, optimization);
+    remap_vertex_stream(mesh.vertices, 3, optimization.remap, optimization.vertex_count);
+    remap_vertex_stream(mesh.normals, 3, optimization.remap, optimization.vertex_count);
+    remap_vertex_stream(mesh.tex_coords, 2, optimization.remap, optimization.vertex_count);
+    optimization.report(std::cout, ctm_filepath);
+
     return true;
   }
   catch(ctm_error & e) {
@@ -310,13 +355,31 @@ bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
   }
 }
 
-bool build_shader_program(shader_program_t &shader_program, const char *vertex_shader_filepath, const char *fragment_shader_filepath) {
-  if (!shader_program.add_shader_from_source_file(GL_VERTEX_SHADER, vertex_shader_filepath)) {
+bool read_mesh_source(const char *ctm_filepath, void *mesh)
+{
+  return load_mesh_from_ctm_file(ctm_filepath, *static_cast<mesh_t *>(mesh));
+}
+
+bool load_mesh_from_file(const char *ctm_filepath, mesh_t & mesh)
+{
+  mesh_cache_t::stream_t streams[] = {
+    { mesh_cache_t::POSITIONS, &mesh.vertices },
+    { mesh_cache_t::NORMALS, &mesh.normals },
+    { mesh_cache_t::TEX_COORDS, &mesh.tex_coords }
+  };
+  size_t stream_count = sizeof(streams) / sizeof(streams[0]);
+  return mesh_cache_t::read_streams(ctm_filepath, mesh.indices, std::vector<mesh_cache_t::stream_t>(streams, streams + stream_count),
+                                    read_mesh_source, &mesh);
+}
+
+bool build_shader_program(shader_program_t &shader_program, const char *vertex_shader_filepath, const char *fragment_shader_filepath,
+                          const char *defines = NULL) {
+  if (!shader_program.add_shader_from_source_file(GL_VERTEX_SHADER, vertex_shader_filepath, defines)) {
 		std::cerr << "*** " << vertex_shader_filepath << std::endl;
     std::cerr << shader_program.log() << std::endl;
     return false;
   }
-  if (!shader_program.add_shader_from_source_file(GL_FRAGMENT_SHADER, fragment_shader_filepath)) {
+  if (!shader_program.add_shader_from_source_file(GL_FRAGMENT_SHADER, fragment_shader_filepath, defines)) {
 		std::cerr << "*** " << fragment_shader_filepath << std::endl;
     std::cerr << shader_program.log() << std::endl;
     return false;
@@ -326,6 +389,8 @@ bool build_shader_program(shader_program_t &shader_program, const char *vertex_s
     std::cerr << shader_program.log() << std::endl;
     return false;
   }	
+	shader_program.bind_uniform_block("frame_block", FRAME_BLOCK_BINDING);
+	shader_program.bind_uniform_block("object_block", OBJECT_BLOCK_BINDING);
 
 	return true;
 }
@@ -349,9 +414,11 @@ bool build_mesh_object(const mesh_t &mesh, mesh_object_t &object) {
   glBufferData(GL_ARRAY_BUFFER, object.normal_buffer.count * sizeof(float), &mesh.normals[0], GL_STATIC_DRAW);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+  std::vector<unsigned char> indices;
+  object.index_type = build_index_buffer(&mesh.indices[0], mesh.indices.size(), mesh.vertices.size() / 3, true, indices, object.submeshes);
   glGenBuffers(1, &object.index_buffer.handle);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.index_buffer.handle);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, object.index_buffer.count * sizeof(unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), &indices[0], GL_STATIC_DRAW);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	if (object.has_tex_coords) {
@@ -360,72 +427,114 @@ bool build_mesh_object(const mesh_t &mesh, mesh_object_t &object) {
   	glBufferData(GL_ARRAY_BUFFER, object.tex_coord_buffer.count * sizeof(float), &mesh.tex_coords[0], GL_STATIC_DRAW);
   	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
-	
-	object.shader_program = NULL;
 
 	return true;
 }
 
-void draw_mesh_object(const mesh_object_t & object)
+// without uniform buffers
+void set_object_uniforms(const shader_program_t &shader_program, const mesh_object_t & object)
 {
-	assert(object.shader_program != NULL);
-	
-	GLuint position_location = object.shader_program->attribute_location("vertex_position");
-	GLuint normal_location = object.shader_program->attribute_location("vertex_normal");
-	GLuint tex_coord_location = object.has_tex_coords ? object.shader_program->attribute_location("vertex_tex_coord") : 0;
+	shader_program.set_uniform_value("model_matrix", object.transform_matrix);
+	shader_program.set_uniform_value("normal_matrix", object.normal_matrix);
 
-	glm::mat3 normal_matrix = glm::mat3(glm::transpose(glm::inverse(object.transform_matrix)));
-	object.shader_program->set_uniform_value("model_matrix", object.transform_matrix);
-	object.shader_program->set_uniform_value("normal_matrix", normal_matrix);
-
-	object.shader_program->set_uniform_value("material.diffuse", object.material.diffuse);
-	object.shader_program->set_uniform_value("material.specular", object.material.specular);
-	object.shader_program->set_uniform_value("material.shininess", object.material.shininess);
+	shader_program.set_uniform_value("material.diffuse", object.material.diffuse);
+	shader_program.set_uniform_value("material.specular", object.material.specular);
+	shader_program.set_uniform_value("material.shininess", object.material.shininess);
+}
 
+// the caller binds shader_program, the object's textures and its uniforms
+void draw_mesh_object(const mesh_object_t & object, const shader_program_t &shader_program)
+{
+	GLuint position_location = shader_program.attribute_location("vertex_position");
+	GLuint normal_location = shader_program.attribute_location("vertex_normal");
+	GLuint tex_coord_location = object.has_tex_coords ? shader_program.attribute_location("vertex_tex_coord") : 0;
+
+	// buffers and arrays stay bound for the next draw; RENDER_STATE skips rebinding what is already bound
+
+	GLuint attrib_arrays = render_state_t::attrib_array_bit(position_location) | render_state_t::attrib_array_bit(normal_location);
+	if (object.has_tex_coords) attrib_arrays |= render_state_t::attrib_array_bit(tex_coord_location);
+	RENDER_STATE.bind_vertex_array(0);
+	RENDER_STATE.set_vertex_attrib_arrays(attrib_arrays);
+  RENDER_STATE.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, object.index_buffer.handle);
+	// one draw per submesh, each with the attribute pointers moved to its first vertex
   GLsizei stride = 3 * sizeof(float);
-  glBindBuffer(GL_ARRAY_BUFFER, object.vertex_buffer.handle);
-  glVertexAttribPointer(position_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(0));
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+	for (size_t i = 0; i < object.submeshes.size(); i++) {
+		const submesh_t &submesh = object.submeshes[i];
+		RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, object.vertex_buffer.handle);
+		glVertexAttribPointer(position_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(submesh.base_vertex * stride));
 
-  glBindBuffer(GL_ARRAY_BUFFER, object.normal_buffer.handle);
-  glVertexAttribPointer(normal_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(0));
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+		RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, object.normal_buffer.handle);
+		glVertexAttribPointer(normal_location, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(submesh.base_vertex * stride));
 
-	if (object.has_tex_coords) {
-  	glBindBuffer(GL_ARRAY_BUFFER, object.tex_coord_buffer.handle);
-  	glVertexAttribPointer(tex_coord_location, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), BUFFER_OFFSET(0));
-  	glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (object.has_tex_coords) {
+			RENDER_STATE.bind_buffer(GL_ARRAY_BUFFER, object.tex_coord_buffer.handle);
+			glVertexAttribPointer(tex_coord_location, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), BUFFER_OFFSET(submesh.base_vertex * 2 * sizeof(float)));
+		}
+		glDrawElements(GL_TRIANGLES, submesh.index_count, object.index_type, BUFFER_OFFSET(submesh.first_index * index_type_size(object.index_type)));
 	}
 
-	for (size_t i = 0; i < object.textures.size(); i++) {
-		const texture_t &tex = object.textures[i];
-		glActiveTexture(texture_unit_names[tex.unit_id]);
-		glBindTexture(GL_TEXTURE_2D, tex.handle);
-	}
+}
 
-  glEnableVertexAttribArray(position_location);
-  glEnableVertexAttribArray(normal_location);
-	if (object.has_tex_coords) glEnableVertexAttribArray(tex_coord_location);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.index_buffer.handle);
-  glDrawElements(GL_TRIANGLES, object.index_buffer.count, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	if (object.has_tex_coords) glDisableVertexAttribArray(tex_coord_location);
-  glDisableVertexAttribArray(normal_location);
-  glDisableVertexAttribArray(position_location);
-
-	for (size_t i = 0; i < object.textures.size(); i++) {
-		const texture_t &tex = object.textures[i];
-		glActiveTexture(texture_unit_names[tex.unit_id]);
-		glBindTexture(GL_TEXTURE_2D, 0);
+void draw_mesh_packet(const draw_packet_t &packet)
+{
+	const mesh_object_t &object = *static_cast<const mesh_object_t *>(packet.object);
+	if (uniform_ring != NULL)
+		uniform_ring->bind(OBJECT_BLOCK_BINDING, object.uniform_offset, sizeof(object_block_t));
+	else
+		set_object_uniforms(*packet.program, object);
+	draw_mesh_object(object, *packet.program);
+}
+
+// the blocks of all the objects, written into one run of the ring; false when the frame's
+// region is full, leaving the objects' offsets those of an earlier frame
+bool write_object_blocks(mesh_object_t **objects, size_t count)
+{
+	size_t stride = uniform_ring->aligned_size(sizeof(object_block_t));
+	GLintptr offset;
+	unsigned char *memory = static_cast<unsigned char *>(uniform_ring->allocate(count * stride, offset));
+	if (memory == NULL)
+		return false;
+	for (size_t i = 0; i < count; i++) {
+		const mesh_object_t &object = *objects[i];
+		object_block_t block;
+		block.model_matrix = object.transform_matrix;
+		block.normal_matrix = std140_mat3_t(object.normal_matrix);
+		block.diffuse = glm::vec4(object.material.diffuse, 0.0f);
+		block.specular = object.material.specular;
+		block.shininess = object.material.shininess;
+		std::memcpy(memory + i * stride, &block, sizeof(block));
+		objects[i]->uniform_offset = offset + i * stride;
 	}
+	return true;
+}
 
+// -1 when the frame's region is full
+GLintptr write_frame_block(const glm::mat4 &projection_matrix, const glm::mat4 &view_matrix, const glm::mat4 &light_pov_matrix,
+                           const glm::vec3 &light_position)
+{
+	frame_block_t block;
+	block.projection_matrix = projection_matrix;
+	block.view_matrix = view_matrix;
+	block.light_pov_matrix = light_pov_matrix;
+	block.light_position = glm::vec4(light_position, 1.0f);
+	return uniform_ring->push(&block, sizeof(block));
+}
+
+// with_textures is false for the shadow pass, which only writes depth
+void queue_mesh_object(render_queue_t &queue, render_pass_t pass, const mesh_object_t &object, const shader_program_t &shader_program,
+                       const glm::mat4 &view_matrix, bool with_textures)
+{
+	draw_packet_t &packet = queue.push(pass, shader_program, object.material.id, view_depth(view_matrix, object.transform_matrix), false,
+	                                   &object, draw_mesh_packet, object.transform_matrix);
+	for (size_t i = 0; with_textures && i < object.textures.size(); i++)
+		packet.add_texture(texture_unit_names[object.textures[i].unit_id], GL_TEXTURE_2D, object.textures[i].handle);
 }
 
 bool build_texutre_from_file(const char *filepath, texture_t &tex) {
   GLuint texture_handle;
 	glGenTextures(1, &texture_handle);
   glBindTexture(GL_TEXTURE_2D, texture_handle);
-  if (!glfwLoadTexture2D(filepath, GLFW_BUILD_MIPMAPS_BIT))
+  if (!load_texture_2d_from_file(filepath, true))
 		return false;
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -477,46 +586,48 @@ void trackback_state_initialize(trackball_state_t &trackball_state) {
 
 int main(int argc, char **args)
 {
+  context_t context(640, 480, 16);
+  context.parse_arguments(argc, args);
+  profiler_t profiler;
+  profiler.set_enabled(!context.profile_filepath().empty());
   const char *ctm_filepath = (argc > 1) ? args[1] : "teapot.ctm";
 
 	trackback_state_initialize(camera_rotation);
 	trackback_state_initialize(light_rotation);
 	current_trackball_state = &camera_rotation;
 
-  if (!glfwInit()) {
-    std::cerr << "Failed to initialize GLFW" << std::endl;
+  if (!context.open("Spinning Teapot")) {
     exit(EXIT_FAILURE);
   }
-
-  int depth_bits = 16;
-  if (!glfwOpenWindow(640, 480, 0, 0, 0, 0, depth_bits, 0, GLFW_WINDOW)) {
-    std::cerr << "Failed to open GLFW window" << std::endl;
-    glfwTerminate();
-    exit(EXIT_FAILURE);
+  screen_width = context.width();
+  screen_height = context.height();
+  if (!context.is_headless()) {
+    glfwSetWindowSizeCallback(resize);
+    glfwSetKeyCallback(keyboard);
+    glfwSetMouseButtonCallback(mouse);
+    glfwSetMousePosCallback(motion);
   }
-  glfwGetWindowSize(&screen_width, &screen_height);
-  glfwSetWindowSizeCallback(resize);
-  glfwSetKeyCallback(keyboard);
-  glfwSetMouseButtonCallback(mouse);
-  glfwSetMousePosCallback(motion);
-  glfwSetWindowTitle("Spinning Teapot");
-  glfwEnable(GLFW_STICKY_KEYS);
-  glfwSwapInterval(1);
 
 	// Shaders
+	const char *shader_defines = NULL;
+	if (uniform_buffers_supported()) {
+		uniform_ring = new uniform_ring_t();
+		shader_defines = "#define UNIFORM_BUFFERS";
+		std::cout << "Uniform blocks from a " << (uniform_ring->is_persistent() ? "persistently mapped" : "staged") << " ring buffer" << std::endl;
+	}
 	shader_program_t phong_shader;
-	build_shader_program(phong_shader, "phong.vs", "phong.fs");
+	build_shader_program(phong_shader, "phong.vs", "phong.fs", shader_defines);
 	shader_program_t rect_shader;
-	build_shader_program(rect_shader, "rect.vs", "rect.fs");
+	build_shader_program(rect_shader, "rect.vs", "rect.fs", shader_defines);
 	shader_program_t render_buffer_shader;
-	build_shader_program(render_buffer_shader, "render_buffer.vs", "render_buffer.fs");
+	build_shader_program(render_buffer_shader, "render_buffer.vs", "render_buffer.fs", shader_defines);
 
 	//--- Mesh Objects
 	mesh_t mesh_floor;
 	load_mesh_cube(mesh_floor);
   mesh_object_t floor;
   if (! build_mesh_object(mesh_floor, floor) ) {
-    glfwTerminate();
+    context.close();
     exit(EXIT_FAILURE);	
 	}
 
@@ -524,18 +635,18 @@ int main(int argc, char **args)
 	load_mesh_plane(mesh_plane);
   mesh_object_t plane;
   if (! build_mesh_object(mesh_plane, plane) ) {
-    glfwTerminate();
+    context.close();
     exit(EXIT_FAILURE);	
 	}
 
 	mesh_t mesh_teapot;
 	if (! load_mesh_from_file(ctm_filepath, mesh_teapot) ) {
-	  glfwTerminate();
+	  context.close();
     exit(EXIT_FAILURE);		
 	}
   mesh_object_t teapot;
   if (! build_mesh_object(mesh_teapot, teapot) ) {
-	  glfwTerminate();
+	  context.close();
     exit(EXIT_FAILURE);
 	}
 
@@ -545,7 +656,7 @@ int main(int argc, char **args)
 	tex.unit_id = 1;
 	if (! build_texutre_from_file(texture_filepath, tex)) {
 		std::cout << "Failed to load texture: " << texture_filepath << std::endl;
-	  glfwTerminate();
+	  context.close();
 	  exit(EXIT_FAILURE);		
 	}
 
@@ -571,115 +682,170 @@ int main(int argc, char **args)
 		0.5f, 0.5f, 0.5f, 1.0f
 		);
 
+	teapot.material.id = 0;
 	teapot.material.diffuse = glm::vec3(0.0f, 1.0f, 1.0f);
 	teapot.material.specular = glm::vec3(0.8f);
 	teapot.material.shininess = 128.0f;	
 	teapot.textures.push_back(tex);	
 	teapot.textures.push_back(depth_tex_buffer);
 	
+	floor.material.id = 1;
 	floor.material.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
 	floor.material.specular = glm::vec3(0.8f);
 	floor.material.shininess = 2.0f;
 	floor.textures.push_back(depth_tex_buffer);
 	
+	plane.material.id = 2;
+	plane.material.diffuse = glm::vec3(1.0f);
+	plane.material.specular = glm::vec3(0.0f);
+	plane.material.shininess = 1.0f;
 	plane.textures.push_back(depth_tex_buffer);
 
-	glEnable(GL_TEXTURE_2D);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
+	render_queue_t queue;
+
+	RENDER_STATE.invalidate(); // the setup above binds with plain GL
+	RENDER_STATE.set_capability(GL_TEXTURE_2D, true);
+	RENDER_STATE.set_capability(GL_DEPTH_TEST, true);
+	RENDER_STATE.set_capability(GL_CULL_FACE, true);
+
+  while (context.is_running()) {
+		profiler.begin_frame();
 
-  do {
 		//--- Transform
 		glm::vec3 light_position = glm::mat3_cast(light_rotation.orientation) * glm::vec3(0.0f, 5.0f, 0.0f);
 		glm::vec3 light_center(0.0f, 0.0f, 0.0f);
 		glm::vec3 light_up(0.0f, 0.0f, 1.0f);
 		glm::mat4 light_view_matrix = glm::lookAt(light_position, light_center, light_up);
 		
-		teapot.transform_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.5f, 0.0f));
-		floor.transform_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 0.05f, 2.0f));
-		
+		glm::quat no_rotation(1.0f, 0.0f, 0.0f, 0.0f);
+		compose_transform(glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f), no_rotation, teapot.transform_matrix, teapot.normal_matrix);
+		compose_transform(glm::vec3(0.0f), glm::vec3(2.0f, 0.05f, 2.0f), no_rotation, floor.transform_matrix, floor.normal_matrix);
+		compose_transform(glm::vec3(0.0f), glm::vec3(screen_width, screen_height, 1.0f), no_rotation, plane.transform_matrix, plane.normal_matrix);
+		glm::mat4 light_projection_matrix = glm::perspective(30.0f, (float) screen_width / (float) screen_height, 0.5f, 100.0f);
+		light_pov_matrix = bias * light_projection_matrix * light_view_matrix;
+		glm::mat4 projection_matrix = glm::perspective(camera_fovy, (float) screen_width / (float) screen_height, 1.0f, 30.0f);
+		glm::mat4 _view_matrix = view_matrix * glm::mat4_cast(camera_rotation.orientation);
+
+		//--- Uniform blocks, for every draw of the frame at once
+		GLintptr shadow_frame_offset = 0, main_frame_offset = 0;
+		if (uniform_ring != NULL) {
+			uniform_ring->begin_frame();
+			mesh_object_t *objects[] = { &teapot, &floor, &plane };
+			bool written = write_object_blocks(objects, 3);
+			shadow_frame_offset = write_frame_block(light_projection_matrix, light_view_matrix, light_pov_matrix, light_position);
+			main_frame_offset = write_frame_block(projection_matrix, _view_matrix, light_pov_matrix, light_position);
+			uniform_ring->flush();
+			// the shaders built for the ring read nothing but the blocks, so without them there is
+			// nothing to draw with; the stale offsets may point at a region being rewritten
+			if (!written || shadow_frame_offset < 0 || main_frame_offset < 0) {
+				std::cerr << "*** Uniform ring region full, frame skipped" << std::endl;
+				context.swap_buffers();
+				profiler.end_frame();
+				continue;
+			}
+		}
+
+		//--- Queue
+		queue.clear();
+		queue_mesh_object(queue, SHADOW_PASS, teapot, render_buffer_shader, light_view_matrix, false);
+		queue_mesh_object(queue, SHADOW_PASS, floor, render_buffer_shader, light_view_matrix, false);
+#ifndef DEPTH_BUFFER_DEBUG
+		queue_mesh_object(queue, MAIN_PASS, teapot, phong_shader, _view_matrix, true);
+		queue_mesh_object(queue, MAIN_PASS, floor, phong_shader, _view_matrix, true);
+#endif
+
 		//--- Render
-		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fb_handle);
+		RENDER_STATE.bind_frame_buffer(fb_handle);
 		{
-	    glm::mat4 projection_matrix = glm::perspective(30.0f, (float) screen_width / (float) screen_height, 0.5f, 100.0f);
-			light_pov_matrix = bias * projection_matrix * light_view_matrix;
-			
+			PROFILE_GPU_SCOPE(profiler, "shadow pass");
 			glClear(GL_DEPTH_BUFFER_BIT);
 			glClearDepth(1.0f);
 			glViewport(0, 0, depth_tex_width, depth_tex_height);
-			teapot.shader_program = &render_buffer_shader;
-			teapot.shader_program->bind();		
-    	teapot.shader_program->set_uniform_value("projection_matrix", projection_matrix);
-    	teapot.shader_program->set_uniform_value("view_matrix", light_view_matrix);
-			draw_mesh_object(teapot);
-			teapot.shader_program->release();
-			floor.shader_program = &render_buffer_shader;
-			floor.shader_program->bind();		
-    	floor.shader_program->set_uniform_value("projection_matrix", projection_matrix);
-    	floor.shader_program->set_uniform_value("view_matrix", light_view_matrix);
-    	draw_mesh_object(floor);
-			floor.shader_program->release();		
+			render_buffer_shader.bind();
+			if (uniform_ring != NULL) {
+				uniform_ring->bind(FRAME_BLOCK_BINDING, shadow_frame_offset, sizeof(frame_block_t));
+			} else {
+				render_buffer_shader.set_uniform_value("projection_matrix", light_projection_matrix);
+				render_buffer_shader.set_uniform_value("view_matrix", light_view_matrix);
+			}
+			queue.submit(SHADOW_PASS);
 		}
-		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);		
+		RENDER_STATE.bind_frame_buffer(context.frame_buffer_handle());		
 	
 #ifdef DEPTH_BUFFER_DEBUG
 		{
-			glDisable(GL_DEPTH_TEST);
+			PROFILE_GPU_SCOPE(profiler, "depth buffer debug pass");
+			RENDER_STATE.set_capability(GL_DEPTH_TEST, false);
 			glClear(GL_COLOR_BUFFER_BIT);		
     	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
     	glViewport(0, 0, screen_width, screen_height);	
-			plane.shader_program = &rect_shader;
-			plane.shader_program->bind();		
-    	plane.shader_program->set_uniform_value("projection_matrix", glm::ortho(0.0f, (float)screen_width, 0.0f, (float)screen_height, 0.5f, 1.0f));
-    	plane.shader_program->set_uniform_value("view_matrix", glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-	  	plane.shader_program->set_uniform_value("model_matrix", glm::scale(glm::mat4(1.0f), glm::vec3(screen_width, screen_height, 1.0f)));
-			plane.shader_program->set_uniform_value("texture2", depth_tex_buffer.unit_id); 
-	  	draw_mesh_object(plane);
-			plane.shader_program->release();
-			glEnable(GL_DEPTH_TEST);
+			glm::mat4 rect_projection_matrix = glm::ortho(0.0f, (float)screen_width, 0.0f, (float)screen_height, 0.5f, 1.0f);
+			glm::mat4 rect_view_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+			rect_shader.bind();
+			bool draw_rect = true;
+			if (uniform_ring != NULL) {
+				GLintptr rect_frame_offset = write_frame_block(rect_projection_matrix, rect_view_matrix, light_pov_matrix, light_position);
+				uniform_ring->flush();
+				draw_rect = rect_frame_offset >= 0;
+				if (draw_rect) {
+					uniform_ring->bind(FRAME_BLOCK_BINDING, rect_frame_offset, sizeof(frame_block_t));
+					uniform_ring->bind(OBJECT_BLOCK_BINDING, plane.uniform_offset, sizeof(object_block_t));
+				}
+			} else {
+    		rect_shader.set_uniform_value("projection_matrix", rect_projection_matrix);
+    		rect_shader.set_uniform_value("view_matrix", rect_view_matrix);
+				set_object_uniforms(rect_shader, plane);
+			}
+			rect_shader.set_uniform_value("texture2", depth_tex_buffer.unit_id); 
+			RENDER_STATE.bind_texture(texture_unit_names[depth_tex_buffer.unit_id], GL_TEXTURE_2D, depth_tex_buffer.handle);
+			if (draw_rect)
+				draw_mesh_object(plane, rect_shader);
+			RENDER_STATE.set_capability(GL_DEPTH_TEST, true);
 		}
 #endif
 
 #ifndef DEPTH_BUFFER_DEBUG
 		{			
-			glCullFace(GL_BACK);
+			PROFILE_GPU_SCOPE(profiler, "main pass");
+			RENDER_STATE.cull_face(GL_BACK);
 			glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 			glClearDepth(1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			glViewport(0, 0, screen_width, screen_height);
 
-	    glm::mat4 projection_matrix = glm::perspective(camera_fovy, (float) screen_width / (float) screen_height, 1.0f, 30.0f);
-			glm::mat4 _view_matrix = view_matrix * glm::mat4_cast(camera_rotation.orientation);
-
-			teapot.shader_program = &phong_shader;
-			teapot.shader_program->bind();		
-			teapot.shader_program->set_uniform_value("projection_matrix", projection_matrix);
-	    teapot.shader_program->set_uniform_value("view_matrix", _view_matrix);
-			teapot.shader_program->set_uniform_value("light_position", light_position);
-			teapot.shader_program->set_uniform_value("light_pov_matrix", light_pov_matrix);
-	    teapot.shader_program->set_uniform_value("texture1", tex.unit_id); 
-			teapot.shader_program->set_uniform_value("texture2", depth_tex_buffer.unit_id); 
-			draw_mesh_object(teapot);
-			teapot.shader_program->release();
-
-			floor.shader_program = &phong_shader;
-			floor.shader_program->bind();		
-			floor.shader_program->set_uniform_value("projection_matrix", projection_matrix);
-	    floor.shader_program->set_uniform_value("view_matrix", _view_matrix);
-			floor.shader_program->set_uniform_value("light_position", light_position);
-			floor.shader_program->set_uniform_value("light_pov_matrix", light_pov_matrix);
-			floor.shader_program->set_uniform_value("texture2", depth_tex_buffer.unit_id); 
-	    draw_mesh_object(floor);
-			floor.shader_program->release();	
+			phong_shader.bind();
+			if (uniform_ring != NULL) {
+				uniform_ring->bind(FRAME_BLOCK_BINDING, main_frame_offset, sizeof(frame_block_t));
+			} else {
+				phong_shader.set_uniform_value("projection_matrix", projection_matrix);
+	    	phong_shader.set_uniform_value("view_matrix", _view_matrix);
+				phong_shader.set_uniform_value("light_position", light_position);
+				phong_shader.set_uniform_value("light_pov_matrix", light_pov_matrix);
+			}
+	    phong_shader.set_uniform_value("texture1", tex.unit_id); 
+			phong_shader.set_uniform_value("texture2", depth_tex_buffer.unit_id); 
+			queue.submit(MAIN_PASS);
 		}
 #endif
 
-    glfwSwapBuffers();
+    {
+      PROFILE_SCOPE(profiler, "swap buffers");
+      context.swap_buffers();
+    }
+
+    profiler.end_frame();
+  }
 
+  if (profiler.is_enabled()) {
+    profiler.write_trace(context.profile_filepath().c_str());
+    profiler.report(std::cout);
+    std::cout << queue.stats() << std::endl;
+    std::cout << RENDER_STATE.counters() << std::endl;
   }
-  while (glfwGetKey(GLFW_KEY_ESC) != GLFW_PRESS && glfwGetWindowParam(GLFW_OPENED));
+  profiler.delete_queries();
+  delete uniform_ring;
 
-  glfwTerminate();
+  context.close();
 
   return 0;
 }
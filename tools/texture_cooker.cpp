@@ -0,0 +1,122 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+
+#include "image_loader.hpp"
+#include "texture_compressor.hpp"
+#include "compressed_texture.hpp"
+#include "mipmap.hpp"
+
+using namespace std;
+
+static const char *COMPRESSION_NAMES[] = { "BC1", "BC3", "BC5" };
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+static void usage() {
+	cerr << "usage: texture_cooker [--bc1 | --bc3 | --bc5] [--linear] [--box] input.png [output.dds]" << endl
+	     << "  BC3 for images with alpha and BC1 otherwise by default; --bc5 for normal maps" << endl
+	     << "  mips are filtered as sRGB colour unless --linear (data such as height maps) or --bc5;" << endl
+	     << "  with a Kaiser filter unless --box" << endl;
+}
+
+// over the channels the compression keeps
+static double peak_signal_to_noise(const mip_level_t &level, const vector<unsigned char> &decoded, texture_compression_t compression) {
+	size_t channel_count = (compression == TEXTURE_COMPRESSION_BC1) ? 3 : (compression == TEXTURE_COMPRESSION_BC3) ? 4 : 2;
+	double sum = 0.0;
+	for (size_t i = 0; i < level.width * level.height; i++) {
+		for (size_t c = 0; c < channel_count; c++) {
+			double d = (double)level.pixels[4 * i + c] - decoded[4 * i + c];
+			sum += d * d;
+		}
+	}
+	double mse = sum / (level.width * level.height * channel_count);
+	return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+int main(int argc, char **args) {
+	int compression = -1;
+	bool linear = false;
+	mip_filter_t filter = MIP_FILTER_KAISER;
+	vector<const char *> filepaths;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(args[i], "--bc1") == 0)
+			compression = TEXTURE_COMPRESSION_BC1;
+		else if (strcmp(args[i], "--bc3") == 0)
+			compression = TEXTURE_COMPRESSION_BC3;
+		else if (strcmp(args[i], "--bc5") == 0)
+			compression = TEXTURE_COMPRESSION_BC5;
+		else if (strcmp(args[i], "--linear") == 0)
+			linear = true;
+		else if (strcmp(args[i], "--box") == 0)
+			filter = MIP_FILTER_BOX;
+		else if (args[i][0] == '-') {
+			usage();
+			return EXIT_FAILURE;
+		} else
+			filepaths.push_back(args[i]);
+	}
+	if (filepaths.empty() || filepaths.size() > 2) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	string output_filepath;
+	if (filepaths.size() > 1) {
+		output_filepath = filepaths[1];
+	} else {
+		output_filepath = compressed_texture_file_t::filepath_for(filepaths[0]);
+	}
+
+	image_t image;
+	if (!read_image_from_png_file(filepaths[0], image))
+		return EXIT_FAILURE;
+	if (compression < 0)
+		compression = (image.channels == 2 || image.channels == 4) ? TEXTURE_COMPRESSION_BC3 : TEXTURE_COMPRESSION_BC1;
+
+	vector<unsigned char> rgba;
+	convert_to_rgba8(image, rgba);
+	size_t source_size = image.size();
+	mip_content_t content = (compression == TEXTURE_COMPRESSION_BC5) ? MIP_CONTENT_NORMAL : linear ? MIP_CONTENT_LINEAR : MIP_CONTENT_COLOR;
+	vector<mip_level_t> levels;
+	generate_mip_chain(&rgba[0], image.width, image.height, content, filter, levels);
+	release_image(image);
+
+	double start = now();
+	vector<vector<unsigned char> > blocks(levels.size());
+	vector<compressed_texture_file_t::level_t> compressed_levels(levels.size());
+	size_t compressed_size = 0;
+	for (size_t i = 0; i < levels.size(); i++) {
+		blocks[i].resize(compressed_image_size((texture_compression_t)compression, levels[i].width, levels[i].height));
+		compress_image(&levels[i].pixels[0], levels[i].width, levels[i].height, (texture_compression_t)compression, &blocks[i][0]);
+		compressed_levels[i].width = levels[i].width;
+		compressed_levels[i].height = levels[i].height;
+		compressed_levels[i].size = blocks[i].size();
+		compressed_levels[i].data = &blocks[i][0];
+		compressed_size += blocks[i].size();
+	}
+	double encode_time = now() - start;
+
+	if (!compressed_texture_file_t::write(output_filepath.c_str(), (texture_compression_t)compression, compressed_levels)) {
+		cerr << "*** Could not write " << output_filepath << endl;
+		return EXIT_FAILURE;
+	}
+
+	vector<unsigned char> decoded(levels[0].pixels.size());
+	decompress_image(&blocks[0][0], levels[0].width, levels[0].height, (texture_compression_t)compression, &decoded[0]);
+
+	cout << output_filepath << ": " << COMPRESSION_NAMES[compression] << ", " << levels[0].width << "x" << levels[0].height
+	     << ", " << levels.size() << " levels, " << compressed_size << " bytes (top level " << (double)source_size / blocks[0].size()
+	     << ":1), " << encode_time * 1.0e3 << " ms, "
+	     << peak_signal_to_noise(levels[0], decoded, (texture_compression_t)compression) << " dB PSNR" << endl;
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "mesh.hpp"
+#include "vertex_format.hpp"
+
+using namespace std;
+
+struct format_error_t {
+	float position_max;
+	double position_sum;
+	float normal_max;  // degrees
+	double normal_sum;
+	float tangent_max;
+	double tangent_sum;
+	float tex_coord_max;
+	size_t handedness_flips;
+
+	format_error_t() : position_max(0), position_sum(0), normal_max(0), normal_sum(0),
+	            tangent_max(0), tangent_sum(0), tex_coord_max(0), handedness_flips(0) { }
+};
+
+static float angle_between(const glm::vec3 &a, const glm::vec3 &b) {
+	float la = glm::length(a), lb = glm::length(b);
+	if (la == 0.0f || lb == 0.0f)
+		return 0.0f;
+	float c = glm::dot(a, b) / (la * lb);
+	return acosf(min(max(c, -1.0f), 1.0f)) * 180.0f / 3.14159265f;
+}
+
+static void measure(const vertex_t &expected, const vertex_t &actual, format_error_t &error) {
+	float position = glm::length(glm::vec3(actual.position) - glm::vec3(expected.position));
+	float normal = angle_between(expected.normal, actual.normal);
+	float tangent = angle_between(glm::vec3(expected.tangent), glm::vec3(actual.tangent));
+	float tex_coord = max(fabsf(actual.tex_coord.x - expected.tex_coord.x), fabsf(actual.tex_coord.y - expected.tex_coord.y));
+
+	error.position_max = max(error.position_max, position);
+	error.position_sum += position;
+	error.normal_max = max(error.normal_max, normal);
+	error.normal_sum += normal;
+	error.tangent_max = max(error.tangent_max, tangent);
+	error.tangent_sum += tangent;
+	error.tex_coord_max = max(error.tex_coord_max, tex_coord);
+	if ((expected.tangent.w < 0.0f) != (actual.tangent.w < 0.0f))
+		error.handedness_flips++;
+}
+
+static void report(const char *filepath, const mesh_t &mesh) {
+	size_t count = mesh.vertex_count();
+	const vertex_t *vertices = mesh.vertex_data();
+	if (count == 0)
+		return;
+
+	glm::vec3 lower(vertices[0].position), upper(vertices[0].position);
+	for (size_t i = 1; i < count; i++) {
+		lower = glm::min(lower, glm::vec3(vertices[i].position));
+		upper = glm::max(upper, glm::vec3(vertices[i].position));
+	}
+	float diagonal = glm::length(upper - lower);
+
+	cout << filepath << ": " << count << " vertices, bounding box diagonal " << diagonal << endl;
+	cout << "  " << setw(10) << left << "format" << right
+	     << setw(7) << "bytes" << setw(7) << "ratio"
+	     << setw(13) << "position max" << setw(13) << "mean"
+	     << setw(13) << "normal max" << setw(9) << "mean"
+	     << setw(13) << "tangent max" << setw(9) << "mean"
+	     << setw(12) << "uv max" << setw(7) << "flips" << endl;
+
+	const vertex_format_t formats[] = { VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_COMPACT, VERTEX_FORMAT_QUANTIZED };
+	for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		const vertex_layout_t &layout = vertex_layout_t::of(formats[f]);
+		vector<unsigned char> data;
+		vertex_quantization_t quantization;
+		encode_vertices(vertices, count, formats[f], data, quantization);
+
+		format_error_t error;
+		for (size_t i = 0; i < count; i++) {
+			vertex_t decoded;
+			decode_vertex(&data[i * layout.stride], formats[f], quantization, decoded);
+			measure(vertices[i], decoded, error);
+		}
+
+		cout << "  " << setw(10) << left << layout.name << right
+		     << setw(7) << layout.stride << setw(6) << setprecision(3) << (float)sizeof(vertex_t) / layout.stride << "x"
+		     << setprecision(3) << scientific
+		     << setw(13) << error.position_max / diagonal << setw(13) << error.position_sum / count / diagonal
+		     << fixed << setprecision(4)
+		     << setw(13) << error.normal_max << setw(9) << error.normal_sum / count
+		     << setw(13) << error.tangent_max << setw(9) << error.tangent_sum / count
+		     << scientific << setprecision(3) << setw(12) << error.tex_coord_max
+		     << fixed << setw(7) << error.handedness_flips << endl;
+		cout.unsetf(ios::floatfield);
+	}
+	cout << "  (positions relative to the diagonal, normals and tangents in degrees)" << endl;
+}
+
+int main(int argc, char **args) {
+	if (argc < 2) {
+		cerr << "usage: " << args[0] << " MESH.ctm..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	for (int i = 1; i < argc; i++) {
+		mesh_t mesh;
+		if (!mesh_t::read_from_file(args[i], mesh))
+			return EXIT_FAILURE;
+		report(args[i], mesh);
+	}
+
+	return 0;
+}
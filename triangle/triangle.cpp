@@ -9,8 +9,11 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 
+#include "gl.hpp"
 #include <GL/glfw.h>
 
+#include "context.hpp"
+
 #define BUFFER_OFFSET(bytes) ((GLubyte *)NULL + (bytes))
 
 
@@ -94,29 +97,17 @@ void read_shader_source(const char *filename, std::string & source)
   file.close();
 }
 
-int main(void)
+int main(int argc, char **args)
 {
-  int width, height, x;
+  int width, height, x = 0;
   double t;
 
-  if (!glfwInit()) {
-    std::cerr << "Failed to initialize GLFW" << std::endl;
-    exit(EXIT_FAILURE);
-  }
-
-  if (!glfwOpenWindow(640, 480, 0, 0, 0, 0, 0, 0, GLFW_WINDOW)) {
-    std::cerr << "Failed to open GLFW window" << std::endl;
-
-    glfwTerminate();
+  context_t context(640, 480, 0);
+  context.parse_arguments(argc, args);
+  if (!context.open("Spinning Triangle")) {
     exit(EXIT_FAILURE);
   }
 
-  glfwSetWindowTitle("Spinning Triangle");
-
-  glfwEnable(GLFW_STICKY_KEYS);
-
-  glfwSwapInterval(1);
-
   unsigned int vertex_count = 3;
   float vertices[][3] = {
     {-5.0f, 0.0f, -4.0f},
@@ -185,11 +176,14 @@ int main(void)
   glm::vec3 light_position(0.0f); // light position in world space
   glUniform3fv(uniform.light_position, 1, glm::value_ptr(light_position));
 
-  do {
+  while (context.is_running()) {
     t = glfwGetTime();
     glfwGetMousePos(&x, NULL);
 
-    glfwGetWindowSize(&width, &height);
+    width = context.width();
+    height = context.height();
+    if (!context.is_headless())
+      glfwGetWindowSize(&width, &height);
 
     height = height > 0 ? height : 1;
 
@@ -218,12 +212,11 @@ int main(void)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawable.index_buffer_handle);
     glDrawElements(GL_TRIANGLES, face_count * 3, GL_UNSIGNED_INT, BUFFER_OFFSET(0));
 
-    glfwSwapBuffers();
+    context.swap_buffers();
 
   }
-  while (glfwGetKey(GLFW_KEY_ESC) != GLFW_PRESS && glfwGetWindowParam(GLFW_OPENED));
 
-  glfwTerminate();
+  context.close();
 
   return 0;
 }
@@ -8,8 +8,7 @@
 #include <string>
 #include <sstream>
 
-#include <OpenGL/gl.h>
-#include <OpenGL/glext.h>
+#include "gl.hpp"
 #include <GL/glfw.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -19,6 +18,7 @@
 
 #include "shader.hpp"
 #include "mesh.hpp"
+#include "context.hpp"
 
 #define BUFFER_OFFSET(STRUCT, MEMBER) ((GLubyte *)NULL + (offsetof(STRUCT, MEMBER)))
 
@@ -33,21 +33,13 @@ glm::vec3 light_direction;
 
 int main(int argc, char **args)
 {
-  if (!glfwInit()) {
-    std::cerr << "Failed to initialize GLFW" << std::endl;
+	context_t context(640, 480, 16);
+	context.parse_arguments(argc, args);
+  if (!context.open("Teapot")) {
     exit(EXIT_FAILURE);
   }
-
-  int depth_bits = 16;
-  if (!glfwOpenWindow(640, 480, 0, 0, 0, 0, depth_bits, 0, GLFW_WINDOW)) {
-    std::cerr << "Failed to open GLFW window" << std::endl;
-    glfwTerminate();
-    exit(EXIT_FAILURE);
-  }
-  glfwGetWindowSize(&screen_width, &screen_height);
-  glfwSetWindowTitle("Teapot");
-  glfwEnable(GLFW_STICKY_KEYS);
-  glfwSwapInterval(1);
+  screen_width = context.width();
+  screen_height = context.height();
 
 	shader_program_t shader_program;
 	shader_program_t::build(shader_program, "diffuse.vs", "diffuse.fs");
@@ -55,7 +47,7 @@ int main(int argc, char **args)
 	mesh_t teapot;
 	if (! mesh_t::read_from_file("teapot.ctm", teapot)) {
 		std::cerr << "Failed to read ctm file" << std::endl;
-	  glfwTerminate();
+	  context.close();
     exit(EXIT_FAILURE);		
 	}
 	teapot.load_to_buffers();
@@ -75,7 +67,7 @@ int main(int argc, char **args)
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
 
-  do {
+  while (context.is_running()) {
 		
 		{			
 			glCullFace(GL_BACK);
@@ -93,12 +85,11 @@ int main(int argc, char **args)
 			shader_program.release();
 		}
 
-    glfwSwapBuffers();
+    context.swap_buffers();
 
   }
-  while (glfwGetKey(GLFW_KEY_ESC) != GLFW_PRESS && glfwGetWindowParam(GLFW_OPENED));
 
-  glfwTerminate();
+  context.close();
 
   return 0;
 }